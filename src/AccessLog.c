@@ -0,0 +1,203 @@
+#include "AccessLog.h"
+
+LogRing_t* logRings = NULL;				// A ring for each producer (NULL if log is disabled)
+LogLevel_t logLevel = LOG_NONE;				// Requests that are logged
+unsigned int logSampling = 1;				// Only one of every logSampling requests is logged
+uint64_t slowThreshold = 0;				// Requests that take at least slowThreshold ns are always logged (0 disables them)
+FILE* logFile = NULL;					// File on which records are written
+pthread_t drainerTid;					// Id of the thread that writes records on file
+atomic_int drainerStop;					// Set to ask the drainer to terminate
+
+
+// Writes on log file the time (us) elapsed from reception of request to a phase of it, if request went through that phase
+static void WritePhase(const char* phase, uint64_t time, uint64_t received)
+{
+	if(time != 0)
+		fprintf(logFile, " %s=%+.1f", phase, ((int64_t)(time - received)) / 1000.0);
+}
+
+
+// Writes record on log file as a line of key=value fields, slow requests have also the timestamps of their phases
+static void WriteRecord(int producer, LogRecord_t* record)
+{
+	time_t seconds = record->timestamp / 1000000000ULL;
+	struct tm date;
+	char dateBuff[32];
+	gmtime_r(&seconds, &date);
+	strftime(dateBuff, sizeof(dateBuff), "%Y-%m-%dT%H:%M:%S", &date);
+
+	RequestTiming_t* timing = &record->timing;
+	fprintf(logFile, "%s.%06luZ%s %s=%d type=%s client=\"%s\" name=\"%s\" result=%s latency_us=%.1f", dateBuff,
+		(unsigned long)((record->timestamp % 1000000000ULL) / 1000), record->slow ? " SLOW" : "",
+		producer < MAX_CLIENT_NUM ? "worker" : "shm_client", producer < MAX_CLIENT_NUM ? producer : producer - MAX_CLIENT_NUM,
+		GetRequestTypeName(record->type), record->clientName, record->name, GetRequestTypeName(record->result),
+		(timing->completed - timing->received) / 1000.0);
+
+	if(record->slow)
+	{
+		WritePhase("arrived", timing->arrived, timing->received);	// Before reception, so it is negative
+		WritePhase("dequeued", timing->dequeued, timing->received);
+		WritePhase("lock_requested", timing->lockRequested, timing->received);
+		WritePhase("locked", timing->locked, timing->received);
+		WritePhase("executed", timing->executed, timing->received);
+		WritePhase("indexed", timing->indexed, timing->received);
+		WritePhase("flush_started", timing->flushStarted, timing->received);
+		WritePhase("persisted", timing->persisted, timing->received);
+		WritePhase("replied", timing->completed, timing->received);
+	}
+
+	fputc('\n', logFile);
+}
+
+
+// Writes all records stored in the rings on the log file, returns number of records written
+static int DrainRings()
+{
+	int drained = 0;
+
+	for(int i = 0; i < LOG_PRODUCERS; i++)
+	{
+		LogRing_t* ring = &logRings[i];
+		uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+		uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+
+		for(; head != tail; head++, drained++)
+			WriteRecord(i, &ring->records[head % LOG_RING_SIZE]);
+
+		atomic_store_explicit(&ring->head, head, memory_order_release);
+	}
+
+	return drained;
+}
+
+
+// Drains the rings until StopAccessLog() is called, file is flushed when there is nothing to write
+static void* DrainAccessLog(void* unused)
+{
+	(void) unused;
+
+	while(atomic_load(&drainerStop) == 0)
+	{
+		if(DrainRings() == 0)
+		{
+			fflush(logFile);
+			usleep(LOG_DRAIN_INTERVAL * 1000);
+		}
+	}
+
+	DrainRings();						// Write records logged before stop
+	fflush(logFile);
+	return NULL;
+}
+
+
+// Opens log file ("-" is stdout) and starts the thread that writes records on it, returns 0 on failure. If level is LOG_NONE and
+// slow requests are not logged (threshold is 0) nothing is started
+int StartAccessLog(const char* filename, LogLevel_t level, unsigned int sampling, uint64_t threshold)
+{
+	if(level == LOG_NONE && threshold == 0)
+		return 1;
+
+	logFile = strcmp(filename, "-") == 0 ? stdout : fopen(filename, "a");
+	if(logFile == NULL)
+	{
+		fprintf(stderr, "Error: cannot open log file \"%s\"\n", filename);
+		return 0;
+	}
+
+	logRings = calloc(LOG_PRODUCERS, sizeof(LogRing_t));
+	if(logRings == NULL)
+	{
+		fprintf(stderr, "Error: cannot allocate memory to hold log rings\n");
+		if(logFile != stdout)
+			fclose(logFile);
+		return 0;
+	}
+
+	logSampling = sampling > 0 ? sampling : 1;
+	slowThreshold = threshold;
+	atomic_store(&drainerStop, 0);
+
+	if(pthread_create(&drainerTid, NULL, DrainAccessLog, NULL) != 0)
+	{
+		fprintf(stderr, "Error: cannot create thread for access log\n");
+		free(logRings);
+		logRings = NULL;
+		if(logFile != stdout)
+			fclose(logFile);
+		return 0;
+	}
+
+	logLevel = level;
+	return 1;
+}
+
+
+// Writes all pending records, stops the drainer and closes the log file
+void StopAccessLog()
+{
+	if(logRings == NULL)
+		return;
+
+	atomic_store(&drainerStop, 1);
+	pthread_join(drainerTid, NULL);
+
+	uint64_t dropped = 0;
+	for(int i = 0; i < LOG_PRODUCERS; i++)
+		dropped += atomic_load(&logRings[i].dropped);
+
+	if(dropped > 0)
+		printf("Access log: %lu records dropped because log was too slow\n", dropped);
+
+	if(logFile != stdout)
+		fclose(logFile);
+
+	free(logRings);
+	logRings = NULL;
+	logLevel = LOG_NONE;
+}
+
+
+// Stores a record of a completed request and its response in the ring of producer, if request is slow or log level and sampling allow it
+// (it must be called only while log is started)
+void LogRequest(int producer, Packet_t* request, Packet_t* response, RequestTiming_t* timing)
+{
+	if(logRings == NULL)
+		return;
+
+	LogRing_t* ring = &logRings[producer];
+	int slow = slowThreshold != 0 && timing->completed - timing->received >= slowThreshold;
+
+	if(slow == 0)
+	{
+		if(logLevel == LOG_NONE || (logLevel == LOG_WRITES && request->type != ADD_CONTACT && request->type != REMOVE_CONTACT && request->type != LOGIN))
+			return;
+
+		if(++ring->sampleCounter < logSampling)
+			return;
+		ring->sampleCounter = 0;
+	}
+
+	uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+	if(tail - atomic_load_explicit(&ring->head, memory_order_acquire) == LOG_RING_SIZE)
+	{
+		atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+		return;
+	}
+
+	struct timespec now;
+	clock_gettime(CLOCK_REALTIME, &now);
+
+	LogRecord_t* record = &ring->records[tail % LOG_RING_SIZE];
+	record->timestamp = now.tv_sec * 1000000000ULL + now.tv_nsec;
+	memcpy(&record->timing, timing, sizeof(RequestTiming_t));
+	record->type = request->type;
+	record->result = response->type;
+	record->slow = slow;
+	strncpy(record->clientName, request->clientName, MAX_NAME_SIZE - 1);
+	record->clientName[MAX_NAME_SIZE - 1] = '\0';
+	strncpy(record->name, request->name, MAX_NAME_SIZE - 1);
+	record->name[MAX_NAME_SIZE - 1] = '\0';
+
+	atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+}
@@ -0,0 +1,54 @@
+// This file contains the definition of the access log of the server. Every thread that satisfies requests (workers and threads that serve
+// shared memory clients) owns a single-producer single-consumer ring in which it stores a fixed-size record for each logged request, a
+// background thread drains all the rings and formats the records on the log file. So logging a request never takes a lock nor makes a
+// syscall, when a ring is full the record is dropped (and counted) instead of slowing down the producer. Requests slower than a threshold
+// are always logged (regardless of level and sampling) with the timestamps of all their phases
+
+#ifndef ACCESS_LOG_H
+#define ACCESS_LOG_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "Packet.h"
+#include "Utility.h"
+#include "Constants.h"
+#include "Stats.h"
+
+#define LOG_RING_SIZE		512					// Number of records that a ring can hold (must be a power of 2)
+#define LOG_PRODUCERS		(MAX_CLIENT_NUM + MAX_CONNECTIONS)	// Workers first, then threads that serve shared memory clients
+#define LOG_DRAIN_INTERVAL	10					// Time (ms) that drainer sleeps when all rings are empty
+
+typedef enum { LOG_NONE, LOG_WRITES, LOG_ALL } LogLevel_t;
+
+typedef struct _LogRecord {
+	uint64_t timestamp;					// Time (ns since epoch) at which request has been completed
+	RequestTiming_t timing;					// Timestamps (monotonic clock) of the phases of the request
+	RequestType_t type;					// Type of the request
+	RequestType_t result;					// Type of the response
+	int slow;						// Set if request took more than the slow threshold
+	char clientName[MAX_NAME_SIZE];				// Name declared by client
+	char name[MAX_NAME_SIZE];				// Name of the contact (or user) of the request
+} LogRecord_t;
+
+typedef struct _LogRing {
+	_Atomic uint32_t head;					// Index of next record to be read (written only by drainer)
+	char consumerPad[60];					// Keep consumer's and producer's fields on different cache lines
+	_Atomic uint32_t tail;					// Index of next record to be written (written only by producer)
+	unsigned int sampleCounter;				// Requests seen by producer since last logged one (used only by producer)
+	_Atomic uint64_t dropped;				// Records dropped because ring was full
+	char producerPad[48];
+	LogRecord_t records[LOG_RING_SIZE];
+} LogRing_t;
+
+int StartAccessLog(const char* filename, LogLevel_t level, unsigned int sampling, uint64_t slowThreshold);
+void StopAccessLog();
+void LogRequest(int producer, Packet_t* request, Packet_t* response, RequestTiming_t* timing);
+
+#endif
@@ -0,0 +1,140 @@
+#include "BloomFilter.h"
+
+// Allocates counters for a filter that should contain about expectedNames names, returns 0 on failure
+int InitializeBloomFilter(BloomFilter_t* filter, size_t expectedNames)
+{
+	if(filter == NULL)
+		return 0;
+
+	filter->countersNum = BLOOM_MIN_COUNTERS;
+	while(filter->countersNum < expectedNames * BLOOM_COUNTERS_PER_NAME)	// Number of counters must be a power of 2 (index is a mask)
+		filter->countersNum *= 2;
+
+	filter->counters = calloc(filter->countersNum, sizeof(uint8_t));
+	if(filter->counters == NULL)
+	{
+		fprintf(stderr, "Error: cannot allocate memory to hold bloom filter\n");
+		return 0;
+	}
+
+	atomic_store(&filter->negatives, 0);
+	atomic_store(&filter->positives, 0);
+	atomic_store(&filter->falsePositives, 0);
+	return 1;
+}
+
+
+// Deallocates counters of filter
+void DestroyBloomFilter(BloomFilter_t* filter)
+{
+	if(filter == NULL)
+		return;
+
+	free(filter->counters);
+	filter->counters = NULL;
+}
+
+
+// Computes the BLOOM_HASHES indexes of the counters of name (using double hashing on the two halves of a 64 bit hash)
+static void GetIndexes(BloomFilter_t* filter, const char* name, size_t* indexes)
+{
+	uint64_t hash = HashString(name, MAX_NAME_SIZE);
+	hash ^= hash >> 33;					// Mix bits, FNV-1a alone has poor low bits for short strings
+	hash *= 0xff51afd7ed558ccdULL;
+	hash ^= hash >> 33;
+
+	uint32_t first = (uint32_t) hash;
+	uint32_t second = (uint32_t)(hash >> 32) | 1;
+
+	for(int i = 0; i < BLOOM_HASHES; i++)
+		indexes[i] = (first + (size_t) i * second) & (filter->countersNum - 1);
+}
+
+
+// Adds name to filter
+void BloomAdd(BloomFilter_t* filter, const char* name)
+{
+	if(filter == NULL || filter->counters == NULL || name == NULL)
+		return;
+
+	size_t indexes[BLOOM_HASHES];
+	GetIndexes(filter, name, indexes);
+
+	for(int i = 0; i < BLOOM_HASHES; i++)
+	{
+		if(filter->counters[indexes[i]] < UINT8_MAX)
+			filter->counters[indexes[i]]++;
+	}
+}
+
+
+// Removes name from filter (name must have been added before)
+void BloomRemove(BloomFilter_t* filter, const char* name)
+{
+	if(filter == NULL || filter->counters == NULL || name == NULL)
+		return;
+
+	size_t indexes[BLOOM_HASHES];
+	GetIndexes(filter, name, indexes);
+
+	for(int i = 0; i < BLOOM_HASHES; i++)
+	{
+		if(filter->counters[indexes[i]] > 0 && filter->counters[indexes[i]] < UINT8_MAX)	// Saturated counters lost their count
+			filter->counters[indexes[i]]--;
+	}
+}
+
+
+// Returns 0 if name is surely not in the filter, 1 if it may be
+int BloomMayContain(BloomFilter_t* filter, const char* name)
+{
+	if(filter == NULL || filter->counters == NULL || name == NULL)
+		return 1;
+
+	size_t indexes[BLOOM_HASHES];
+	GetIndexes(filter, name, indexes);
+
+	for(int i = 0; i < BLOOM_HASHES; i++)
+	{
+		if(filter->counters[indexes[i]] == 0)
+		{
+			atomic_fetch_add_explicit(&filter->negatives, 1, memory_order_relaxed);
+			return 0;
+		}
+	}
+
+	atomic_fetch_add_explicit(&filter->positives, 1, memory_order_relaxed);
+	return 1;
+}
+
+
+// Signals that the last name for which BloomMayContain() returned 1 was not actually present
+void BloomFalsePositive(BloomFilter_t* filter)
+{
+	if(filter != NULL)
+		atomic_fetch_add_explicit(&filter->falsePositives, 1, memory_order_relaxed);
+}
+
+
+// Prints to stdout how many queries have been answered by the filter and its false positive rate
+void PrintBloomStats(BloomFilter_t* filter)
+{
+	if(filter == NULL || filter->counters == NULL)
+		return;
+
+	uint64_t negatives = atomic_load(&filter->negatives);
+	uint64_t positives = atomic_load(&filter->positives);
+	uint64_t falsePositives = atomic_load(&filter->falsePositives);
+	double fpRate = negatives + falsePositives == 0 ? 0.0 : (100.0 * falsePositives) / (negatives + falsePositives);
+
+	printf("Bloom filter: %lu queries, %lu misses rejected without index walk, %lu false positives (rate %.2f%%), %lu KB\n",
+		negatives + positives, negatives, falsePositives, fpRate, filter->countersNum / 1024);
+}
+
+
+// Writes in buff a short summary of the statistics of filter
+void FormatBloomStats(BloomFilter_t* filter, char* buff, size_t size)
+{
+	snprintf(buff, size, "queries=%lu negatives=%lu false_positives=%lu", (unsigned long)(atomic_load(&filter->negatives) +
+		atomic_load(&filter->positives)), (unsigned long) atomic_load(&filter->negatives), (unsigned long) atomic_load(&filter->falsePositives));
+}
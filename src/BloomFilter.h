@@ -0,0 +1,36 @@
+// This file contains the definition of the BloomFilter_t struct, a counting bloom filter used to know if a name is surely not in the
+// phonebook without walking the tree (a miss is the most expensive lookup). Each name increments BLOOM_HASHES counters, so names can be
+// removed by decrementing them; a counter that saturates is never decremented again (the filter can only become less precise, never wrong)
+
+#ifndef BLOOM_FILTER_H
+#define BLOOM_FILTER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+#include "Utility.h"
+
+#define BLOOM_HASHES		4			// Number of counters associated to each name
+#define BLOOM_COUNTERS_PER_NAME	10			// Counters allocated for each name expected in the filter (~1% false positives)
+#define BLOOM_MIN_COUNTERS	65536			// Min number of counters of a filter
+
+typedef struct _BloomFilter {
+	uint8_t* counters;				// Array of counters
+	size_t countersNum;				// Number of counters (it is a power of 2)
+	_Atomic uint64_t negatives;			// Queries for which filter answered that name is not present
+	_Atomic uint64_t positives;			// Queries for which filter answered that name may be present
+	_Atomic uint64_t falsePositives;		// Queries for which filter answered that name may be present but it was not
+} BloomFilter_t;
+
+int InitializeBloomFilter(BloomFilter_t* filter, size_t expectedNames);
+void DestroyBloomFilter(BloomFilter_t* filter);
+void BloomAdd(BloomFilter_t* filter, const char* name);
+void BloomRemove(BloomFilter_t* filter, const char* name);
+int BloomMayContain(BloomFilter_t* filter, const char* name);
+void BloomFalsePositive(BloomFilter_t* filter);
+void PrintBloomStats(BloomFilter_t* filter);
+void FormatBloomStats(BloomFilter_t* filter, char* buff, size_t size);
+
+#endif
@@ -1,8 +1,58 @@
 
 #include "Bst.h"
 
-// Allocates a new node, set's its properties with given parameters and returns a pointer to it
-BstNode_t* AddNode(BstNode_t** root, const char* name, const char* number, size_t offset)
+#include <malloc.h>
+
+// Counts in stats a node that is going to be linked at given depth, returns 0 if stats can't grow (stats can be NULL)
+static int CountNodeAtDepth(BstStats_t* stats, size_t depth, BstNode_t* node)
+{
+	if(stats == NULL)
+		return 1;
+
+	if(depth > stats->depthCountsSize)
+	{
+		size_t newSize = stats->depthCountsSize == 0 ? 64 : stats->depthCountsSize * 2;
+		size_t* newCounts = realloc(stats->depthCounts, newSize * sizeof(size_t));
+		if(newCounts == NULL)
+		{
+			fprintf(stderr, "Error: AddNode() failed, cannot grow tree statistics\n");
+			return 0;
+		}
+
+		memset(newCounts + stats->depthCountsSize, 0, (newSize - stats->depthCountsSize) * sizeof(size_t));
+		stats->depthCounts = newCounts;
+		stats->depthCountsSize = newSize;
+	}
+
+	stats->depthCounts[depth - 1]++;
+	stats->nodes++;
+	stats->depthSum += depth;
+	stats->bytes += malloc_usable_size(node);
+	if(depth > stats->height)
+		stats->height = depth;
+
+	return 1;
+}
+
+
+// Removes from stats a leaf that is going to be unlinked from given depth (stats can be NULL)
+static void UncountNodeAtDepth(BstStats_t* stats, size_t depth, BstNode_t* node)
+{
+	if(stats == NULL || depth > stats->depthCountsSize)
+		return;
+
+	stats->depthCounts[depth - 1]--;
+	stats->nodes--;
+	stats->depthSum -= depth;
+	stats->bytes -= malloc_usable_size(node);
+	while(stats->height > 0 && stats->depthCounts[stats->height - 1] == 0)	// Deepest node may have been the last one at its depth
+		stats->height--;
+}
+
+
+// Allocates a new node, set's its properties with given parameters and returns a pointer to it, if stats is not NULL the node is
+// counted in them
+BstNode_t* AddNode(BstNode_t** root, const char* name, const char* number, size_t offset, BstStats_t* stats)
 {
 	BstNode_t* newNode = malloc(sizeof(BstNode_t));
 	if(newNode == NULL)
@@ -23,9 +73,16 @@ BstNode_t* AddNode(BstNode_t** root, const char* name, const char* number, size_
 
 	newNode->offset = offset;
 	newNode->leftChild = newNode->rightChild = NULL;
+	size_t depth = 1;
 
 	if(*root == NULL)					// If no root is given then we are creating a new tree
 	{
+		if(CountNodeAtDepth(stats, depth, newNode) == 0)
+		{
+			free(newNode);
+			return NULL;
+		}
+
 		*root = newNode;
 		newNode->father = NULL;
 	} else {						// Otherwise we are inserting a new node in an already existing tree
@@ -39,6 +96,7 @@ BstNode_t* AddNode(BstNode_t** root, const char* name, const char* number, size_
 				curr = curr->leftChild;
 			else
 				curr = curr->rightChild;
+			depth++;
 		}
 
 		if(strncmp(name, temp->name, MAX_NAME_SIZE) == 0)	// If a node with same name already exist
@@ -47,6 +105,12 @@ BstNode_t* AddNode(BstNode_t** root, const char* name, const char* number, size_
 			return NULL;
 		}
 
+		if(CountNodeAtDepth(stats, depth, newNode) == 0)	// Stats are updated before the node is linked, so they can't be wrong
+		{
+			free(newNode);
+			return NULL;
+		}
+
 		if(name[0] <= temp->name[0])
 			temp->leftChild = newNode;
 		else
@@ -59,8 +123,9 @@ BstNode_t* AddNode(BstNode_t** root, const char* name, const char* number, size_
 }
 
 
-// Deallocates node given as parameter
-void DeleteNode(BstNode_t** node)
+// Deallocates node given as parameter (nodes with childs are overwritten with a descendant and the descendant is deallocated, so only leaves
+// are ever unlinked), if stats is not NULL the deallocated node is removed from them
+void DeleteNode(BstNode_t** node, BstStats_t* stats)
 {
 	if(node == NULL || *node == NULL)
 		return;
@@ -69,6 +134,11 @@ void DeleteNode(BstNode_t** node)
 
 	if(toRemove->leftChild == NULL && toRemove->rightChild == NULL)	// If node has no childs
 	{
+		size_t depth = 1;
+		for(BstNode_t* curr = toRemove->father; curr != NULL; curr = curr->father)
+			depth++;
+		UncountNodeAtDepth(stats, depth, toRemove);
+
 		if(toRemove->father == NULL)				// If node has no father then it's the root of the tree
 		{
 			free(toRemove);					// So deallocate the node
@@ -90,7 +160,7 @@ void DeleteNode(BstNode_t** node)
 		strncpy(toRemove->name, newNode->name, MAX_NAME_SIZE);
 		strncpy(toRemove->number, newNode->number, MAX_PHONE_NUM_SIZE);
 		toRemove->offset = newNode->offset;
-		DeleteNode(&newNode);
+		DeleteNode(&newNode, stats);
 		return;
 
 	} else if(toRemove->leftChild == NULL && toRemove->rightChild != NULL)	// If node has only a right child
@@ -99,7 +169,7 @@ void DeleteNode(BstNode_t** node)
 		strncpy(toRemove->name, newNode->name, MAX_NAME_SIZE);
 		strncpy(toRemove->number, newNode->number, MAX_PHONE_NUM_SIZE);
 		toRemove->offset = newNode->offset;
-		DeleteNode(&newNode);
+		DeleteNode(&newNode, stats);
 		return;
 
 	} else {							// If node has both childs
@@ -107,7 +177,7 @@ void DeleteNode(BstNode_t** node)
 		strncpy(toRemove->name, newNode->name, MAX_NAME_SIZE);
 		strncpy(toRemove->number, newNode->number, MAX_PHONE_NUM_SIZE);
 		toRemove->offset = newNode->offset;
-		DeleteNode(&newNode);
+		DeleteNode(&newNode, stats);
 		return;
 	}
 }
@@ -165,7 +235,7 @@ void DeleteTree(BstNode_t** root)
 		return;
 
 	DeleteSubtree(*root);
-	DeleteNode(root);
+	DeleteNode(root, NULL);
 }
 
 
@@ -223,6 +293,24 @@ BstNode_t* GetMax(BstNode_t* root)
 }
 
 
+// Deallocates memory used by stats and resets them
+void DestroyBstStats(BstStats_t* stats)
+{
+	free(stats->depthCounts);
+	memset(stats, 0, sizeof(BstStats_t));
+}
+
+
+// Writes stats in buff: nodes, height (max lookup depth), average lookup depth and kB allocated for nodes. Keys are short so that a
+// tree of a billion nodes fits in a STATS response (MAX_NAME_SIZE bytes), only a degenerate tree that deep gets the last field cut
+// by snprintf (fields parsed by soak mode come first)
+void FormatBstStats(BstStats_t* stats, char* buff, size_t size)
+{
+	snprintf(buff, size, "nodes=%lu height=%lu avg=%.1f kb=%lu", (unsigned long) stats->nodes, (unsigned long) stats->height,
+		stats->nodes > 0 ? (double) stats->depthSum / stats->nodes : 0.0, (unsigned long)(stats->bytes / 1024));
+}
+
+
 // Prints to stdout the content of the tree that has as root the given node, used for debug (Warning is recursive)
 void PrintTree(BstNode_t* root)
 {
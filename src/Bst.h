@@ -7,6 +7,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
 #include "Constants.h"
 
 typedef struct _BstNode {
@@ -19,15 +20,26 @@ typedef struct _BstNode {
 	struct _BstNode* rightChild;
 } BstNode_t;
 
+typedef struct _BstStats {				// Shape of a tree, kept up to date by AddNode() and DeleteNode() so reading it costs nothing
+	size_t nodes;					// Nodes in the tree
+	size_t height;					// Depth of the deepest node (root has depth 1), it is the max number of nodes visited by a lookup
+	uint64_t depthSum;				// Sum of the depths of all nodes, divided by nodes it is the average length of a successful lookup
+	size_t bytes;					// Bytes allocated for nodes (allocator's overhead included)
+	size_t* depthCounts;				// Number of nodes at each depth (depthCounts[0] is the number of nodes at depth 1)
+	size_t depthCountsSize;				// Length of depthCounts
+} BstStats_t;
 
-BstNode_t* AddNode(BstNode_t** root, const char* name, const char* number, size_t offset);
-void DeleteNode(BstNode_t** node);
+
+BstNode_t* AddNode(BstNode_t** root, const char* name, const char* number, size_t offset, BstStats_t* stats);
+void DeleteNode(BstNode_t** node, BstStats_t* stats);
 void DeleteSubtree(BstNode_t* root);
 void DeleteTree(BstNode_t** root);
 BstNode_t* SearchNode(BstNode_t* root, const char* name);
 
 BstNode_t* GetMin(BstNode_t* root);
 BstNode_t* GetMax(BstNode_t* root);
+void DestroyBstStats(BstStats_t* stats);
+void FormatBstStats(BstStats_t* stats, char* buff, size_t size);
 void PrintTree(BstNode_t* root);
 
 #endif
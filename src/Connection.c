@@ -0,0 +1,265 @@
+#include "Connection.h"
+
+Connection_t connections[MAX_CONNECTIONS];		// Slots for connections opened by clients
+
+
+// Sets all connection slots as free and initializes their mutexes
+int InitializeConnections()
+{
+	for(int i = 0; i < MAX_CONNECTIONS; i++)
+	{
+		memset(&connections[i], 0, sizeof(Connection_t));
+		connections[i].sock = connections[i].passedFd = -1;
+
+		if(pthread_mutex_init(&connections[i].mutx, NULL) != 0 || pthread_mutex_init(&connections[i].sendMutx, NULL) != 0)
+		{
+			fprintf(stderr, "Error: cannot initialize mutex for connection %d...\n", i + 1);
+			for(int j = 0; j < i; j++)
+			{
+				pthread_mutex_destroy(&connections[j].mutx);
+				pthread_mutex_destroy(&connections[j].sendMutx);
+			}
+
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+
+// Closes all connections still open and destroys their mutexes
+void DestroyConnections()
+{
+	for(int i = 0; i < MAX_CONNECTIONS; i++)
+	{
+		if(connections[i].sock != -1)
+			close(connections[i].sock);
+
+		if(connections[i].passedFd != -1)
+			close(connections[i].passedFd);
+
+		connections[i].sock = connections[i].passedFd = -1;
+		pthread_mutex_destroy(&connections[i].mutx);
+		pthread_mutex_destroy(&connections[i].sendMutx);
+	}
+}
+
+
+// Accepts a new connection from listenSock and stores it in a free slot, returns NULL if accept fails or there are no free slots
+Connection_t* AcceptConnection(int listenSock, Transport_t transport)
+{
+	int sock = accept(listenSock, NULL, NULL);
+	if(sock == -1)
+		return NULL;
+
+	for(int i = 0; i < MAX_CONNECTIONS; i++)
+	{
+		Connection_t* conn = &connections[i];
+		pthread_mutex_lock(&conn->mutx);
+
+		if(conn->sock == -1)					// If slot is free then use it for the new connection
+		{
+			conn->sock = sock;
+			conn->transport = transport;
+			conn->closing = 0;
+			conn->inFlight = 0;
+			conn->passedFd = -1;
+			conn->received = 0;
+			pthread_mutex_unlock(&conn->mutx);
+
+			if(transport == TCP_TRANSPORT)			// Responses are small, don't let Nagle's algorithm delay them
+			{
+				int noDelay = 1;
+				setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(int));
+			}
+
+			return conn;
+		}
+
+		pthread_mutex_unlock(&conn->mutx);
+	}
+
+	fprintf(stderr, "Warning: too many connections, new connection has been refused\n");
+	close(sock);
+	return NULL;
+}
+
+
+// Reads from conn without blocking, returns 1 if a whole packet has been received (and stores it in pack), 0 if more data is needed
+// and -1 if the connection has been closed by the client or an error occurred (in such case CloseConnection() should be called)
+int ReadFromConnection(Connection_t* conn, Packet_t* pack)
+{
+	if(conn == NULL || conn->sock == -1 || pack == NULL)
+		return -1;
+
+	if(conn->transport == UNIX_TRANSPORT)				// Seqpacket sockets preserve message boundaries, no framing is needed
+	{
+		struct iovec data;
+		data.iov_base = pack;
+		data.iov_len = sizeof(Packet_t);
+
+		union {							// Client may pass a descriptor with the packet (see SendPacketWithFd())
+			char buffer[CMSG_SPACE(sizeof(int))];
+			struct cmsghdr align;
+		} control;
+
+		struct msghdr msg;
+		memset(&msg, 0, sizeof(struct msghdr));
+		msg.msg_iov = &data;
+		msg.msg_iovlen = 1;
+		msg.msg_control = control.buffer;
+		msg.msg_controllen = sizeof(control.buffer);
+
+		ssize_t bytesReceived = recvmsg(conn->sock, &msg, MSG_DONTWAIT | MSG_CMSG_CLOEXEC);
+		if(bytesReceived == -1)
+			return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? 0 : -1;
+
+		struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+		if(cmsg != NULL && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS && cmsg->cmsg_len == CMSG_LEN(sizeof(int)))
+		{
+			if(conn->passedFd != -1)			// Descriptor passed with a previous packet has not been used
+				close(conn->passedFd);
+
+			memcpy(&conn->passedFd, CMSG_DATA(cmsg), sizeof(int));
+		}
+
+		return bytesReceived == sizeof(Packet_t) ? 1 : -1;
+	}
+
+	while(conn->received < sizeof(conn->frame))
+	{
+		size_t toRead = sizeof(conn->frame) - conn->received;
+		if(conn->received < FRAME_HEADER_SIZE)			// Read header alone so that we never consume bytes of the next frame
+			toRead = FRAME_HEADER_SIZE - conn->received;
+
+		ssize_t bytesReceived = recv(conn->sock, conn->frame + conn->received, toRead, MSG_DONTWAIT);
+		if(bytesReceived == 0)
+			return -1;
+
+		if(bytesReceived == -1)
+			return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? 0 : -1;
+
+		conn->received += bytesReceived;
+
+		if(conn->received == FRAME_HEADER_SIZE)			// Check that frame contains a packet
+		{
+			uint32_t length;
+			memcpy(&length, conn->frame, FRAME_HEADER_SIZE);
+			if(ntohl(length) != sizeof(Packet_t))
+				return -1;
+		}
+	}
+
+	memcpy(pack, conn->frame + FRAME_HEADER_SIZE, sizeof(Packet_t));
+	conn->received = 0;
+	return 1;
+}
+
+
+// Marks conn as closed, the socket is closed immediately if there are no requests in flight otherwise by the last ReleaseConnection()
+void CloseConnection(Connection_t* conn)
+{
+	if(conn == NULL)
+		return;
+
+	pthread_mutex_lock(&conn->mutx);
+	conn->closing = 1;
+
+	if(conn->passedFd != -1)
+	{
+		close(conn->passedFd);
+		conn->passedFd = -1;
+	}
+
+	if(conn->inFlight == 0 && conn->sock != -1)
+	{
+		close(conn->sock);
+		conn->sock = -1;
+	}
+
+	pthread_mutex_unlock(&conn->mutx);
+}
+
+
+// Signals that a request received from conn has been handed to a worker
+void AcquireConnection(Connection_t* conn)
+{
+	if(conn == NULL)
+		return;
+
+	pthread_mutex_lock(&conn->mutx);
+	conn->inFlight++;
+	pthread_mutex_unlock(&conn->mutx);
+}
+
+
+// Signals that the response for a request received from conn has been sent
+void ReleaseConnection(Connection_t* conn)
+{
+	if(conn == NULL)
+		return;
+
+	pthread_mutex_lock(&conn->mutx);
+	conn->inFlight--;
+
+	if(conn->closing == 1 && conn->inFlight == 0 && conn->sock != -1)	// If client has gone then free the slot
+	{
+		close(conn->sock);
+		conn->sock = -1;
+	}
+
+	pthread_mutex_unlock(&conn->mutx);
+}
+
+
+// Sends pack on conn without blocking, returns 0 on failure 1 otherwise. Caller must hold a request in flight on conn (or be the
+// dispatcher, the only one that closes connections), so the socket can't be closed while sending and conn->mutx is not needed. The
+// socket buffer is the only room for responses of a client: if it doesn't read them until the buffer is full the send fails, so a
+// slow reader never holds a worker or the dispatcher (which waits for sendMutx at most while another thread completes a send that
+// doesn't block). After a failed send part of a frame may have been sent, so the connection is shut down and the dispatcher closes
+// it when poll() reports it
+int SendOnConnection(Connection_t* conn, Packet_t* pack)
+{
+	if(conn == NULL || pack == NULL)
+		return 0;
+
+	pthread_mutex_lock(&conn->sendMutx);				// Frames of different threads must not be interleaved
+
+	int sent = 0;
+	if(conn->sock != -1 && conn->transport == UNIX_TRANSPORT)	// Client may have closed only its side of the connection, try anyway
+		sent = send(conn->sock, pack, sizeof(Packet_t), MSG_DONTWAIT | MSG_NOSIGNAL) == sizeof(Packet_t);
+	else if(conn->sock != -1)
+		sent = SendFramedPacket(conn->sock, pack, MSG_DONTWAIT);
+
+	if(sent == 0 && conn->sock != -1)				// Client must notice that a response has been lost
+		shutdown(conn->sock, SHUT_RDWR);
+
+	pthread_mutex_unlock(&conn->sendMutx);
+	return sent;
+}
+
+
+// Adds to fds the sockets of all open connections (and in conns the corresponding connection), returns number of fds added
+int GetConnectionsPollSet(struct pollfd* fds, Connection_t** conns, int maxFds)
+{
+	int fdsNum = 0;
+
+	for(int i = 0; i < MAX_CONNECTIONS && fdsNum < maxFds; i++)
+	{
+		pthread_mutex_lock(&connections[i].mutx);
+
+		if(connections[i].sock != -1 && connections[i].closing == 0)
+		{
+			fds[fdsNum].fd = connections[i].sock;
+			fds[fdsNum].events = POLLIN;
+			fds[fdsNum].revents = 0;
+			conns[fdsNum] = &connections[i];
+			fdsNum++;
+		}
+
+		pthread_mutex_unlock(&connections[i].mutx);
+	}
+
+	return fdsNum;
+}
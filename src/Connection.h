@@ -0,0 +1,44 @@
+// This file contains the definition of the Connection_t struct, it is used by the server to keep track of the long-lived stream connections
+// opened by clients. A connection can have many requests in flight (pipelining), each one of them is handled by a worker that sends the
+// response on the connection as soon as it is ready, so responses can be sent in a different order from the one of requests
+
+#ifndef CONNECTION_H
+#define CONNECTION_H
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <poll.h>
+#include <sys/socket.h>
+
+#include "Packet.h"
+#include "Utility.h"
+#include "Constants.h"
+
+typedef struct _Connection {
+	int sock;						// Socket of the connection (-1 if this slot is not used)
+	Transport_t transport;					// Transport used by the client on this connection
+	int closing;						// Set when client closes the connection, slot is freed when there are no requests in flight
+	int inFlight;						// Number of requests received from this connection whose response has not been sent yet
+	int passedFd;						// Descriptor received with last packet on a unix connection (-1 if none)
+	size_t received;					// Number of bytes of the current frame that have been received
+	unsigned char frame[FRAME_HEADER_SIZE + sizeof(Packet_t)];	// Buffer in which the current frame is accumulated
+	pthread_mutex_t mutx;					// Mutex to regulate changes of sock, inFlight and closing
+	pthread_mutex_t sendMutx;				// Mutex to serialize responses, held only by non-blocking sends
+} Connection_t;
+
+int InitializeConnections();
+void DestroyConnections();
+Connection_t* AcceptConnection(int listenSock, Transport_t transport);
+int ReadFromConnection(Connection_t* conn, Packet_t* pack);
+void CloseConnection(Connection_t* conn);
+void AcquireConnection(Connection_t* conn);
+void ReleaseConnection(Connection_t* conn);
+int SendOnConnection(Connection_t* conn, Packet_t* pack);
+int GetConnectionsPollSet(struct pollfd* fds, Connection_t** conns, int maxFds);
+
+extern Connection_t connections[MAX_CONNECTIONS];
+
+#endif
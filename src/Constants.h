@@ -11,9 +11,35 @@
 #define MAX_RESPONSE_SIZE 	MAX_NAME_SIZE + MAX_PHONE_NUM_SIZE + 32		
 #define SERVER_PORT_NUM		"9090"						// Port number used by the server
 #define SERVER_ADDRESS		"127.0.0.1"					// Ip address of the server
+#define SERVER_SOCKET_PATH	"/tmp/phonebook.sock"				// Path of the unix socket used by clients on the same host of the server
 #define MAX_CLIENT_NUM		4						// Max number of clients that the server can handle concurrently
+#define MAX_SESSIONS		1024						// Max number of sessions that can be open at the same time (must be <= 65536)
+#define SESSION_TTL		1800						// Seconds after which a session that has not been used expires
+#define DEFAULT_ADMIN_NAME	"admin"						// Username of the credential created when credentials file is empty
+#define DEFAULT_ADMIN_PASSWORD	"0000"						// Password of the credential created when credentials file is empty
+#define PERMISSION_READ		0x1						// Bit of a permission mask that allows to get contacts
+#define PERMISSION_WRITE	0x2						// Bit of a permission mask that allows to add and remove contacts
+#define PERMISSION_ADMIN	0x4						// Bit of a permission mask that allows to query server's internals (only DEFAULT_ADMIN_NAME)
 #define SEPARATOR_CHAR		';'						// Character used in files to separate fields of the same entry
 #define REMOVED_CHAR		'|'						// Character used in files to mark an entry as removed (canceled by a user)
+#define MAX_CONNECTIONS		64						// Max number of stream connections that the server keeps open at the same time
+#define AVG_ENTRY_SIZE		20						// Average size of an entry in data file, used to estimate number of contacts
+#define DEFAULT_CACHE_SIZE	16384						// Default number of GET_CONTACT responses that server keeps cached
+#define SHM_POLL_INTERVAL	100						// Max time (ms) that a thread serving a shared memory client sleeps without checking if it must stop
+#define DEFAULT_QUEUE_SIZE	256						// Default max number of requests waiting for a worker, server answers BUSY to the others
+#define MAX_WRITE_BATCH		64						// Max number of writes executed by a worker in a single exclusive section
+#define DEFAULT_WRITE_DELAY	2						// Default max time (ms) that a write waits while reads are served before it
+#define MAX_DATAGRAM_BATCH	64						// Max number of datagrams that server reads before checking other sockets
+#define BUSY_RETRIES		5						// Number of times tester resends a request refused because server was busy
+#define BUSY_BACKOFF		1000						// Microseconds that tester waits before first retry (doubled at each retry)
+#define DEFAULT_LOG_LEVEL	1						// Default verbosity of access log (0 disabled, 1 writes and logins, 2 all requests)
+#define DEFAULT_SLOW_THRESHOLD	100						// Default time (ms) above which a request is logged as slow
+#define RESPONSE_TIMEOUT	10000						// Time (ms) that a client waits for a response, server drops requests older than this
+#define MAX_PENDING_REQUESTS	64						// Max number of requests that a client can keep in flight on a single socket
+#define DEFAULT_LOAD_SOCKETS	4						// Default number of sockets used by tester to send open-loop load
+#define DEFAULT_SWEEP_CLIENTS	1024						// Default max number of virtual clients simulated by tester's sweep
+#define SOAK_DRIFT_THRESHOLD	10						// Change (%) between start and end of a soak run above which tester reports drift
+#define DEFAULT_LOAD_KEYS	1000						// Number of synthetic names used by tester when no phonebook file is given
 
 
 // Note: in MAX_..._SIZE macros the terminator '\0' is intended to be included in that amount of bytes
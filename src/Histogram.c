@@ -0,0 +1,108 @@
+#include "Histogram.h"
+
+// Returns index of the bucket that contains value
+static size_t GetBucketIndex(uint64_t value)
+{
+	if(value < HISTOGRAM_SUB_BUCKETS)					// Small values have a bucket each
+		return value;
+
+	if(value >= (1ULL << HISTOGRAM_MAX_BITS))
+		value = (1ULL << HISTOGRAM_MAX_BITS) - 1;
+
+	int shift = (63 - __builtin_clzll(value)) - HISTOGRAM_SUB_BITS;	// Width of buckets of the range of value is 2^shift
+	return ((size_t)(shift + 1) << HISTOGRAM_SUB_BITS) + ((value >> shift) - HISTOGRAM_SUB_BUCKETS);
+}
+
+
+// Returns the value in the middle of bucket with given index
+static uint64_t GetBucketValue(size_t index)
+{
+	if(index < HISTOGRAM_SUB_BUCKETS)
+		return index;
+
+	int shift = (int)(index >> HISTOGRAM_SUB_BITS) - 1;
+	uint64_t lower = (uint64_t)(HISTOGRAM_SUB_BUCKETS + (index & (HISTOGRAM_SUB_BUCKETS - 1))) << shift;
+	return lower + ((1ULL << shift) >> 1);
+}
+
+
+// Sets all counts of histogram to 0
+void ResetHistogram(Histogram_t* histogram)
+{
+	for(size_t i = 0; i < HISTOGRAM_BUCKETS; i++)
+		atomic_store_explicit(&histogram->counts[i], 0, memory_order_relaxed);
+
+	atomic_store(&histogram->total, 0);
+	atomic_store(&histogram->sum, 0);
+	atomic_store(&histogram->max, 0);
+}
+
+
+// Records value in histogram (it can be called concurrently by many threads)
+void RecordValue(Histogram_t* histogram, uint64_t value)
+{
+	atomic_fetch_add_explicit(&histogram->counts[GetBucketIndex(value)], 1, memory_order_relaxed);
+	atomic_fetch_add_explicit(&histogram->total, 1, memory_order_relaxed);
+	atomic_fetch_add_explicit(&histogram->sum, value, memory_order_relaxed);
+
+	uint64_t max = atomic_load_explicit(&histogram->max, memory_order_relaxed);
+	while(value > max && atomic_compare_exchange_weak_explicit(&histogram->max, &max, value, memory_order_relaxed, memory_order_relaxed) == 0);
+}
+
+
+// Stores in delta the values recorded in histogram since the last call (previous holds a copy of histogram made by that call), used to
+// get the distribution of each interval of a run while values are still being recorded. Max of delta is the max of the whole histogram
+void GetHistogramDelta(Histogram_t* histogram, Histogram_t* previous, Histogram_t* delta)
+{
+	uint64_t total = 0;
+	for(size_t i = 0; i < HISTOGRAM_BUCKETS; i++)
+	{
+		uint64_t count = atomic_load_explicit(&histogram->counts[i], memory_order_relaxed);
+		uint64_t before = atomic_load_explicit(&previous->counts[i], memory_order_relaxed);
+
+		atomic_store_explicit(&delta->counts[i], count - before, memory_order_relaxed);
+		atomic_store_explicit(&previous->counts[i], count, memory_order_relaxed);
+		total += count - before;
+	}
+
+	uint64_t sum = atomic_load(&histogram->sum);
+	atomic_store(&delta->total, total);					// Computed from counts, so that it matches them
+	atomic_store(&delta->sum, sum - atomic_load(&previous->sum));
+	atomic_store(&delta->max, atomic_load(&histogram->max));
+	atomic_store(&previous->sum, sum);
+}
+
+
+// Returns the value below which there are percentile % of the recorded values (0 if histogram is empty)
+uint64_t GetPercentile(Histogram_t* histogram, double percentile)
+{
+	uint64_t total = atomic_load(&histogram->total);
+	if(total == 0)
+		return 0;
+
+	uint64_t rank = (uint64_t)(percentile / 100.0 * total + 0.5);	// Number of values that must be below result
+	if(rank == 0)
+		rank = 1;
+
+	uint64_t seen = 0;
+	for(size_t i = 0; i < HISTOGRAM_BUCKETS; i++)
+	{
+		seen += atomic_load_explicit(&histogram->counts[i], memory_order_relaxed);
+		if(seen >= rank)
+		{
+			uint64_t value = GetBucketValue(i);
+			uint64_t max = atomic_load(&histogram->max);
+			return value < max ? value : max;
+		}
+	}
+
+	return atomic_load(&histogram->max);				// Counts may be updated while we read them
+}
+
+
+// Writes in buff a short summary of histogram (values are converted to microseconds)
+void FormatHistogram(Histogram_t* histogram, char* buff, size_t size)
+{
+	snprintf(buff, size, "n=%lu p50=%.1f p99=%.1f p999=%.1f us", (unsigned long) atomic_load(&histogram->total),
+		GetPercentile(histogram, 50.0) / 1000.0, GetPercentile(histogram, 99.0) / 1000.0, GetPercentile(histogram, 99.9) / 1000.0);
+}
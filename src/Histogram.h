@@ -0,0 +1,31 @@
+// This file contains the definition of the Histogram_t struct, a log-linear histogram (like HdrHistogram) that records latencies in
+// nanoseconds with a relative error of at most 1 / 2^HISTOGRAM_SUB_BITS. Values are split in ranges [2^k, 2^(k+1)) and each range is split
+// in 2^HISTOGRAM_SUB_BITS buckets of the same width, so memory is fixed and recording a value is a couple of shifts and an atomic add
+
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#define HISTOGRAM_SUB_BITS	5					// Each power of 2 range is split in 2^HISTOGRAM_SUB_BITS buckets
+#define HISTOGRAM_MAX_BITS	40					// Values greater than 2^HISTOGRAM_MAX_BITS (~18 minutes) are recorded as the max
+#define HISTOGRAM_SUB_BUCKETS	(1 << HISTOGRAM_SUB_BITS)
+#define HISTOGRAM_BUCKETS	((HISTOGRAM_MAX_BITS - HISTOGRAM_SUB_BITS + 1) * HISTOGRAM_SUB_BUCKETS)
+
+typedef struct _Histogram {
+	_Atomic uint64_t counts[HISTOGRAM_BUCKETS];			// Number of values recorded in each bucket
+	_Atomic uint64_t total;						// Number of values recorded
+	_Atomic uint64_t sum;						// Sum of all values recorded
+	_Atomic uint64_t max;						// Greatest value recorded
+} Histogram_t;
+
+void ResetHistogram(Histogram_t* histogram);
+void RecordValue(Histogram_t* histogram, uint64_t value);
+void GetHistogramDelta(Histogram_t* histogram, Histogram_t* previous, Histogram_t* delta);
+uint64_t GetPercentile(Histogram_t* histogram, double percentile);
+void FormatHistogram(Histogram_t* histogram, char* buff, size_t size);
+
+#endif
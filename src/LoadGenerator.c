@@ -0,0 +1,556 @@
+#include "LoadGenerator.h"
+
+typedef struct _InFlight {
+	_Atomic uint32_t id;				// Id of the request that uses the slot (0 while slot is being written or after response)
+	uint64_t index;					// Position of the request in the schedule of the socket
+	uint64_t sendTime;				// Time at which the request has been sent
+} InFlight_t;
+
+typedef struct _LoadSocket {
+	ServerLink_t link;				// Connection used to send requests and receive responses
+	pthread_t sender;				// Thread that sends requests on schedule
+	pthread_t receiver;				// Thread that receives responses
+	int index;					// Position of socket, used to interleave its schedule with the other sockets
+	uint64_t count;					// Number of requests that socket has to send
+	InFlight_t* window;				// Requests that may still be answered, request with id k uses slot k & windowMask
+	uint64_t windowMask;				// Size of window minus one (size is a power of two)
+	_Atomic uint64_t sent;				// Requests sent on socket
+	_Atomic uint64_t received;			// Responses received on socket
+	_Atomic uint64_t lastReply;			// Time at which last response has been received
+	_Atomic int stop;				// Set by main thread when receiver must quit
+	uint64_t start;					// Time at which the load starts
+	LoadConfig_t* config;
+	LoadStats_t* stats;
+} LoadSocket_t;
+
+typedef struct _LoadClient {
+	ServerLink_t link;				// Connection used by the virtual client
+	pthread_t tid;					// Thread that simulates the client
+	int index;					// Position of client, used to seed its choices
+	uint64_t start;					// Time at which client starts sending requests
+	uint64_t end;					// Time after which client stops sending requests
+	LoadConfig_t* config;
+	LoadStats_t* stats;
+} LoadClient_t;
+
+static void* SendLoad(void* arg);
+static void* ReceiveLoad(void* arg);
+static void* SimulateClient(void* arg);
+static void RecordIntervals(LoadConfig_t* config, LoadStats_t* stats, Histogram_t* histogram, uint64_t start, uint64_t end);
+static uint64_t GetWindowSize(LoadConfig_t* config, uint64_t count);
+
+
+// Returns the time at which the i-th request of socket must be sent
+static uint64_t GetIntendedTime(LoadSocket_t* socket, uint64_t i)
+{
+	LoadConfig_t* config = socket->config;
+	double slot = (double) socket->index + (double) i * config->socketsNum;
+
+	if(config->trace != NULL)					// Keep the gaps between requests of the trace, scaled by speed
+		return socket->start + (uint64_t)((config->trace[(size_t) slot].arrivalNs - config->trace[0].arrivalNs) / config->speed);
+
+	return socket->start + (uint64_t)(slot * 1000000000.0 / config->rate);
+}
+
+
+// Sleeps until the monotonic clock reaches timeNs
+static void SleepUntil(uint64_t timeNs)
+{
+	struct timespec wakeUp;
+	wakeUp.tv_sec = timeNs / 1000000000ULL;
+	wakeUp.tv_nsec = timeNs % 1000000000ULL;
+
+	while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wakeUp, NULL) == EINTR);
+}
+
+
+// Chooses type of request according to the mix of config and its name according to the workload
+static void FillRequest(Packet_t* request, LoadConfig_t* config, unsigned int* seed)
+{
+	int pick = rand_r(seed) % (config->mix[0] + config->mix[1] + config->mix[2]);
+
+	memset(request->number, 0, MAX_PHONE_NUM_SIZE);
+	if(pick < config->mix[0])
+		request->type = GET_CONTACT;
+	else if(pick < config->mix[0] + config->mix[1])
+	{
+		request->type = ADD_CONTACT;
+		snprintf(request->number, MAX_PHONE_NUM_SIZE, "%010u", (unsigned int) rand_r(seed) % 1000000000U);
+	}
+	else
+		request->type = REMOVE_CONTACT;
+
+	ChooseKey(config->workload, request->type, request->name, seed);
+}
+
+
+// Returns 1 if config describes a load that can be sent
+static int IsLoadValid(LoadConfig_t* config)
+{
+	if(config->trace != NULL)
+		return config->traceLength > 0 && config->speed > 0 && config->socketsNum > 0;
+
+	return config->duration > 0 && config->socketsNum > 0 && config->workload != NULL && config->mix[0] >= 0 && config->mix[1] >= 0 &&
+		config->mix[2] >= 0 && config->mix[0] + config->mix[1] + config->mix[2] > 0;
+}
+
+
+// Counts response in stats according to its type
+static void CountResponse(LoadStats_t* stats, Packet_t* response)
+{
+	switch(response->type)
+	{
+		case ACCEPTED:
+			atomic_fetch_add(&stats->accepted, 1);
+			break;
+
+		case REJECTED:
+			atomic_fetch_add(&stats->rejected, 1);
+			break;
+
+		case BUSY:
+			atomic_fetch_add(&stats->busy, 1);
+			break;
+
+		default:
+			atomic_fetch_add(&stats->errors, 1);
+			break;
+	}
+}
+
+
+// Waits at most LOAD_POLL_INTERVAL ms for a response on link, returns 1 if one can be received without blocking
+static int WaitResponse(ServerLink_t* link)
+{
+	if(link->transport == SHM_TRANSPORT)
+		return ShmRingWait(&link->shm->responses, LOAD_POLL_INTERVAL);
+
+	struct pollfd pfd;
+	pfd.fd = link->sock;
+	pfd.events = POLLIN;
+	return poll(&pfd, 1, LOAD_POLL_INTERVAL) > 0;
+}
+
+
+// Sends load on config->socketsNum sockets at config->rate requests per second for config->duration seconds, then waits for the
+// responses (at most RESPONSE_TIMEOUT ms after the last request has been sent) and stores results in stats, returns 0 on failure
+int RunOpenLoop(LoadConfig_t* config, LoadStats_t* stats)
+{
+	if(config == NULL || stats == NULL || (config->rate <= 0 && config->trace == NULL) || IsLoadValid(config) == 0)
+	{
+		fprintf(stderr, "Error: invalid load configuration\n");
+		return 0;
+	}
+
+	memset(stats, 0, sizeof(LoadStats_t));
+	uint64_t total = config->trace != NULL ? config->traceLength : (uint64_t)(config->rate * config->duration);	// Requests of all sockets
+
+	LoadSocket_t* sockets = calloc(config->socketsNum, sizeof(LoadSocket_t));
+	if(sockets == NULL)
+	{
+		fprintf(stderr, "Error: cannot allocate array of sockets...\n");
+		return 0;
+	}
+
+	int opened = 0;
+	for(; opened < config->socketsNum; opened++)
+	{
+		LoadSocket_t* curr = &sockets[opened];
+		curr->index = opened;
+		curr->config = config;
+		curr->stats = stats;
+		curr->count = (uint64_t) opened < total ? (total - opened + config->socketsNum - 1) / config->socketsNum : 0;
+		curr->windowMask = GetWindowSize(config, curr->count) - 1;
+		curr->window = calloc(curr->windowMask + 1, sizeof(InFlight_t));
+
+		if(curr->window == NULL)
+		{
+			fprintf(stderr, "Error: cannot allocate memory to track requests of socket %d\n", opened);
+			break;
+		}
+
+		if(OpenServerLink(&curr->link, config->transport, SERVER_ADDRESS, SERVER_PORT_NUM) == 0)
+		{
+			free(curr->window);
+			break;
+		}
+	}
+
+	int started = 0;
+	if(opened == config->socketsNum)
+	{
+		uint64_t start = GetTimeNs() + 10000000ULL;			// Give threads some time to start
+		for(int i = 0; i < config->socketsNum; i++)
+			sockets[i].start = start;
+
+		for(; started < config->socketsNum; started++)
+		{
+			if(pthread_create(&sockets[started].receiver, NULL, ReceiveLoad, &sockets[started]) != 0)
+				break;
+
+			if(pthread_create(&sockets[started].sender, NULL, SendLoad, &sockets[started]) != 0)
+			{
+				atomic_store(&sockets[started].stop, 1);
+				pthread_join(sockets[started].receiver, NULL);
+				break;
+			}
+		}
+
+		if(started != config->socketsNum)
+			fprintf(stderr, "Error: creation of threads for socket %d failed\n", started);
+		else if(config->trace != NULL)
+			RecordIntervals(config, stats, &stats->corrected, start, GetIntendedTime(&sockets[(total - 1) % config->socketsNum],
+				(total - 1) / config->socketsNum));
+		else if(total > 0)						// Last second ends after the last request has been sent
+			RecordIntervals(config, stats, &stats->corrected, start, start + config->duration * 1000000000ULL);
+	}
+
+	for(int i = 0; i < started; i++)					// Wait until all requests have been sent
+		pthread_join(sockets[i].sender, NULL);
+
+	uint64_t deadline = GetTimeNs() + RESPONSE_TIMEOUT * 1000000ULL;	// Then wait responses of requests still in flight
+	for(int i = 0; i < started; i++)
+	{
+		while(atomic_load(&sockets[i].received) < atomic_load(&sockets[i].sent) && GetTimeNs() < deadline)
+			usleep(1000);
+	}
+
+	uint64_t lastReply = 0;
+	for(int i = 0; i < started; i++)
+	{
+		atomic_store(&sockets[i].stop, 1);
+		pthread_join(sockets[i].receiver, NULL);
+
+		stats->timeouts += atomic_load(&sockets[i].sent) - atomic_load(&sockets[i].received);
+		if(atomic_load(&sockets[i].lastReply) > lastReply)
+			lastReply = atomic_load(&sockets[i].lastReply);
+	}
+
+	if(started > 0 && lastReply > sockets[0].start)
+		stats->elapsedNs = lastReply - sockets[0].start;
+
+	for(int i = 0; i < opened; i++)
+	{
+		CloseServerLink(&sockets[i].link);
+		free(sockets[i].window);
+	}
+
+	free(sockets);
+	return started == config->socketsNum;
+}
+
+
+// Thread that sends the requests of a socket at the time they are scheduled, without waiting for responses
+static void* SendLoad(void* arg)
+{
+	LoadSocket_t* me = (LoadSocket_t*) arg;
+	LoadConfig_t* config = me->config;
+	unsigned int seed = (unsigned int) me->start ^ (unsigned int)(me->index * 2654435761U);
+
+	Packet_t request;
+	memset(&request, 0, sizeof(Packet_t));
+	request.sessionToken = config->sessionToken;
+	strncpy(request.clientName, DEFAULT_ADMIN_NAME, MAX_NAME_SIZE);
+
+	for(uint64_t i = 0; i < me->count; i++)
+	{
+		uint64_t intended = GetIntendedTime(me, i);
+		SleepUntil(intended);
+
+		if(atomic_load(&me->stats->stopped) == 1)			// Sampler ended the load
+			break;
+
+		if(config->trace != NULL)					// Replay request of the trace
+		{
+			TraceRecord_t* record = &config->trace[me->index + i * config->socketsNum];
+			request.type = record->type;
+			strncpy(request.name, record->name, MAX_NAME_SIZE);
+			snprintf(request.number, MAX_PHONE_NUM_SIZE, "%010u", (unsigned int) rand_r(&seed) % 1000000000U);
+		}
+		else
+			FillRequest(&request, config, &seed);
+
+		request.requestId = (uint32_t)(i % UINT32_MAX) + 1;		// Ids wrap in long runs, 0 is never used
+
+		uint64_t now = GetTimeNs();
+		InFlight_t* slot = &me->window[request.requestId & me->windowMask];	// Request that used it has timed out
+		atomic_store(&slot->id, 0);					// Late response of that request is discarded meanwhile
+		slot->index = i;
+		slot->sendTime = now;
+		atomic_store(&slot->id, request.requestId);			// Must be stored before response can arrive
+
+		uint64_t lag = now - intended;					// Tester is late if it can't keep up with the rate
+		uint64_t maxLag = atomic_load_explicit(&me->stats->maxLag, memory_order_relaxed);
+		while(lag > maxLag && atomic_compare_exchange_weak(&me->stats->maxLag, &maxLag, lag) == 0);
+
+		if(SendToServer(&me->link, &request) == 0)
+		{
+			atomic_fetch_add(&me->stats->errors, 1);
+			continue;
+		}
+
+		atomic_fetch_add(&me->sent, 1);
+		atomic_fetch_add(&me->stats->sent, 1);
+	}
+
+	return NULL;
+}
+
+
+// Thread that receives responses on a socket and records their latency until main thread sets stop
+static void* ReceiveLoad(void* arg)
+{
+	LoadSocket_t* me = (LoadSocket_t*) arg;
+	LoadStats_t* stats = me->stats;
+	Packet_t response;
+
+	while(atomic_load(&me->stop) == 0)
+	{
+		if(WaitResponse(&me->link) == 0)
+			continue;
+
+		if(ReceiveFromServer(&me->link, &response) == 0)		// Socket is broken, requests still in flight will time out
+		{
+			atomic_fetch_add(&stats->errors, 1);
+			break;
+		}
+
+		uint64_t now = GetTimeNs();
+		uint32_t id = response.requestId;
+		InFlight_t* slot = &me->window[id & me->windowMask];
+		if(id == 0)							// Requests never use id 0
+		{
+			atomic_fetch_add(&stats->errors, 1);
+			continue;
+		}
+
+		if(atomic_load(&slot->id) != id)				// Duplicated response, or late one whose slot has been reused
+			continue;						// (request is counted as timed out)
+
+		uint64_t index = slot->index;
+		uint64_t sendTime = slot->sendTime;
+		if(atomic_compare_exchange_strong(&slot->id, &id, 0) == 0)	// Slot has been reused while reading it
+			continue;
+
+		RecordValue(&stats->corrected, now - GetIntendedTime(me, index));
+		RecordValue(&stats->uncorrected, now - sendTime);
+
+		CountResponse(stats, &response);
+		atomic_store(&me->lastReply, now);
+		atomic_fetch_add(&me->received, 1);
+	}
+
+	return NULL;
+}
+
+
+// Simulates config->socketsNum clients that send requests back to back (each one waits the response before sending the next request)
+// for config->duration seconds, latencies are stored in stats->uncorrected, returns 0 on failure
+int RunClosedLoop(LoadConfig_t* config, LoadStats_t* stats)
+{
+	if(config == NULL || stats == NULL || IsLoadValid(config) == 0)
+	{
+		fprintf(stderr, "Error: invalid load configuration\n");
+		return 0;
+	}
+
+	memset(stats, 0, sizeof(LoadStats_t));
+
+	LoadClient_t* clients = calloc(config->socketsNum, sizeof(LoadClient_t));
+	if(clients == NULL)
+	{
+		fprintf(stderr, "Error: cannot allocate array of clients...\n");
+		return 0;
+	}
+
+	int opened = 0;
+	for(; opened < config->socketsNum; opened++)
+	{
+		clients[opened].index = opened;
+		clients[opened].config = config;
+		clients[opened].stats = stats;
+
+		if(OpenServerLink(&clients[opened].link, config->transport, SERVER_ADDRESS, SERVER_PORT_NUM) == 0)
+			break;
+	}
+
+	int started = 0;
+	if(opened == config->socketsNum)
+	{
+		uint64_t start = GetTimeNs() + 10000000ULL + config->socketsNum * 50000ULL;	// Give threads some time to start
+		for(int i = 0; i < config->socketsNum; i++)
+		{
+			clients[i].start = start;
+			clients[i].end = start + config->duration * 1000000000ULL;
+		}
+
+		for(; started < config->socketsNum; started++)
+		{
+			if(pthread_create(&clients[started].tid, NULL, SimulateClient, &clients[started]) != 0)
+			{
+				fprintf(stderr, "Error: creation of thread for client %d failed\n", started);
+				break;
+			}
+		}
+
+		stats->elapsedNs = config->duration * 1000000000ULL;
+		if(started == config->socketsNum)
+			RecordIntervals(config, stats, &stats->uncorrected, start, start + stats->elapsedNs);
+	}
+
+	for(int i = 0; i < started; i++)
+		pthread_join(clients[i].tid, NULL);
+
+	for(int i = 0; i < opened; i++)
+		CloseServerLink(&clients[i].link);
+
+	free(clients);
+	return started == config->socketsNum;
+}
+
+
+// Records throughput and latency (taken from histogram) of each second between start and end in stats, while load is running; calls
+// sampler of config every samplePeriod seconds and stops the load if it returns 0
+static void RecordIntervals(LoadConfig_t* config, LoadStats_t* stats, Histogram_t* histogram, uint64_t start, uint64_t end)
+{
+	Histogram_t* previous = calloc(2, sizeof(Histogram_t));		// Copy of histogram at the end of last interval and its delta
+	if(previous == NULL)
+		fprintf(stderr, "Error: cannot allocate histograms of intervals, throughput and latency of each second are not recorded\n");
+
+	Histogram_t* delta = previous + 1;
+	uint64_t answered = 0;
+	int seconds = 0;
+
+	for(uint64_t time = start + 1000000000ULL; time <= end; time += 1000000000ULL)
+	{
+		SleepUntil(time);
+		seconds++;
+
+		if(previous != NULL && stats->intervalsNum < LOAD_MAX_INTERVALS)
+		{
+			uint64_t now = atomic_load(&stats->accepted) + atomic_load(&stats->rejected) + atomic_load(&stats->busy);
+			GetHistogramDelta(histogram, previous, delta);
+
+			LoadInterval_t* interval = &stats->intervals[stats->intervalsNum++];
+			interval->throughput = (double)(now - answered);
+			interval->p50 = GetPercentile(delta, 50.0) / 1000.0;
+			interval->p99 = GetPercentile(delta, 99.0) / 1000.0;
+			answered = now;
+		}
+
+		if(config->sampler != NULL && config->samplePeriod > 0 && seconds % config->samplePeriod == 0 &&
+			config->sampler(stats, config->samplerArg) == 0)
+		{
+			atomic_store(&stats->stopped, 1);
+			break;
+		}
+
+		if(previous == NULL && config->sampler == NULL)			// Nothing else to do until the end of the load
+			break;
+	}
+
+	free(previous);
+}
+
+
+// Returns the number of requests of a socket (that sends count requests) that can be in flight, a power of two: requests not answered
+// within RESPONSE_TIMEOUT ms are timed out, so window holds twice the requests that socket sends in that time
+static uint64_t GetWindowSize(LoadConfig_t* config, uint64_t count)
+{
+	double rate = config->rate;
+	if(config->trace != NULL)						// Average rate of the trace, bursts are covered by the margin
+	{
+		uint64_t span = config->trace[config->traceLength - 1].arrivalNs - config->trace[0].arrivalNs;
+		rate = span > 0 ? config->traceLength * config->speed * 1000000000.0 / span : (double) config->traceLength;
+	}
+
+	double needed = 2.0 * rate / config->socketsNum * RESPONSE_TIMEOUT / 1000.0;
+	uint64_t size = 64;
+	while(size < count && size < needed)
+		size *= 2;
+
+	return size;
+}
+
+
+// Thread that simulates a virtual client of a closed-loop run
+static void* SimulateClient(void* arg)
+{
+	LoadClient_t* me = (LoadClient_t*) arg;
+	LoadStats_t* stats = me->stats;
+	unsigned int seed = (unsigned int) me->start ^ (unsigned int)(me->index * 2654435761U);
+
+	Packet_t request;
+	Packet_t response;
+	memset(&request, 0, sizeof(Packet_t));
+	request.sessionToken = me->config->sessionToken;
+	strncpy(request.clientName, DEFAULT_ADMIN_NAME, MAX_NAME_SIZE);
+
+	SleepUntil(me->start);
+
+	for(uint32_t id = 1; GetTimeNs() < me->end && atomic_load(&stats->stopped) == 0; id = id == UINT32_MAX ? 1 : id + 1)
+	{
+		FillRequest(&request, me->config, &seed);
+		request.requestId = id;
+
+		uint64_t sent = GetTimeNs();
+		if(SendToServer(&me->link, &request) == 0)
+		{
+			atomic_fetch_add(&stats->errors, 1);
+			break;
+		}
+
+		atomic_fetch_add(&stats->sent, 1);
+
+		int received;
+		while((received = ReceiveFromServer(&me->link, &response)) == 1 && response.requestId != id);	// Skip late responses
+
+		if(received == 0)
+		{
+			atomic_fetch_add(&stats->timeouts, 1);
+			continue;
+		}
+
+		RecordValue(&stats->uncorrected, GetTimeNs() - sent);
+		CountResponse(stats, &response);
+	}
+
+	return NULL;
+}
+
+
+// Prints results of an open-loop run
+void PrintLoadStats(LoadConfig_t* config, LoadStats_t* stats)
+{
+	double seconds = stats->elapsedNs / 1000000000.0;
+	uint64_t answered = atomic_load(&stats->accepted) + atomic_load(&stats->rejected) + atomic_load(&stats->busy);
+
+	if(config->trace != NULL)
+		printf("Replayed %lu requests at %.2fx speed on %d sockets\n", (unsigned long) config->traceLength, config->speed, config->socketsNum);
+	else
+	{
+		char workload[128];
+		FormatWorkload(config->workload, workload, sizeof(workload));
+		printf("Target rate: %.0f req/s for %d s on %d sockets (mix get/add/remove %d/%d/%d, %s)\n", config->rate, config->duration,
+			config->socketsNum, config->mix[0], config->mix[1], config->mix[2], workload);
+	}
+
+	printf("Sent: %lu, answered: %lu (accepted %lu, rejected %lu, busy %lu), errors: %lu, timeouts: %lu\n",
+		(unsigned long) atomic_load(&stats->sent), (unsigned long) answered, (unsigned long) atomic_load(&stats->accepted),
+		(unsigned long) atomic_load(&stats->rejected), (unsigned long) atomic_load(&stats->busy), (unsigned long) atomic_load(&stats->errors),
+		(unsigned long) atomic_load(&stats->timeouts));
+	printf("Achieved throughput: %.0f req/s, max sender lag: %.1f us\n", seconds > 0 ? answered / seconds : 0.0,
+		atomic_load(&stats->maxLag) / 1000.0);
+
+	printf("%-12s %10s %10s %10s %10s %10s %10s\n", "latency(us)", "p50", "p90", "p99", "p99.9", "p99.99", "max");
+
+	Histogram_t* histograms[] = { &stats->corrected, &stats->uncorrected };
+	char* names[] = { "corrected", "uncorrected" };
+	for(int i = 0; i < 2; i++)
+	{
+		printf("%-12s %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f\n", names[i], GetPercentile(histograms[i], 50.0) / 1000.0,
+			GetPercentile(histograms[i], 90.0) / 1000.0, GetPercentile(histograms[i], 99.0) / 1000.0,
+			GetPercentile(histograms[i], 99.9) / 1000.0, GetPercentile(histograms[i], 99.99) / 1000.0,
+			atomic_load(&histograms[i]->max) / 1000.0);
+	}
+}
@@ -0,0 +1,79 @@
+
+// This file contains the load generator used by the tester. In open loop each socket has a sender thread that sends requests on a fixed
+// schedule (socket k sends its i-th request at start + (k + i * socketsNum) / rate) whether or not previous requests have been answered,
+// and a receiver thread that matches responses to requests by requestId. Latency is measured from the time at which the request should
+// have been sent, so when the server (or the tester itself) falls behind the delay suffered by queued requests is not hidden
+// (the coordinated omission problem), the latency measured from the time the request was actually sent is reported too for comparison.
+// When a trace is replayed requests are taken from it and are sent keeping the gaps between their arrival times (divided by speed).
+// In closed loop instead each socket is a virtual client that sends its next request as soon as it receives the previous response.
+// Throughput and latency of each second of a run are recorded too, they are the samples used to compare runs. A sampler can be called
+// every few seconds while load is sent to look at the stats so far (and at the server) without stopping the load
+
+#ifndef LOAD_GENERATOR_H
+#define LOAD_GENERATOR_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "Constants.h"
+#include "ServerLink.h"
+#include "Histogram.h"
+#include "Workload.h"
+#include "Trace.h"
+
+#define LOAD_POLL_INTERVAL	100			// Max time (ms) that a receiver waits for a response without checking if it must stop
+#define LOAD_MAX_INTERVALS	3600			// Max number of seconds of a run whose throughput and latency are recorded
+
+struct _LoadStats;
+typedef int (*LoadSampler_t)(struct _LoadStats* stats, void* arg);	// Returns 0 to end the load before its duration
+
+typedef struct _LoadConfig {
+	double rate;					// Requests per second sent by all sockets together (not used in closed loop)
+	int duration;					// Seconds during which requests are sent
+	int socketsNum;					// Number of sockets used to send requests (one per virtual client in closed loop)
+	int mix[3];					// Weights of GET_CONTACT, ADD_CONTACT and REMOVE_CONTACT requests
+	Workload_t* workload;				// Chooses names used in requests
+	TraceRecord_t* trace;				// Requests to replay in open loop (NULL if requests are generated by workload)
+	size_t traceLength;				// Number of requests in trace
+	double speed;					// Trace is replayed speed times faster than it has been recorded
+	Transport_t transport;				// Transport used by sockets
+	uint64_t sessionToken;				// Session used by all requests
+	LoadSampler_t sampler;				// Called by main thread every samplePeriod seconds while load is sent (NULL if not used)
+	int samplePeriod;				// Seconds between calls of sampler
+	void* samplerArg;				// Argument passed to sampler
+} LoadConfig_t;
+
+typedef struct _LoadInterval {
+	double throughput;				// Responses per second received in the interval
+	double p50;					// Median latency (us) of the responses received in the interval
+	double p99;					// 99th percentile of latency (us) of the responses received in the interval
+} LoadInterval_t;
+
+typedef struct _LoadStats {
+	Histogram_t corrected;				// Latency measured from the time at which requests should have been sent
+	Histogram_t uncorrected;			// Latency measured from the time at which requests have been sent (the only one in closed loop)
+	_Atomic uint64_t sent;				// Requests sent
+	_Atomic uint64_t accepted;			// Responses of type ACCEPTED
+	_Atomic uint64_t rejected;			// Responses of type REJECTED (e.g. contact not found)
+	_Atomic uint64_t busy;				// Requests refused by server's admission control
+	_Atomic uint64_t errors;			// Requests that could not be sent and unexpected responses
+	_Atomic uint64_t timeouts;			// Requests without a response within RESPONSE_TIMEOUT ms
+	_Atomic uint64_t maxLag;			// Max delay (ns) between the time a request should have been sent and the time it has been sent
+	_Atomic int stopped;				// Set when sampler ends the load, requests not sent yet are dropped
+	uint64_t elapsedNs;				// Time between the first request and the last response
+	LoadInterval_t intervals[LOAD_MAX_INTERVALS];	// Results of each second of the run (latency is corrected in open loop)
+	int intervalsNum;				// Number of seconds recorded
+} LoadStats_t;
+
+int RunOpenLoop(LoadConfig_t* config, LoadStats_t* stats);
+int RunClosedLoop(LoadConfig_t* config, LoadStats_t* stats);
+void PrintLoadStats(LoadConfig_t* config, LoadStats_t* stats);
+
+#endif
@@ -1,15 +1,18 @@
-
 // This file contains definition of the Packet_t struct, this is the fundamental data type exchanged between clients and server to communicate
 
 #ifndef PACKET_H
 #define PACKET_H
 
+#include <stdint.h>
 #include "Constants.h"
 
-typedef enum { ADD_CONTACT, GET_CONTACT, REMOVE_CONTACT, LOGIN, ACCEPTED, REJECTED } RequestType_t;
+typedef enum { ADD_CONTACT, GET_CONTACT, REMOVE_CONTACT, LOGIN, ACCEPTED, REJECTED, ATTACH_SHM, BUSY, STATS } RequestType_t;
 
 typedef struct _Packet {
 	RequestType_t type;
+	uint32_t requestId;				// Id choosen by the client, the server copies it in the response so that it can be matched
+	uint64_t sessionToken;				// Token returned by the server on login, it must be presented with all other requests
+	uint32_t timeoutMs;				// Time (ms) after which client stops waiting for the response (0 means server's default)
 	char name[MAX_NAME_SIZE];
 	char number[MAX_PHONE_NUM_SIZE];
 	char clientName[MAX_NAME_SIZE];
@@ -0,0 +1,113 @@
+#include "PerfCounters.h"
+
+// Opens a counter of the calling thread that counts only in user space, returns its file descriptor or -1 if it is not available
+static int OpenCounter(uint32_t type, uint64_t config)
+{
+	struct perf_event_attr attr;
+	memset(&attr, 0, sizeof(struct perf_event_attr));
+	attr.size = sizeof(struct perf_event_attr);
+	attr.type = type;
+	attr.config = config;
+	attr.disabled = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+	return (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+
+// Opens all counters that are available, returns their number (0 if none can be read, e.g. kernel doesn't allow it)
+int OpenPerfCounters(PerfCounters_t* counters)
+{
+	if(counters == NULL)
+		return 0;
+
+	uint64_t llcMisses = PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+	uint64_t dtlbMisses = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+
+	counters->fds[COUNTER_CYCLES] = OpenCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+	counters->fds[COUNTER_INSTRUCTIONS] = OpenCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+	counters->fds[COUNTER_LLC_MISSES] = OpenCounter(PERF_TYPE_HW_CACHE, llcMisses);
+	counters->fds[COUNTER_BRANCH_MISSES] = OpenCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+	counters->fds[COUNTER_DTLB_MISSES] = OpenCounter(PERF_TYPE_HW_CACHE, dtlbMisses);
+	counters->fds[COUNTER_PAGE_FAULTS] = OpenCounter(PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS);
+
+	counters->available = 0;
+	for(int i = 0; i < COUNTERS_NUM; i++)
+	{
+		counters->values[i] = PERF_UNAVAILABLE;
+		if(counters->fds[i] != -1)
+			counters->available++;
+	}
+
+	return counters->available;
+}
+
+
+// Closes all counters
+void ClosePerfCounters(PerfCounters_t* counters)
+{
+	if(counters == NULL)
+		return;
+
+	for(int i = 0; i < COUNTERS_NUM; i++)
+	{
+		if(counters->fds[i] != -1)
+			close(counters->fds[i]);
+
+		counters->fds[i] = -1;
+	}
+
+	counters->available = 0;
+}
+
+
+// Resets and enables all counters available
+void StartPerfCounters(PerfCounters_t* counters)
+{
+	for(int i = 0; i < COUNTERS_NUM; i++)
+	{
+		if(counters->fds[i] == -1)
+			continue;
+
+		ioctl(counters->fds[i], PERF_EVENT_IOC_RESET, 0);
+		ioctl(counters->fds[i], PERF_EVENT_IOC_ENABLE, 0);
+	}
+}
+
+
+// Disables all counters available and stores their values (scaled if the kernel had to multiplex them because the PMU has fewer
+// registers than the counters opened)
+void StopPerfCounters(PerfCounters_t* counters)
+{
+	for(int i = 0; i < COUNTERS_NUM; i++)
+		if(counters->fds[i] != -1)
+			ioctl(counters->fds[i], PERF_EVENT_IOC_DISABLE, 0);
+
+	for(int i = 0; i < COUNTERS_NUM; i++)
+	{
+		uint64_t data[3];				// Value, time enabled and time running
+		counters->values[i] = PERF_UNAVAILABLE;
+
+		if(counters->fds[i] == -1 || read(counters->fds[i], data, sizeof(data)) != sizeof(data))
+			continue;
+
+		if(data[2] == 0)				// Counter has never been scheduled on the PMU
+			continue;
+
+		counters->values[i] = data[2] < data[1] ? (uint64_t)((double) data[0] * data[1] / data[2]) : data[0];
+	}
+}
+
+
+// Returns the name of a counter
+const char* GetCounterName(Counter_t counter)
+{
+	static const char* names[] = { "cycles", "instructions", "llc_misses", "branch_misses", "dtlb_misses", "page_faults" };
+
+	if((unsigned int) counter >= COUNTERS_NUM)
+		return "invalid";
+
+	return names[counter];
+}
@@ -0,0 +1,36 @@
+
+// This file contains the definition of the PerfCounters_t struct, it reads hardware performance counters of the calling thread with
+// perf_event_open() so that benchmarks can tell why an operation got faster or slower (more instructions, cache misses, ...). Counters
+// are opened one by one, so if the CPU (or the virtual machine, or perf_event_paranoid) doesn't allow some of them the others still
+// work, values of counters that are not available are reported as PERF_UNAVAILABLE. Only user space events are counted, so that
+// unprivileged users can read them. Page faults are a software event, usually available also when the CPU has no PMU
+
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#define PERF_UNAVAILABLE	UINT64_MAX		// Value of a counter that could not be opened
+
+typedef enum { COUNTER_CYCLES, COUNTER_INSTRUCTIONS, COUNTER_LLC_MISSES, COUNTER_BRANCH_MISSES, COUNTER_DTLB_MISSES, COUNTER_PAGE_FAULTS,
+	COUNTERS_NUM } Counter_t;
+
+typedef struct _PerfCounters {
+	int fds[COUNTERS_NUM];				// File descriptor of each counter (-1 if it is not available)
+	uint64_t values[COUNTERS_NUM];			// Values counted between last StartPerfCounters() and StopPerfCounters()
+	int available;					// Number of counters that have been opened
+} PerfCounters_t;
+
+int OpenPerfCounters(PerfCounters_t* counters);
+void ClosePerfCounters(PerfCounters_t* counters);
+void StartPerfCounters(PerfCounters_t* counters);
+void StopPerfCounters(PerfCounters_t* counters);
+const char* GetCounterName(Counter_t counter);
+
+#endif
@@ -1,5 +1,6 @@
 
 #include "Phonebook.h"
+#include "Probes.h"
 
 // Creates a new phonebook and loads data from filenames given as parameters
 Phonebook_t* CreatePhonebook(const char* pbFilename, const char* credentialsFilename)
@@ -13,6 +14,10 @@ Phonebook_t* CreatePhonebook(const char* pbFilename, const char* credentialsFile
 
 
 	newPb->dataTree = newPb->credentialsTree = NULL;					// Set tree's root to NULL
+	memset(&newPb->dataStats, 0, sizeof(BstStats_t));
+	memset(&newPb->credentialsStats, 0, sizeof(BstStats_t));
+	newPb->deferSync = newPb->dirty = 0;
+	newPb->dataBytes = newPb->deadBytes = 0;
 
 	newPb->dataFd = open(pbFilename, O_RDWR | O_CLOEXEC | O_CREAT, 0666);			// Open phonebook's data file
 	if(newPb->dataFd == -1)
@@ -31,6 +36,16 @@ Phonebook_t* CreatePhonebook(const char* pbFilename, const char* credentialsFile
 		return NULL;
 	}
 
+	struct stat dataInfo;								// Size filter on the number of contacts that data file may contain
+	size_t expectedContacts = fstat(newPb->dataFd, &dataInfo) == 0 ? dataInfo.st_size / AVG_ENTRY_SIZE : 0;
+	if(InitializeBloomFilter(&newPb->contactsFilter, expectedContacts) == 0)
+	{
+		close(newPb->dataFd);
+		close(newPb->credentialsFd);
+		free(newPb);
+		return NULL;
+	}
+
 	printf("loading data from files... ");
 	size_t read = 0;
 	read = LoadPhonebookFromFile(newPb);
@@ -38,7 +53,7 @@ Phonebook_t* CreatePhonebook(const char* pbFilename, const char* credentialsFile
 
 	read = LoadCredentialsFromFile(newPb);
 	if(read == 0)							// If credentials file has no content
-		AddCredential(newPb, "admin", "0000", "RW", 0, 1);	// Add a default credential
+		AddCredential(newPb, DEFAULT_ADMIN_NAME, DEFAULT_ADMIN_PASSWORD, "RW", 0, 1);	// Add a default credential
 
 	printf("read %lu bytes from %s\n", read, credentialsFilename);
 	return newPb;
@@ -53,8 +68,12 @@ void DestroyPhonebook(Phonebook_t** pb)
 
 	DeleteTree(&((*pb)->dataTree));				// Delete trees
 	DeleteTree(&((*pb)->credentialsTree));
+	DestroyBstStats(&(*pb)->dataStats);
+	DestroyBstStats(&(*pb)->credentialsStats);
 	close((*pb)->dataFd);					// Close file descriptors
 	close((*pb)->credentialsFd);
+	PrintBloomStats(&(*pb)->contactsFilter);
+	DestroyBloomFilter(&(*pb)->contactsFilter);
 
 	free(*pb);						// Deallocate phonebook
 	*pb = NULL;
@@ -67,17 +86,21 @@ int AddContact(Phonebook_t* pb, const char* name, const char* number, size_t off
 	if(pb == NULL || name == NULL || number == NULL)
 		return 0;
 
-	BstNode_t* newNode = AddNode(&(pb->dataTree), name, number, offset);	// Try to add a new node to bst
+	BstNode_t* newNode = AddNode(&(pb->dataTree), name, number, offset, &pb->dataStats);	// Try to add a new node to bst
 	if(newNode == NULL)
 		return 0;
 
+	BloomAdd(&pb->contactsFilter, name);
+
 	if(writeOnFile == 1)							// If specified then write new contact on file
 	{
 		char newEntry[MAX_NAME_SIZE + MAX_PHONE_NUM_SIZE + 3];		// Create new entry
 		sprintf(newEntry, "%s%c%s\n", name, SEPARATOR_CHAR, number);
 		offset = lseek(pb->dataFd, 0, SEEK_CUR);			// Get cursor's position
 		newNode->offset = offset;					// Set offset of new node to curr position of cursor in data file
-		WriteEntryOnFile(pb->dataFd, newEntry);				// Write new entry on file
+		WriteEntryOnFile(pb->dataFd, newEntry, pb->deferSync == 0);	// Write new entry on file
+		pb->dirty |= pb->deferSync;
+		pb->dataBytes += strlen(newEntry);
 	}
 	return 1;
 }
@@ -94,15 +117,62 @@ int RemoveContact(Phonebook_t* pb, const char* name)
 	if(toRemove == NULL)						// If node is not present in the tree
 		return 0;						// Return 0 because remove contact has failed
 
-	if(toRemove->father == NULL)					// If node is the root of the tree
-		pb->dataTree = NULL;
-
-	RemoveEntryFromFile(pb->dataFd, name, toRemove->offset);	// Remove entry from file
-	DeleteNode(&toRemove);						// Then delete the node
+	if(RemoveEntryFromFile(pb->dataFd, name, toRemove->offset, pb->deferSync == 0) == 1)	// Remove entry from file
+		pb->deadBytes += strlen(toRemove->name) + strlen(toRemove->number) + 2;		// Name, separator, number and newline
+	pb->dirty |= pb->deferSync;
+	BloomRemove(&pb->contactsFilter, name);
+	DeleteNode(toRemove == pb->dataTree ? &pb->dataTree : &toRemove, &pb->dataStats);	// Then delete the node
 	return 1;
 }
 
 
+// Searches contact with given name, names that are not in the phonebook are usually rejected by the filter without walking the tree
+BstNode_t* SearchContact(Phonebook_t* pb, const char* name)
+{
+	if(pb == NULL || name == NULL)
+		return NULL;
+
+	PROBE1(index_lookup_start, name);
+	if(BloomMayContain(&pb->contactsFilter, name) == 0)
+	{
+		PROBE2(index_lookup_done, name, -1);			// Rejected by the filter
+		return NULL;
+	}
+
+	BstNode_t* node = SearchNode(pb->dataTree, name);
+	if(node == NULL)
+		BloomFalsePositive(&pb->contactsFilter);
+
+	PROBE2(index_lookup_done, name, node != NULL);
+	return node;
+}
+
+
+// Flushes on disk the changes to data file made since last call (used when deferSync is 1), returns 0 on failure
+int FlushPhonebook(Phonebook_t* pb)
+{
+	if(pb == NULL)
+		return 0;
+
+	if(pb->dirty == 0)
+		return 1;
+
+	pb->dirty = 0;
+	PROBE1(file_fsync_start, pb->dataFd);
+	int synced = fsync(pb->dataFd) == 0;
+	PROBE1(file_fsync_done, pb->dataFd);
+	return synced;
+}
+
+
+// Writes in buff the size of data file, bytes taken by removed entries and their ratio on the size
+void FormatDataFileStats(Phonebook_t* pb, char* buff, size_t size)
+{
+	snprintf(buff, size, "bytes=%lu dead=%lu ratio=%.3f", (unsigned long) pb->dataBytes, (unsigned long) pb->deadBytes,
+		pb->dataBytes > 0 ? (double) pb->deadBytes / pb->dataBytes : 0.0);
+}
+
+
 // Adds a new node to the credential's bst and a new entry to the file
 int AddCredential(Phonebook_t* pb, const char* username, const char* password, const char* permissions, size_t offset, int writeOnFile)
 {
@@ -114,13 +184,13 @@ int AddCredential(Phonebook_t* pb, const char* username, const char* password, c
 		char newEntry[MAX_NAME_SIZE + MAX_PHONE_NUM_SIZE + 4];		// Create new entry
 		sprintf(newEntry, "%s%c%s%c%s\n", username, SEPARATOR_CHAR, password, SEPARATOR_CHAR, permissions);
 		offset = lseek(pb->credentialsFd, 0, SEEK_CUR);			// Get cursor's position
-		WriteEntryOnFile(pb->credentialsFd, newEntry);			// Write new entry on file
+		WriteEntryOnFile(pb->credentialsFd, newEntry, 1);			// Write new entry on file
 	}
 
 	char numberField[MAX_PHONE_NUM_SIZE];					// Concatenate password and permission (separated by '\0')
 	snprintf(numberField, MAX_PHONE_NUM_SIZE, "%s%c%s", password, '\0', permissions);
 
-	AddNode(&(pb->credentialsTree), username, numberField, offset);
+	AddNode(&(pb->credentialsTree), username, numberField, offset, &pb->credentialsStats);
 	return 1;
 }
 
@@ -158,6 +228,46 @@ int CheckPermission(Phonebook_t* pb, const char* username, RequestType_t request
 }
 
 
+// Checks that password is the one of username, returns 1 if it is, 0 if it is not and -1 if username is not in the credentials
+int CheckPassword(Phonebook_t* pb, const char* username, const char* password)
+{
+	if(pb == NULL || username == NULL || password == NULL)
+		return -1;
+
+	BstNode_t* node = SearchNode(pb->credentialsTree, username);
+	if(node == NULL)
+		return -1;
+
+	return strncmp(password, node->number, MAX_PASSWORD_SIZE) == 0 ? 1 : 0;
+}
+
+
+// Returns a bitmask of PERMISSION_... values that represents all permissions of username (0 if username is not in the credentials)
+unsigned int GetPermissionMask(Phonebook_t* pb, const char* username)
+{
+	if(pb == NULL || username == NULL)
+		return 0;
+
+	BstNode_t* node = SearchNode(pb->credentialsTree, username);
+	if(node == NULL)
+		return 0;
+
+	unsigned int mask = 0;
+	for(size_t i = strnlen(node->number, MAX_PASSWORD_SIZE) + 1; i < MAX_PHONE_NUM_SIZE; i++)	// Permissions follow the password
+	{
+		if(node->number[i] == 'R')
+			mask |= PERMISSION_READ;
+		else if(node->number[i] == 'W')
+			mask |= PERMISSION_WRITE;
+	}
+
+	if(strncmp(username, DEFAULT_ADMIN_NAME, MAX_NAME_SIZE) == 0)
+		mask |= PERMISSION_ADMIN;
+
+	return mask;
+}
+
+
 // Removes node from credential's bst and sign corresponding entry in file as canceled
 int RemoveCredential(Phonebook_t* pb, const char* username)
 {
@@ -169,11 +279,8 @@ int RemoveCredential(Phonebook_t* pb, const char* username)
 	if(toRemove == NULL)							// If node is not present in the tree
 		return 0;							// Return 0 because remove contact has failed
 
-	if(toRemove->father == NULL)						// If node is the root of the tree
-		pb->credentialsTree = NULL;
-
-	RemoveEntryFromFile(pb->credentialsFd, username, toRemove->offset);	// Remove entry from file
-	DeleteNode(&toRemove);							// Then delete the node
+	RemoveEntryFromFile(pb->credentialsFd, username, toRemove->offset, 1);	// Remove entry from file
+	DeleteNode(toRemove == pb->credentialsTree ? &pb->credentialsTree : &toRemove, &pb->credentialsStats);	// Then delete the node
 	return 1;
 }
 
@@ -192,6 +299,7 @@ size_t LoadPhonebookFromFile(Phonebook_t* pb)
 
 	size_t bytesReaded = 0;
 	size_t offset = 0;					// Keeps track of where we are in the file
+	size_t lineStart = 0;					// Offset of the entry that is being read
 	int state = 0;						// Keeps track of what we are reading (0 is name, 1 is number)
 	size_t j = 0;						// Index for nameBuff and numBuff
 
@@ -213,11 +321,13 @@ size_t LoadPhonebookFromFile(Phonebook_t* pb)
 					state = 0;
 					j = 0;
 
-					if(strlen(nameBuff) != 0 && strlen(numBuff) != 0)
+					if(strlen(nameBuff) != 0 && strlen(numBuff) != 0 && nameBuff[0] != REMOVED_CHAR)	// Skip removed entries
 					{
 						size_t entryOffset = offset - (strlen(nameBuff) + strlen(numBuff) + 1);
 						AddContact(pb, nameBuff, numBuff, entryOffset, 0);
-					}
+					} else
+						pb->deadBytes += offset + 1 - lineStart;
+					lineStart = offset + 1;
 					break;
 
 				default:
@@ -237,6 +347,7 @@ size_t LoadPhonebookFromFile(Phonebook_t* pb)
 		}
 	} while(bytesReaded != 0);
 
+	pb->dataBytes = offset;
 	return offset;
 }
 
@@ -282,7 +393,7 @@ size_t LoadCredentialsFromFile(Phonebook_t* pb)
 					state = 0;
 					j = 0;
 
-					if(strlen(nameBuff) != 0 && strlen(pswdBuff) != 0 && strlen(permBuff) != 0)
+					if(strlen(nameBuff) != 0 && strlen(pswdBuff) != 0 && strlen(permBuff) != 0 && nameBuff[0] != REMOVED_CHAR)
 					{
 						size_t entryOffset = offset - (strlen(nameBuff) + strlen(pswdBuff) + strlen(permBuff) + 2);
 						AddCredential(pb, nameBuff, pswdBuff, permBuff, entryOffset, 0);
@@ -316,20 +427,27 @@ size_t LoadCredentialsFromFile(Phonebook_t* pb)
 }
 
 
-// Inserts data in file
-int WriteEntryOnFile(int file, const char* data)
+// Inserts data in file (if sync is 1 waits until it is on disk)
+int WriteEntryOnFile(int file, const char* data, int sync)
 {
 	if(file == -1 || data == NULL)
 		return 0;
 
-	write(file, data, strlen(data));
-	fsync(file);						// Be sure to write modification on disk
+	ssize_t written = write(file, data, strlen(data));
+	PROBE2(file_write, file, written);
+
+	if(sync == 1)
+	{
+		PROBE1(file_fsync_start, file);
+		fsync(file);					// Be sure to write modification on disk
+		PROBE1(file_fsync_done, file);
+	}
 	return 1;
 }
 
 
-// Removes line that matches data from file
-int RemoveEntryFromFile(int file, const char* data, size_t offset)
+// Removes line that matches data from file (if sync is 1 waits until removal is on disk)
+int RemoveEntryFromFile(int file, const char* data, size_t offset, int sync)
 {
 	if(file == -1 || data == NULL)
 		return 0;
@@ -357,8 +475,15 @@ int RemoveEntryFromFile(int file, const char* data, size_t offset)
 	char removed = REMOVED_CHAR;
 
 	lseek(file, offset, SEEK_SET);
-	write(file, &removed, 1);				// Set entry as canceled
-	fsync(file);						// Be sure to write modification on disk
+	ssize_t written = write(file, &removed, 1);		// Set entry as canceled
+	PROBE2(file_write, file, written);
+
+	if(sync == 1)
+	{
+		PROBE1(file_fsync_start, file);
+		fsync(file);					// Be sure to write modification on disk
+		PROBE1(file_fsync_done, file);
+	}
 		
 	lseek(file, 0, SEEK_END);				// Move cursor back to end of file
 	return 1;
@@ -8,14 +8,23 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <sys/stat.h>
 #include "Bst.h"
 #include "Packet.h"
+#include "BloomFilter.h"
 
 typedef struct _Phonebook {
 	BstNode_t* dataTree;					// Bst that contains all phonebook's entries
 	BstNode_t* credentialsTree;				// Bst that contains all credentials for clients
+	BstStats_t dataStats;					// Shape of dataTree
+	BstStats_t credentialsStats;				// Shape of credentialsTree
 	int dataFd;						// File descriptor of file that contains phonebook's data
 	int credentialsFd;					// File descriptor of file that contains credentials
+	BloomFilter_t contactsFilter;				// Filter that contains names of all contacts in dataTree
+	int deferSync;						// If 1 changes to data file are flushed on disk only when FlushPhonebook() is called
+	int dirty;						// Indicates if data file has changes that have not been flushed yet
+	size_t dataBytes;					// Size of data file
+	size_t deadBytes;					// Bytes of data file taken by removed entries
 } Phonebook_t;
 
 Phonebook_t* CreatePhonebook(const char* pbFilename, const char* credentialsFilename);
@@ -23,15 +32,20 @@ void DestroyPhonebook(Phonebook_t** pb);
 
 int AddContact(Phonebook_t* pb, const char* name, const char* number, size_t offset, int writeOnFile);
 int RemoveContact(Phonebook_t* pb, const char* name);
+BstNode_t* SearchContact(Phonebook_t* pb, const char* name);
+int FlushPhonebook(Phonebook_t* pb);
+void FormatDataFileStats(Phonebook_t* pb, char* buff, size_t size);
 
 int AddCredential(Phonebook_t* pb, const char* username, const char* password, const char* permissions, size_t offset, int writeOnFile);
 int CheckPermission(Phonebook_t* pb, const char* username, RequestType_t request);
+int CheckPassword(Phonebook_t* pb, const char* username, const char* password);
+unsigned int GetPermissionMask(Phonebook_t* pb, const char* username);
 int RemoveCredential(Phonebook_t* pb, const char* username);
 
 
 size_t LoadPhonebookFromFile(Phonebook_t* pb);
 size_t LoadCredentialsFromFile(Phonebook_t* pb);
-int WriteEntryOnFile(int file, const char* data);
-int RemoveEntryFromFile(int file, const char* data, size_t offset);
+int WriteEntryOnFile(int file, const char* data, int sync);
+int RemoveEntryFromFile(int file, const char* data, size_t offset, int sync);
 
 #endif
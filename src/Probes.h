@@ -0,0 +1,27 @@
+// This file defines the USDT probes of the server (provider "phonebook"). When <sys/sdt.h> is available each probe is a single nop in the
+// code plus a note in the ELF file, tools like perf and bpftrace can attach to it at runtime (see traceLatency.bt); otherwise probes are
+// compiled out. Probe names can be listed with: bpftrace -l 'usdt:./Server:phonebook:*'
+
+#ifndef PROBES_H
+#define PROBES_H
+
+#if defined(__has_include)
+	#if __has_include(<sys/sdt.h>)
+		#include <sys/sdt.h>
+		#define PROBES_ENABLED
+	#endif
+#endif
+
+#ifdef PROBES_ENABLED
+	#define PROBE(name)				DTRACE_PROBE(phonebook, name)
+	#define PROBE1(name, a)				DTRACE_PROBE1(phonebook, name, a)
+	#define PROBE2(name, a, b)			DTRACE_PROBE2(phonebook, name, a, b)
+	#define PROBE3(name, a, b, c)			DTRACE_PROBE3(phonebook, name, a, b, c)
+#else
+	#define PROBE(name)				do {} while(0)
+	#define PROBE1(name, a)				do { (void)(a); } while(0)
+	#define PROBE2(name, a, b)			do { (void)(a); (void)(b); } while(0)
+	#define PROBE3(name, a, b, c)			do { (void)(a); (void)(b); (void)(c); } while(0)
+#endif
+
+#endif
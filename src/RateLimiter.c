@@ -0,0 +1,91 @@
+#include "RateLimiter.h"
+
+// Creates a limiter that allows each client to send rate requests per second with bursts of burst requests, returns NULL on failure
+RateLimiter_t* CreateRateLimiter(double rate, double burst)
+{
+	if(rate <= 0 || burst < 1)
+		return NULL;
+
+	RateLimiter_t* newLimiter = calloc(1, sizeof(RateLimiter_t));
+	if(newLimiter == NULL)
+	{
+		fprintf(stderr, "Error: cannot allocate memory to hold rate limiter\n");
+		return NULL;
+	}
+
+	newLimiter->rate = rate;
+	newLimiter->burst = burst;
+	return newLimiter;
+}
+
+
+// Deallocates limiter
+void DestroyRateLimiter(RateLimiter_t** limiter)
+{
+	if(limiter == NULL || *limiter == NULL)
+		return;
+
+	free(*limiter);
+	*limiter = NULL;
+}
+
+
+// Takes a token from the bucket of client with given key (key must not be 0), returns 0 if client has exceeded its rate
+// (a NULL limiter never refuses requests)
+int TakeToken(RateLimiter_t* limiter, uint64_t key, uint64_t nowNs)
+{
+	if(limiter == NULL)
+		return 1;
+
+	size_t index = ((key * 0x9e3779b97f4a7c15ULL) >> 32) & (RATE_LIMITER_BUCKETS - 1);	// Fibonacci hashing
+	TokenBucket_t* bucket = NULL;
+	TokenBucket_t* oldest = &limiter->buckets[index];
+
+	for(int i = 0; i < RATE_LIMITER_PROBES; i++)
+	{
+		TokenBucket_t* current = &limiter->buckets[(index + i) & (RATE_LIMITER_BUCKETS - 1)];
+		if(current->key == key)
+		{
+			bucket = current;
+			break;
+		}
+
+		if(current->lastRefillNs < oldest->lastRefillNs)	// Free buckets have lastRefillNs = 0 so they are choosen first
+			oldest = current;
+	}
+
+	if(bucket == NULL)						// New client (or client idle for long), it starts with a full bucket
+	{
+		bucket = oldest;
+		bucket->key = key;
+		bucket->lastRefillNs = 0;
+	}
+
+	return TakeBucketToken(limiter, bucket, nowNs);
+}
+
+
+// Takes a token from bucket, that is not stored in the table of limiter (a bucket whose lastRefillNs is 0 starts full), returns 0 if
+// its client has exceeded its rate (a NULL limiter never refuses requests)
+int TakeBucketToken(RateLimiter_t* limiter, TokenBucket_t* bucket, uint64_t nowNs)
+{
+	if(limiter == NULL)
+		return 1;
+
+	if(bucket->lastRefillNs == 0)
+	{
+		bucket->tokens = limiter->burst;
+		bucket->lastRefillNs = nowNs;
+	}
+
+	bucket->tokens += (nowNs - bucket->lastRefillNs) * limiter->rate / 1e9;
+	if(bucket->tokens > limiter->burst)
+		bucket->tokens = limiter->burst;
+	bucket->lastRefillNs = nowNs;
+
+	if(bucket->tokens < 1)
+		return 0;
+
+	bucket->tokens -= 1;
+	return 1;
+}
@@ -0,0 +1,33 @@
+// This file contains the definition of the RateLimiter_t struct, it keeps a token bucket for each client so that a single client that
+// sends too many requests can't fill the request queue and starve the others. Buckets are stored in a small open addressing table, when
+// the table is full the bucket that has been idle for longer is reused. The table is used only by the main thread so it needs no locks,
+// threads that serve shared memory clients keep the bucket of their client and use TakeBucketToken()
+
+#ifndef RATE_LIMITER_H
+#define RATE_LIMITER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#define RATE_LIMITER_BUCKETS	1024			// Max number of clients tracked at the same time (must be a power of 2)
+#define RATE_LIMITER_PROBES	8			// Max number of slots inspected to find the bucket of a client
+
+typedef struct _TokenBucket {
+	uint64_t key;					// Key of the client that owns the bucket (0 if bucket is not used)
+	double tokens;					// Requests that client can send without being refused
+	uint64_t lastRefillNs;				// Last time at which tokens have been refilled
+} TokenBucket_t;
+
+typedef struct _RateLimiter {
+	double rate;					// Tokens added to each bucket per second
+	double burst;					// Max number of tokens of a bucket
+	TokenBucket_t buckets[RATE_LIMITER_BUCKETS];
+} RateLimiter_t;
+
+RateLimiter_t* CreateRateLimiter(double rate, double burst);
+void DestroyRateLimiter(RateLimiter_t** limiter);
+int TakeToken(RateLimiter_t* limiter, uint64_t key, uint64_t nowNs);
+int TakeBucketToken(RateLimiter_t* limiter, TokenBucket_t* bucket, uint64_t nowNs);
+
+#endif
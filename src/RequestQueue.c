@@ -0,0 +1,178 @@
+#include "RequestQueue.h"
+
+// Creates a queue that can contain at most capacity reads and capacity writes, returns NULL on failure
+RequestQueue_t* CreateRequestQueue(size_t capacity, uint64_t maxWriteDelay)
+{
+	if(capacity == 0)
+		return NULL;
+
+	RequestQueue_t* newQueue = malloc(sizeof(RequestQueue_t));
+	if(newQueue == NULL)
+	{
+		fprintf(stderr, "Error: cannot allocate memory to hold request queue\n");
+		return NULL;
+	}
+
+	newQueue->reads.requests = malloc(sizeof(Request_t) * capacity);
+	newQueue->writes.requests = malloc(sizeof(Request_t) * capacity);
+	if(newQueue->reads.requests == NULL || newQueue->writes.requests == NULL)
+	{
+		fprintf(stderr, "Error: cannot allocate memory to hold request queue\n");
+		free(newQueue->reads.requests);
+		free(newQueue->writes.requests);
+		free(newQueue);
+		return NULL;
+	}
+
+	newQueue->reads.head = newQueue->reads.count = 0;
+	newQueue->writes.head = newQueue->writes.count = 0;
+	newQueue->capacity = capacity;
+	newQueue->maxWriteDelay = maxWriteDelay;
+	newQueue->writerActive = 0;
+	newQueue->writeBatches = newQueue->batchedWrites = 0;
+
+	if(pthread_mutex_init(&newQueue->mutx, NULL) != 0 || pthread_cond_init(&newQueue->hasWork, NULL) != 0)
+	{
+		fprintf(stderr, "Error: cannot initialize synch mechanism of request queue\n");
+		free(newQueue->reads.requests);
+		free(newQueue->writes.requests);
+		free(newQueue);
+		return NULL;
+	}
+
+	return newQueue;
+}
+
+
+// Deallocates queue (no thread must be waiting on it)
+void DestroyRequestQueue(RequestQueue_t** queue)
+{
+	if(queue == NULL || *queue == NULL)
+		return;
+
+	pthread_cond_destroy(&(*queue)->hasWork);
+	pthread_mutex_destroy(&(*queue)->mutx);
+	free((*queue)->reads.requests);
+	free((*queue)->writes.requests);
+	free(*queue);
+	*queue = NULL;
+}
+
+
+// Returns 1 if requests of given type modify the phonebook
+int IsWriteRequest(RequestType_t type)
+{
+	return type == ADD_CONTACT || type == REMOVE_CONTACT;
+}
+
+
+// Copies request at the end of the ring of its kind without waiting, returns 0 if ring is full
+int TryEnqueueRequest(RequestQueue_t* queue, Request_t* request)
+{
+	RequestRing_t* ring = IsWriteRequest(request->packet.type) ? &queue->writes : &queue->reads;
+
+	pthread_mutex_lock(&queue->mutx);
+	if(ring->count == queue->capacity)
+	{
+		pthread_mutex_unlock(&queue->mutx);
+		return 0;
+	}
+
+	memcpy(&ring->requests[(ring->head + ring->count) % queue->capacity], request, sizeof(Request_t));
+	ring->count++;
+	pthread_mutex_unlock(&queue->mutx);
+
+	pthread_cond_signal(&queue->hasWork);			// Wake up a worker
+	return 1;
+}
+
+
+// Moves the oldest count requests of ring in requests
+static void TakeFromRing(RequestQueue_t* queue, RequestRing_t* ring, Request_t* requests, int count)
+{
+	uint64_t now = GetTimeNs();
+
+	for(int i = 0; i < count; i++)
+	{
+		memcpy(&requests[i], &ring->requests[ring->head], sizeof(Request_t));
+		requests[i].timing.dequeued = now;
+		ring->head = (ring->head + 1) % queue->capacity;
+	}
+
+	ring->count -= count;
+}
+
+
+// Unlocks the mutex of a queue, used if a worker is cancelled while waiting
+static void UnlockQueue(void* queue)
+{
+	pthread_mutex_unlock(&((RequestQueue_t*) queue)->mutx);
+}
+
+
+// Waits until there is something to do and copies it in requests: either a single read or all waiting writes (at most maxRequests).
+// Returns number of requests copied, areWrites is set to 1 if they are writes (then EndWriteBatch() must be called when they are done)
+int DequeueRequests(RequestQueue_t* queue, Request_t* requests, int maxRequests, int* areWrites)
+{
+	int taken = 0;
+
+	pthread_mutex_lock(&queue->mutx);
+	pthread_cleanup_push(UnlockQueue, queue);
+
+	while(taken == 0)
+	{
+		int canWrite = queue->writes.count > 0 && queue->writerActive == 0;	// Only a batch at a time, next writes wait for it
+
+		if(canWrite && (queue->reads.count == 0 || GetTimeNs() - queue->writes.requests[queue->writes.head].timing.received >= queue->maxWriteDelay))
+		{
+			taken = queue->writes.count < (size_t) maxRequests ? (int) queue->writes.count : maxRequests;
+			TakeFromRing(queue, &queue->writes, requests, taken);
+			queue->writerActive = 1;
+			queue->writeBatches++;
+			queue->batchedWrites += taken;
+			*areWrites = 1;
+		} else if(queue->reads.count > 0)
+		{
+			TakeFromRing(queue, &queue->reads, requests, 1);
+			taken = 1;
+			*areWrites = 0;
+		} else {
+			pthread_cond_wait(&queue->hasWork, &queue->mutx);
+		}
+	}
+
+	pthread_cleanup_pop(1);
+	return taken;
+}
+
+
+// Signals that the batch of writes taken with DequeueRequests() has been executed, so that next writes can be taken
+void EndWriteBatch(RequestQueue_t* queue)
+{
+	pthread_mutex_lock(&queue->mutx);
+	queue->writerActive = 0;
+	pthread_mutex_unlock(&queue->mutx);
+
+	pthread_cond_broadcast(&queue->hasWork);
+}
+
+
+// Prints to stdout how many writes have been coalesced in batches
+void PrintQueueStats(RequestQueue_t* queue)
+{
+	if(queue == NULL)
+		return;
+
+	printf("Write batching: %lu writes in %lu batches (%.2f writes per flush)\n", queue->batchedWrites, queue->writeBatches,
+		queue->writeBatches == 0 ? 0.0 : queue->batchedWrites / (double) queue->writeBatches);
+}
+
+
+// Writes in buff a short summary of the state of queue
+void FormatQueueStats(RequestQueue_t* queue, char* buff, size_t size)
+{
+	pthread_mutex_lock(&queue->mutx);
+	snprintf(buff, size, "reads=%lu writes=%lu batches=%lu batched=%lu", (unsigned long) queue->reads.count,
+		(unsigned long) queue->writes.count, (unsigned long) queue->writeBatches, (unsigned long) queue->batchedWrites);
+	pthread_mutex_unlock(&queue->mutx);
+}
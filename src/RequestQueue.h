@@ -0,0 +1,59 @@
+// This file contains the definition of the RequestQueue_t struct, a bounded queue of requests shared by the main thread (that pushes
+// requests as soon as they are received) and the workers (that pop and satisfy them). The main thread never waits on the queue: when it is
+// full the request is refused immediately, so that the server answers BUSY instead of letting datagrams pile up in the kernel buffer.
+// Reads and writes are kept in separate rings: reads are served first (they can run concurrently), while all the writes that are waiting
+// are taken together by a single worker, so they share one exclusive section and one flush on disk. A write waits at most maxWriteDelay
+// nanoseconds while there are reads to serve
+
+#ifndef REQUEST_QUEUE_H
+#define REQUEST_QUEUE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include <netinet/in.h>
+
+#include "Packet.h"
+#include "Utility.h"
+#include "Connection.h"
+#include "Stats.h"
+
+typedef struct _Request {
+	Packet_t packet;				// Request packet sent by client
+	struct sockaddr_in clientAddr;			// Address of the client (used only if request has been received on UDP socket)
+	socklen_t addrLen;				// Length of the client address
+	Connection_t* conn;				// Connection on which request has been received (NULL if it has been received on UDP socket)
+	RequestTiming_t timing;				// Time at which request has been received and time spent in each phase
+	uint64_t deadline;				// Time after which client is no longer waiting for the response (0 if none)
+} Request_t;
+
+typedef struct _RequestRing {
+	Request_t* requests;				// Circular buffer of requests
+	size_t head;					// Index of the oldest request
+	size_t count;					// Number of requests in the ring
+} RequestRing_t;
+
+typedef struct _RequestQueue {
+	RequestRing_t reads;				// Requests that only read the phonebook
+	RequestRing_t writes;				// Requests that modify the phonebook
+	size_t capacity;				// Max number of requests in each ring
+	uint64_t maxWriteDelay;				// Max time (ns) that a write waits while reads are served before it
+	int writerActive;				// Set while a worker is executing a batch of writes
+	uint64_t writeBatches;				// Number of batches of writes taken by workers
+	uint64_t batchedWrites;				// Number of writes taken in all batches
+	pthread_mutex_t mutx;				// Mutex to regulate access to the rings
+	pthread_cond_t hasWork;				// Condition signaled when a worker may find something to do
+} RequestQueue_t;
+
+RequestQueue_t* CreateRequestQueue(size_t capacity, uint64_t maxWriteDelay);
+void DestroyRequestQueue(RequestQueue_t** queue);
+int IsWriteRequest(RequestType_t type);
+int TryEnqueueRequest(RequestQueue_t* queue, Request_t* request);
+int DequeueRequests(RequestQueue_t* queue, Request_t* requests, int maxRequests, int* areWrites);
+void EndWriteBatch(RequestQueue_t* queue);
+void PrintQueueStats(RequestQueue_t* queue);
+void FormatQueueStats(RequestQueue_t* queue, char* buff, size_t size);
+
+#endif
@@ -0,0 +1,101 @@
+#include "RequestTable.h"
+
+// Sets all slots of the table as free
+void InitializeRequestTable(RequestTable_t* table)
+{
+	if(table == NULL)
+		return;
+
+	memset(table, 0, sizeof(RequestTable_t));
+	table->nextId = 1;					// Id 0 is never used so that it can be used to identify packets without an id
+}
+
+
+// Assigns a new id to request and reserves a slot for it, returns the id or 0 if too many requests are already in flight
+uint32_t BeginRequest(RequestTable_t* table, Packet_t* request)
+{
+	if(table == NULL || request == NULL)
+		return 0;
+
+	PendingRequest_t* slot = &table->slots[table->nextId % MAX_PENDING_REQUESTS];
+	if(slot->state != SLOT_FREE)				// If slot is still used by an older request then the table is full
+		return 0;
+
+	slot->id = table->nextId;
+	slot->state = SLOT_WAITING;
+	request->requestId = table->nextId;
+
+	table->nextId++;
+	if(table->nextId == 0)					// Skip id 0 on wrap around
+		table->nextId = 1;
+
+	return request->requestId;
+}
+
+
+// Stores response in the slot of the request that it answers, returns 0 if no request is waiting for it (e.g. it arrived after a timeout)
+int CompleteRequest(RequestTable_t* table, const Packet_t* response)
+{
+	if(table == NULL || response == NULL || response->requestId == 0)
+		return 0;
+
+	PendingRequest_t* slot = &table->slots[response->requestId % MAX_PENDING_REQUESTS];
+	if(slot->state != SLOT_WAITING || slot->id != response->requestId)
+		return 0;
+
+	memcpy(&slot->response, response, sizeof(Packet_t));
+	slot->state = SLOT_COMPLETED;
+	return 1;
+}
+
+
+// If the response for request id has been received copies it in response, frees the slot and returns 1, otherwise returns 0
+int TakeResponse(RequestTable_t* table, uint32_t id, Packet_t* response)
+{
+	if(table == NULL || response == NULL || id == 0)
+		return 0;
+
+	PendingRequest_t* slot = &table->slots[id % MAX_PENDING_REQUESTS];
+	if(slot->state != SLOT_COMPLETED || slot->id != id)
+		return 0;
+
+	memcpy(response, &slot->response, sizeof(Packet_t));
+	slot->state = SLOT_FREE;
+	return 1;
+}
+
+
+// Frees the slot used by request id, a response that arrives later for it will be discarded
+void CancelRequest(RequestTable_t* table, uint32_t id)
+{
+	if(table == NULL || id == 0)
+		return;
+
+	PendingRequest_t* slot = &table->slots[id % MAX_PENDING_REQUESTS];
+	if(slot->id == id)
+		slot->state = SLOT_FREE;
+}
+
+
+// Receives packets from link until the response for request id arrives, responses for other requests in flight are stored in the table
+// and stale ones are discarded. On failure (e.g. timeout) the request is canceled, response->name contains the error and 0 is returned
+int WaitForResponse(RequestTable_t* table, ServerLink_t* link, uint32_t id, Packet_t* response)
+{
+	if(table == NULL || response == NULL || id == 0)
+		return 0;
+
+	Packet_t received;
+	while(TakeResponse(table, id, response) == 0)		// Until our response has not been received
+	{
+		if(ReceiveFromServer(link, &received) == 0)
+		{
+			CancelRequest(table, id);
+			memcpy(response->name, received.name, MAX_NAME_SIZE);
+			return 0;
+		}
+
+		CompleteRequest(table, &received);		// Store response in the slot of its request (if no one waits for it is discarded)
+	}
+
+	return 1;
+}
@@ -0,0 +1,35 @@
+// This file contains the definition of the RequestTable_t struct, it is used by clients to keep track of the requests sent to the server that
+// are still waiting for a response. Every request gets an id that the server copies in its response, in this way a single socket can keep
+// many requests in flight and responses can be matched with their request even if they arrive out of order (or late, after a timeout)
+
+#ifndef REQUEST_TABLE_H
+#define REQUEST_TABLE_H
+
+#include <stdint.h>
+#include <string.h>
+
+#include "Packet.h"
+#include "Constants.h"
+#include "ServerLink.h"
+
+typedef enum { SLOT_FREE, SLOT_WAITING, SLOT_COMPLETED } SlotState_t;
+
+typedef struct _PendingRequest {
+	uint32_t id;						// Id of the request that is using this slot
+	SlotState_t state;					// Tells if slot is free, waiting a response or if the response has been received
+	Packet_t response;					// Response received from the server (valid only when state is SLOT_COMPLETED)
+} PendingRequest_t;
+
+typedef struct _RequestTable {
+	uint32_t nextId;					// Id that will be assigned to the next request
+	PendingRequest_t slots[MAX_PENDING_REQUESTS];		// Slot used by a request is choosen as id % MAX_PENDING_REQUESTS
+} RequestTable_t;
+
+void InitializeRequestTable(RequestTable_t* table);
+uint32_t BeginRequest(RequestTable_t* table, Packet_t* request);
+int CompleteRequest(RequestTable_t* table, const Packet_t* response);
+int TakeResponse(RequestTable_t* table, uint32_t id, Packet_t* response);
+void CancelRequest(RequestTable_t* table, uint32_t id);
+int WaitForResponse(RequestTable_t* table, ServerLink_t* link, uint32_t id, Packet_t* response);
+
+#endif
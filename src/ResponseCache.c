@@ -0,0 +1,198 @@
+#include "ResponseCache.h"
+
+// Allocates a cache that can hold at least capacity responses, returns NULL on failure
+ResponseCache_t* CreateResponseCache(size_t capacity)
+{
+	ResponseCache_t* cache = malloc(sizeof(ResponseCache_t));
+	if(cache == NULL)
+	{
+		fprintf(stderr, "Error: cannot allocate memory to hold response cache\n");
+		return NULL;
+	}
+
+	cache->setsNum = 1;
+	while(cache->setsNum * CACHE_WAYS < capacity)		// Number of sets must be a power of 2 so that set index is a mask of the hash
+		cache->setsNum *= 2;
+
+	cache->sets = calloc(cache->setsNum, sizeof(CacheSet_t));
+	if(cache->sets == NULL)
+	{
+		fprintf(stderr, "Error: cannot allocate memory to hold response cache\n");
+		free(cache);
+		return NULL;
+	}
+
+	for(size_t i = 0; i < cache->setsNum; i++)
+	{
+		if(pthread_mutex_init(&cache->sets[i].mutx, NULL) != 0)
+		{
+			fprintf(stderr, "Error: cannot initialize mutex of response cache\n");
+			for(size_t j = 0; j < i; j++)
+				pthread_mutex_destroy(&cache->sets[j].mutx);
+
+			free(cache->sets);
+			free(cache);
+			return NULL;
+		}
+	}
+
+	atomic_store(&cache->hits, 0);
+	atomic_store(&cache->misses, 0);
+	atomic_store(&cache->evictions, 0);
+	atomic_store(&cache->invalidations, 0);
+	atomic_store(&cache->used, 0);
+	return cache;
+}
+
+
+// Deallocates cache
+void DestroyResponseCache(ResponseCache_t** cache)
+{
+	if(cache == NULL || *cache == NULL)
+		return;
+
+	for(size_t i = 0; i < (*cache)->setsNum; i++)
+		pthread_mutex_destroy(&(*cache)->sets[i].mutx);
+
+	free((*cache)->sets);
+	free(*cache);
+	*cache = NULL;
+}
+
+
+// Returns the entry of set that contains name (NULL if there is no such entry), set's mutex must be held
+static CacheEntry_t* FindEntry(CacheSet_t* set, uint64_t hash, const char* name)
+{
+	for(int i = 0; i < CACHE_WAYS; i++)
+	{
+		CacheEntry_t* entry = &set->entries[i];
+		if(entry->lastUse != 0 && entry->hash == hash && strncmp(entry->response.name, name, MAX_NAME_SIZE) == 0)
+			return entry;
+	}
+
+	return NULL;
+}
+
+
+// If response for contact name is cached copies it in response and returns 1, otherwise returns 0
+int CacheLookup(ResponseCache_t* cache, const char* name, Packet_t* response)
+{
+	if(cache == NULL || name == NULL || response == NULL)
+		return 0;
+
+	uint64_t hash = HashString(name, MAX_NAME_SIZE);
+	CacheSet_t* set = &cache->sets[hash & (cache->setsNum - 1)];
+
+	pthread_mutex_lock(&set->mutx);
+	CacheEntry_t* entry = FindEntry(set, hash, name);
+
+	if(entry != NULL)
+	{
+		entry->lastUse = ++set->clock;
+		memcpy(response, &entry->response, sizeof(Packet_t));
+	}
+
+	pthread_mutex_unlock(&set->mutx);
+
+	atomic_fetch_add_explicit(entry != NULL ? &cache->hits : &cache->misses, 1, memory_order_relaxed);
+	return entry != NULL;
+}
+
+
+// Stores response in the cache (keyed by response->name), the least recently used entry of the set is replaced if it is full. Must be
+// called while holding the phonebook lock, otherwise a response could be cached after the contact has been removed
+void CacheInsert(ResponseCache_t* cache, const Packet_t* response)
+{
+	if(cache == NULL || response == NULL)
+		return;
+
+	uint64_t hash = HashString(response->name, MAX_NAME_SIZE);
+	CacheSet_t* set = &cache->sets[hash & (cache->setsNum - 1)];
+
+	pthread_mutex_lock(&set->mutx);
+	CacheEntry_t* entry = FindEntry(set, hash, response->name);
+
+	if(entry == NULL)						// If contact is not already cached choose the entry to be replaced
+	{
+		entry = &set->entries[0];
+		for(int i = 1; i < CACHE_WAYS; i++)
+		{
+			if(set->entries[i].lastUse < entry->lastUse)
+				entry = &set->entries[i];
+		}
+
+		if(entry->lastUse != 0)
+			atomic_fetch_add_explicit(&cache->evictions, 1, memory_order_relaxed);
+		else
+			atomic_fetch_add_explicit(&cache->used, 1, memory_order_relaxed);
+	}
+
+	entry->hash = hash;
+	entry->lastUse = ++set->clock;
+	memcpy(&entry->response, response, sizeof(Packet_t));
+	pthread_mutex_unlock(&set->mutx);
+}
+
+
+// Removes response for contact name from the cache (if it is cached)
+void CacheInvalidate(ResponseCache_t* cache, const char* name)
+{
+	if(cache == NULL || name == NULL)
+		return;
+
+	uint64_t hash = HashString(name, MAX_NAME_SIZE);
+	CacheSet_t* set = &cache->sets[hash & (cache->setsNum - 1)];
+
+	pthread_mutex_lock(&set->mutx);
+	CacheEntry_t* entry = FindEntry(set, hash, name);
+
+	if(entry != NULL)
+	{
+		entry->lastUse = 0;
+		atomic_fetch_add_explicit(&cache->invalidations, 1, memory_order_relaxed);
+		atomic_fetch_sub_explicit(&cache->used, 1, memory_order_relaxed);
+	}
+
+	pthread_mutex_unlock(&set->mutx);
+}
+
+
+// Returns number of bytes allocated for the cache
+size_t GetCacheMemory(ResponseCache_t* cache)
+{
+	if(cache == NULL)
+		return 0;
+
+	return sizeof(ResponseCache_t) + cache->setsNum * sizeof(CacheSet_t);
+}
+
+
+// Prints to stdout hit rate, number of entries used and memory allocated for the cache
+void PrintCacheStats(ResponseCache_t* cache)
+{
+	if(cache == NULL)
+		return;
+
+	uint64_t hits = atomic_load(&cache->hits);
+	uint64_t misses = atomic_load(&cache->misses);
+	double hitRate = hits + misses == 0 ? 0.0 : (100.0 * hits) / (hits + misses);
+
+	printf("Response cache: %lu hits, %lu misses (hit rate %.1f%%), %lu evictions, %lu invalidations, %lu/%lu entries used, %lu KB\n",
+		hits, misses, hitRate, atomic_load(&cache->evictions), atomic_load(&cache->invalidations), atomic_load(&cache->used),
+		cache->setsNum * CACHE_WAYS, GetCacheMemory(cache) / 1024);
+}
+
+
+// Writes in buff a short summary of the statistics of cache
+void FormatCacheStats(ResponseCache_t* cache, char* buff, size_t size)
+{
+	if(cache == NULL)
+	{
+		snprintf(buff, size, "disabled");
+		return;
+	}
+
+	snprintf(buff, size, "hits=%lu misses=%lu evict=%lu inval=%lu used=%lu", (unsigned long) atomic_load(&cache->hits),
+		(unsigned long) atomic_load(&cache->misses), (unsigned long) atomic_load(&cache->evictions),
+		(unsigned long) atomic_load(&cache->invalidations), (unsigned long) atomic_load(&cache->used));
+}
@@ -0,0 +1,52 @@
+// This file contains the definition of the ResponseCache_t struct, a size-bounded cache of ready-to-send GET_CONTACT responses keyed by
+// contact name. It is set-associative: a name can be stored only in one of the CACHE_WAYS entries of the set choosen by its hash, each
+// set has its own mutex so lookups of different names rarely contend and never need the phonebook lock. When a set is full the least
+// recently used entry is replaced. Entries must be invalidated whenever the corresponding contact is added or removed
+
+#ifndef RESPONSE_CACHE_H
+#define RESPONSE_CACHE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "Packet.h"
+#include "Utility.h"
+
+#define CACHE_WAYS	4				// Number of entries in each set
+
+typedef struct _CacheEntry {
+	uint64_t hash;					// Hash of the name of the contact (meaningful only if entry is valid)
+	uint64_t lastUse;				// Value of set's clock when entry was used for the last time (0 if entry is not valid)
+	Packet_t response;				// Response to be sent to clients that ask for the contact
+} CacheEntry_t;
+
+typedef struct _CacheSet {
+	pthread_mutex_t mutx;				// Mutex to regulate operations on the entries of this set
+	uint64_t clock;					// Incremented on every use of an entry of the set, used to find least recently used entry
+	CacheEntry_t entries[CACHE_WAYS];
+} CacheSet_t;
+
+typedef struct _ResponseCache {
+	CacheSet_t* sets;				// Array of sets
+	size_t setsNum;					// Number of sets (it is a power of 2)
+	_Atomic uint64_t hits;				// Lookups that found the response in the cache
+	_Atomic uint64_t misses;			// Lookups that didn't find the response in the cache
+	_Atomic uint64_t evictions;			// Valid entries replaced by new ones
+	_Atomic uint64_t invalidations;			// Valid entries removed because contact has changed
+	atomic_size_t used;				// Number of valid entries
+} ResponseCache_t;
+
+ResponseCache_t* CreateResponseCache(size_t capacity);
+void DestroyResponseCache(ResponseCache_t** cache);
+int CacheLookup(ResponseCache_t* cache, const char* name, Packet_t* response);
+void CacheInsert(ResponseCache_t* cache, const Packet_t* response);
+void CacheInvalidate(ResponseCache_t* cache, const char* name);
+size_t GetCacheMemory(ResponseCache_t* cache);
+void PrintCacheStats(ResponseCache_t* cache);
+void FormatCacheStats(ResponseCache_t* cache, char* buff, size_t size);
+
+#endif
@@ -0,0 +1,634 @@
+#include "Results.h"
+
+typedef struct _JsonParser {
+	const char* curr;				// Next character to parse (text is terminated by '\0')
+} JsonParser_t;
+
+
+// Writes str on file as a JSON string
+static void WriteString(FILE* file, const char* str)
+{
+	fputc('"', file);
+	for(; *str != '\0'; str++)
+	{
+		if(*str == '"' || *str == '\\')
+			fprintf(file, "\\%c", *str);
+		else if((unsigned char) *str < 0x20)
+			fprintf(file, "\\u%04x", (unsigned int)(unsigned char) *str);
+		else
+			fputc(*str, file);
+	}
+	fputc('"', file);
+}
+
+
+// Writes number on file (JSON has no NaN and infinity, they are written as 0)
+static void WriteNumber(FILE* file, double number)
+{
+	fprintf(file, "%.9g", isfinite(number) ? number : 0.0);
+}
+
+
+// Skips white spaces, then returns 1 and skips next character if it is c
+static int Consume(JsonParser_t* parser, char c)
+{
+	while(*parser->curr == ' ' || *parser->curr == '\t' || *parser->curr == '\n' || *parser->curr == '\r')
+		parser->curr++;
+
+	if(*parser->curr != c)
+		return 0;
+
+	parser->curr++;
+	return 1;
+}
+
+
+// Parses a string and stores it in buff (truncated to size bytes, not stored if buff is NULL), returns 0 on failure
+static int ParseString(JsonParser_t* parser, char* buff, size_t size)
+{
+	if(Consume(parser, '"') == 0)
+		return 0;
+
+	size_t length = 0;
+	for(; *parser->curr != '"'; parser->curr++)
+	{
+		char c = *parser->curr;
+		if(c == '\0')
+			return 0;
+
+		if(c == '\\')
+		{
+			parser->curr++;
+			switch(*parser->curr)
+			{
+				case 'b': c = '\b'; break;
+				case 'f': c = '\f'; break;
+				case 'n': c = '\n'; break;
+				case 'r': c = '\r'; break;
+				case 't': c = '\t'; break;
+
+				case 'u':					// Characters outside ASCII are not used by the schema
+				{
+					unsigned int code = 0;
+					if(sscanf(parser->curr + 1, "%4x", &code) != 1 || strlen(parser->curr) < 5)
+						return 0;
+
+					c = code < 0x80 ? (char) code : '?';
+					parser->curr += 4;
+					break;
+				}
+
+				case '\0':
+					return 0;
+
+				default:
+					c = *parser->curr;
+					break;
+			}
+		}
+
+		if(buff != NULL && length + 1 < size)
+			buff[length++] = c;
+	}
+
+	parser->curr++;
+	if(buff != NULL && size > 0)
+		buff[length] = '\0';
+
+	return 1;
+}
+
+
+// Parses a number and stores it in number, returns 0 on failure
+static int ParseNumber(JsonParser_t* parser, double* number)
+{
+	char* end;						// strtod() skips white spaces
+	*number = strtod(parser->curr, &end);
+	if(end == parser->curr)
+		return 0;
+
+	parser->curr = end;
+	return 1;
+}
+
+
+// Skips a value of any type (depth is the number of objects and arrays that contain it), returns 0 on failure
+static int SkipValue(JsonParser_t* parser, int depth)
+{
+	double number;
+	char open = Consume(parser, '{') ? '}' : Consume(parser, '[') ? ']' : '\0';
+
+	if(open == '\0')
+	{
+		if(*parser->curr == '"')
+			return ParseString(parser, NULL, 0);
+
+		const char* literals[] = { "true", "false", "null" };
+		for(int i = 0; i < 3; i++)
+		{
+			if(strncmp(parser->curr, literals[i], strlen(literals[i])) == 0)
+			{
+				parser->curr += strlen(literals[i]);
+				return 1;
+			}
+		}
+
+		return ParseNumber(parser, &number);
+	}
+
+	if(depth >= MAX_JSON_DEPTH)
+		return 0;
+
+	if(Consume(parser, open))				// Empty object or array
+		return 1;
+
+	do
+	{
+		if(open == '}' && (ParseString(parser, NULL, 0) == 0 || Consume(parser, ':') == 0))
+			return 0;
+
+		if(SkipValue(parser, depth + 1) == 0)
+			return 0;
+	}
+	while(Consume(parser, ','));
+
+	return Consume(parser, open);
+}
+
+
+// Parses an array of numbers and stores it in samples of metric, returns 0 on failure
+static int ParseSamples(JsonParser_t* parser, Metric_t* metric)
+{
+	if(Consume(parser, '[') == 0)
+		return 0;
+
+	if(Consume(parser, ']'))
+		return 1;
+
+	size_t capacity = 0;
+	do
+	{
+		if(metric->samplesNum == capacity)
+		{
+			capacity = capacity == 0 ? 16 : capacity * 2;
+			double* newSamples = realloc(metric->samples, capacity * sizeof(double));
+			if(newSamples == NULL)
+			{
+				fprintf(stderr, "Error: cannot allocate memory to hold samples\n");
+				return 0;
+			}
+
+			metric->samples = newSamples;
+		}
+
+		if(ParseNumber(parser, &metric->samples[metric->samplesNum]) == 0)
+			return 0;
+
+		metric->samplesNum++;
+	}
+	while(Consume(parser, ','));
+
+	return Consume(parser, ']');
+}
+
+
+// Parses an object of the metrics array and adds it to results, returns 0 on failure
+static int ParseMetric(JsonParser_t* parser, Results_t* results)
+{
+	if(Consume(parser, '{') == 0 || AddMetric(results, "", "", 0, 0, NULL, 0) == 0)
+		return 0;
+
+	Metric_t* metric = &results->metrics[results->metricsNum - 1];
+	if(Consume(parser, '}'))
+		return 1;
+
+	char key[32];
+	char better[16] = "lower";
+	int result = 1;
+	do
+	{
+		if(ParseString(parser, key, sizeof(key)) == 0 || Consume(parser, ':') == 0)
+			return 0;
+
+		if(strcmp(key, "name") == 0)
+			result = ParseString(parser, metric->name, MAX_METRIC_NAME);
+		else if(strcmp(key, "unit") == 0)
+			result = ParseString(parser, metric->unit, MAX_METRIC_UNIT);
+		else if(strcmp(key, "better") == 0)
+			result = ParseString(parser, better, sizeof(better));
+		else if(strcmp(key, "value") == 0)
+			result = ParseNumber(parser, &metric->value);
+		else if(strcmp(key, "samples") == 0)
+			result = ParseSamples(parser, metric);
+		else
+			result = SkipValue(parser, 2);
+
+		if(result == 0)
+			return 0;
+	}
+	while(Consume(parser, ','));
+
+	metric->higherIsBetter = strcmp(better, "higher") == 0;
+	return Consume(parser, '}');
+}
+
+
+// Parses the top level object of a results file and stores it in results, returns 0 on failure
+static int ParseResults(JsonParser_t* parser, Results_t* results)
+{
+	char schema[32] = "";
+	double version = 0;
+
+	if(Consume(parser, '{') == 0)
+		return 0;
+
+	char key[32];
+	int result = 1;
+	do
+	{
+		if(ParseString(parser, key, sizeof(key)) == 0 || Consume(parser, ':') == 0)
+			return 0;
+
+		double number = 0;
+		if(strcmp(key, "schema") == 0)
+			result = ParseString(parser, schema, sizeof(schema));
+		else if(strcmp(key, "version") == 0)
+			result = ParseNumber(parser, &version);
+		else if(strcmp(key, "tool") == 0)
+			result = ParseString(parser, results->tool, sizeof(results->tool));
+		else if(strcmp(key, "mode") == 0)
+			result = ParseString(parser, results->mode, sizeof(results->mode));
+		else if(strcmp(key, "host") == 0)
+			result = ParseString(parser, results->host, sizeof(results->host));
+		else if(strcmp(key, "description") == 0)
+			result = ParseString(parser, results->description, sizeof(results->description));
+		else if(strcmp(key, "timestamp") == 0)
+		{
+			result = ParseNumber(parser, &number);
+			results->timestamp = (int64_t) number;
+		}
+		else if(strcmp(key, "metrics") == 0)
+		{
+			if((result = Consume(parser, '[')) == 1 && Consume(parser, ']') == 0)
+			{
+				do
+					result = ParseMetric(parser, results);
+				while(result == 1 && Consume(parser, ','));
+
+				result = result == 1 && Consume(parser, ']');
+			}
+		}
+		else
+			result = SkipValue(parser, 1);
+
+		if(result == 0)
+			return 0;
+	}
+	while(Consume(parser, ','));
+
+	if(Consume(parser, '}') == 0)
+		return 0;
+
+	if(strcmp(schema, RESULTS_SCHEMA) != 0 || version < 1 || version > RESULTS_VERSION)
+	{
+		fprintf(stderr, "Error: not a %s file of version %d\n", RESULTS_SCHEMA, RESULTS_VERSION);
+		return 0;
+	}
+
+	return 1;
+}
+
+
+// Creates an empty set of results produced by tool run in given mode, returns NULL on failure
+Results_t* CreateResults(const char* tool, const char* mode, const char* description)
+{
+	Results_t* newResults = calloc(1, sizeof(Results_t));
+	if(newResults == NULL)
+	{
+		fprintf(stderr, "Error: cannot allocate memory to hold results\n");
+		return NULL;
+	}
+
+	strncpy(newResults->tool, tool, sizeof(newResults->tool) - 1);
+	strncpy(newResults->mode, mode, sizeof(newResults->mode) - 1);
+	strncpy(newResults->description, description, sizeof(newResults->description) - 1);
+	if(gethostname(newResults->host, sizeof(newResults->host)) != 0)
+		strcpy(newResults->host, "unknown");
+
+	newResults->host[sizeof(newResults->host) - 1] = '\0';
+	newResults->timestamp = (int64_t) time(NULL);
+	return newResults;
+}
+
+
+// Deallocates results
+void DestroyResults(Results_t** results)
+{
+	if(results == NULL || *results == NULL)
+		return;
+
+	for(size_t i = 0; i < (*results)->metricsNum; i++)
+		free((*results)->metrics[i].samples);
+
+	free((*results)->metrics);
+	free(*results);
+	*results = NULL;
+}
+
+
+// Adds a metric to results (samples are copied, they can be NULL), returns 0 on failure
+int AddMetric(Results_t* results, const char* name, const char* unit, int higherIsBetter, double value, const double* samples, size_t samplesNum)
+{
+	if(results == NULL)
+		return 0;
+
+	if(results->metricsNum == results->capacity)
+	{
+		size_t capacity = results->capacity == 0 ? 16 : results->capacity * 2;
+		Metric_t* newMetrics = realloc(results->metrics, capacity * sizeof(Metric_t));
+		if(newMetrics == NULL)
+		{
+			fprintf(stderr, "Error: cannot allocate memory to hold metrics\n");
+			return 0;
+		}
+
+		results->metrics = newMetrics;
+		results->capacity = capacity;
+	}
+
+	Metric_t* metric = &results->metrics[results->metricsNum];
+	memset(metric, 0, sizeof(Metric_t));
+	strncpy(metric->name, name, MAX_METRIC_NAME - 1);
+	strncpy(metric->unit, unit, MAX_METRIC_UNIT - 1);
+	metric->higherIsBetter = higherIsBetter;
+	metric->value = value;
+
+	if(samples != NULL && samplesNum > 0)
+	{
+		metric->samples = malloc(samplesNum * sizeof(double));
+		if(metric->samples == NULL)
+		{
+			fprintf(stderr, "Error: cannot allocate memory to hold samples\n");
+			return 0;
+		}
+
+		memcpy(metric->samples, samples, samplesNum * sizeof(double));
+		metric->samplesNum = samplesNum;
+	}
+
+	results->metricsNum++;
+	return 1;
+}
+
+
+// Writes results as JSON on file filename, returns 0 on failure
+int WriteResults(Results_t* results, const char* filename)
+{
+	FILE* file = fopen(filename, "w");
+	if(file == NULL)
+	{
+		fprintf(stderr, "Error: cannot open %s: %s\n", filename, strerror(errno));
+		return 0;
+	}
+
+	fprintf(file, "{\n  \"schema\": \"%s\",\n  \"version\": %d,\n  \"tool\": ", RESULTS_SCHEMA, RESULTS_VERSION);
+	WriteString(file, results->tool);
+	fprintf(file, ",\n  \"mode\": ");
+	WriteString(file, results->mode);
+	fprintf(file, ",\n  \"timestamp\": %lld,\n  \"host\": ", (long long) results->timestamp);
+	WriteString(file, results->host);
+	fprintf(file, ",\n  \"description\": ");
+	WriteString(file, results->description);
+	fprintf(file, ",\n  \"metrics\": [");
+
+	for(size_t i = 0; i < results->metricsNum; i++)
+	{
+		Metric_t* metric = &results->metrics[i];
+		fprintf(file, "%s\n    { \"name\": ", i == 0 ? "" : ",");
+		WriteString(file, metric->name);
+		fprintf(file, ", \"unit\": ");
+		WriteString(file, metric->unit);
+		fprintf(file, ", \"better\": \"%s\", \"value\": ", metric->higherIsBetter ? "higher" : "lower");
+		WriteNumber(file, metric->value);
+		fprintf(file, ", \"samples\": [");
+
+		for(size_t j = 0; j < metric->samplesNum; j++)
+		{
+			fprintf(file, j == 0 ? " " : ", ");
+			WriteNumber(file, metric->samples[j]);
+		}
+
+		fprintf(file, metric->samplesNum > 0 ? " ] }" : "] }");
+	}
+
+	fprintf(file, "\n  ]\n}\n");
+
+	if(fclose(file) != 0)
+	{
+		fprintf(stderr, "Error: cannot write %s: %s\n", filename, strerror(errno));
+		return 0;
+	}
+
+	return 1;
+}
+
+
+// Loads results from JSON file filename, returns NULL on failure
+Results_t* LoadResults(const char* filename)
+{
+	FILE* file = fopen(filename, "r");
+	if(file == NULL)
+	{
+		fprintf(stderr, "Error: cannot open %s: %s\n", filename, strerror(errno));
+		return NULL;
+	}
+
+	char* text = NULL;
+	size_t length = 0;
+	size_t capacity = 0;
+	size_t bytesRead;
+	do
+	{
+		if(length + 4096 + 1 > capacity)
+		{
+			capacity = capacity == 0 ? 65536 : capacity * 2;
+			char* newText = realloc(text, capacity);
+			if(newText == NULL)
+			{
+				fprintf(stderr, "Error: cannot allocate memory to read %s\n", filename);
+				free(text);
+				fclose(file);
+				return NULL;
+			}
+
+			text = newText;
+		}
+
+		bytesRead = fread(text + length, 1, 4096, file);
+		length += bytesRead;
+	}
+	while(bytesRead > 0);
+
+	fclose(file);
+	text[length] = '\0';
+
+	Results_t* newResults = CreateResults("", "", "");
+	JsonParser_t parser = { text };
+
+	if(newResults != NULL && ParseResults(&parser, newResults) == 0)
+	{
+		fprintf(stderr, "Error: %s is not a valid results file (near byte %ld)\n", filename, (long)(parser.curr - text));
+		DestroyResults(&newResults);
+	}
+
+	free(text);
+	return newResults;
+}
+
+
+// Returns the mean of samples
+static double GetMean(const double* samples, size_t samplesNum)
+{
+	double sum = 0;
+	for(size_t i = 0; i < samplesNum; i++)
+		sum += samples[i];
+
+	return sum / samplesNum;
+}
+
+
+// Returns the mean of samplesNum samples drawn with replacement from samples
+static double GetResampledMean(const double* samples, size_t samplesNum, unsigned int* seed)
+{
+	double sum = 0;
+	for(size_t i = 0; i < samplesNum; i++)
+		sum += samples[(size_t) rand_r(seed) % samplesNum];
+
+	return sum / samplesNum;
+}
+
+
+// Compares two doubles, used by qsort()
+static int CompareChanges(const void* a, const void* b)
+{
+	double first = *(const double*) a;
+	double second = *(const double*) b;
+	return (first > second) - (first < second);
+}
+
+
+// Computes the confidence interval (confidence %) of the relative change (%) of the mean from baseline to candidate, resampling both with
+// the bootstrap, returns 0 if it cannot be computed
+static int GetChangeInterval(Metric_t* baseline, Metric_t* candidate, double confidence, double* low, double* high)
+{
+	double* changes = malloc(BOOTSTRAP_ITERATIONS * sizeof(double));
+	if(changes == NULL)
+		return 0;
+
+	unsigned int seed = 1;						// Fixed seed, so that comparing the same files gives the same result
+	size_t valid = 0;
+	for(int i = 0; i < BOOTSTRAP_ITERATIONS; i++)
+	{
+		double before = GetResampledMean(baseline->samples, baseline->samplesNum, &seed);
+		double after = GetResampledMean(candidate->samples, candidate->samplesNum, &seed);
+		if(before != 0)
+			changes[valid++] = (after - before) / fabs(before) * 100.0;
+	}
+
+	if(valid < BOOTSTRAP_ITERATIONS / 2)				// Baseline is (almost) always 0, relative change is meaningless
+	{
+		free(changes);
+		return 0;
+	}
+
+	qsort(changes, valid, sizeof(double), CompareChanges);
+	double tail = (100.0 - confidence) / 200.0;
+	*low = changes[(size_t)(tail * (valid - 1))];
+	*high = changes[(size_t)((1.0 - tail) * (valid - 1) + 0.5)];
+
+	free(changes);
+	return 1;
+}
+
+
+// Prints the comparison of each metric of candidate with the metric of baseline with the same name, a metric regressed if the confidence
+// interval (confidence %) of its relative change is entirely worse than threshold %, returns the number of metrics that regressed
+int CompareResults(Results_t* baseline, Results_t* candidate, double threshold, double confidence)
+{
+	Results_t* both[] = { baseline, candidate };
+	const char* roles[] = { "Baseline", "Candidate" };
+	for(int i = 0; i < 2; i++)
+	{
+		char date[32];
+		time_t timestamp = (time_t) both[i]->timestamp;
+		strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", localtime(&timestamp));
+		printf("%-10s %s %s on %s at %s: %s\n", roles[i], both[i]->tool, both[i]->mode, both[i]->host, date, both[i]->description);
+	}
+
+	if(strcmp(baseline->tool, candidate->tool) != 0 || strcmp(baseline->mode, candidate->mode) != 0)
+		printf("Warning: results have been produced by different tools or modes\n");
+
+	printf("\n%-32s %-8s %14s %14s %9s %21s  %s\n", "metric", "unit", "baseline", "candidate", "change", "ci", "verdict");
+
+	int regressions = 0;
+	for(size_t i = 0; i < candidate->metricsNum; i++)
+	{
+		Metric_t* after = &candidate->metrics[i];
+		Metric_t* before = NULL;
+		for(size_t j = 0; j < baseline->metricsNum && before == NULL; j++)
+			if(strcmp(baseline->metrics[j].name, after->name) == 0)
+				before = &baseline->metrics[j];
+
+		if(before == NULL)
+		{
+			printf("%-32s %-8s %14s %14.2f %9s %21s  %s\n", after->name, after->unit, "-", after->value, "-", "-", "new metric");
+			continue;
+		}
+
+		int hasSamples = before->samplesNum >= BOOTSTRAP_MIN_SAMPLES && after->samplesNum >= BOOTSTRAP_MIN_SAMPLES;
+		double beforeValue = hasSamples ? GetMean(before->samples, before->samplesNum) : before->value;
+		double afterValue = hasSamples ? GetMean(after->samples, after->samplesNum) : after->value;
+
+		char change[16] = "-";
+		if(beforeValue != 0)
+			snprintf(change, sizeof(change), "%+.1f%%", (afterValue - beforeValue) / fabs(beforeValue) * 100.0);
+
+		char interval[32] = "-";
+		const char* verdict = before->samplesNum == 0 || after->samplesNum == 0 ? "no samples" : "few samples";
+		double low;
+		double high;
+		if(hasSamples && GetChangeInterval(before, after, confidence, &low, &high) == 1)
+		{
+			snprintf(interval, sizeof(interval), "[%+.1f%%, %+.1f%%]", low, high);
+
+			double worse = after->higherIsBetter ? -high : low;	// Smallest change that makes the metric worse
+			double better = after->higherIsBetter ? low : -high;	// Smallest change that makes the metric better
+			if(worse > threshold)
+			{
+				verdict = "REGRESSION";
+				regressions++;
+			}
+			else if(better > threshold)
+				verdict = "improvement";
+			else
+				verdict = "ok";
+		}
+
+		printf("%-32s %-8s %14.2f %14.2f %9s %21s  %s\n", after->name, after->unit, beforeValue, afterValue, change, interval, verdict);
+	}
+
+	for(size_t i = 0; i < baseline->metricsNum; i++)
+	{
+		int found = 0;
+		for(size_t j = 0; j < candidate->metricsNum && found == 0; j++)
+			found = strcmp(baseline->metrics[i].name, candidate->metrics[j].name) == 0;
+
+		if(found == 0)
+			printf("%-32s %-8s %14.2f %14s %9s %21s  %s\n", baseline->metrics[i].name, baseline->metrics[i].unit, baseline->metrics[i].value,
+				"-", "-", "-", "missing");
+	}
+
+	printf("\n%d metrics regressed by more than %.1f%% (%.0f%% bootstrap confidence interval of the change of the mean of samples)\n",
+		regressions, threshold, confidence);
+	return regressions;
+}
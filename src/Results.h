@@ -0,0 +1,69 @@
+
+// This file contains the definition of the Results_t struct, the results of a run of the tester or of the benchmarks written as JSON with a
+// stable schema, so that runs made before and after a change can be compared by tools. A results file looks like:
+//
+//	{
+//	  "schema": "phonebook-results", "version": 1, "tool": "tester", "mode": "load", "timestamp": 1760000000, "host": "db1",
+//	  "description": "free-form description of the configuration of the run",
+//	  "metrics": [
+//	    { "name": "throughput", "unit": "req/s", "better": "higher", "value": 9998.5, "samples": [ 10001.0, 9996.0, ... ] },
+//	    ...
+//	  ]
+//	}
+//
+// value is the headline number of the metric, samples are independent measures of it (e.g. one for each second of a load run or for
+// each repetition of a benchmark) used to tell if a difference between two runs is larger than the noise. Fields may be added in the
+// future without changing version, so readers must skip keys they don't know. CompareResults() matches metrics by name and computes a
+// bootstrap confidence interval of the relative change of the mean of samples: a metric regressed if the whole interval is worse than
+// threshold %
+
+#ifndef RESULTS_H
+#define RESULTS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+
+#define RESULTS_SCHEMA		"phonebook-results"	// Value of "schema" key of results files
+#define RESULTS_VERSION		1			// Version of the schema of results files
+#define MAX_METRIC_NAME		64			// Max length of the name of a metric (including terminator)
+#define MAX_METRIC_UNIT		16			// Max length of the unit of a metric (including terminator)
+#define BOOTSTRAP_ITERATIONS	2000			// Number of resamples used to compute confidence intervals
+#define BOOTSTRAP_MIN_SAMPLES	3			// Min number of samples of both runs needed to compute confidence intervals
+#define DEFAULT_THRESHOLD	5.0			// Default min relative change (%) that is reported as regression
+#define DEFAULT_CONFIDENCE	95.0			// Default confidence (%) of the intervals
+#define MAX_JSON_DEPTH		64			// Max nesting of values skipped when reading results
+
+typedef struct _Metric {
+	char name[MAX_METRIC_NAME];			// Name of metric, unique in a results file
+	char unit[MAX_METRIC_UNIT];			// Unit of value and samples
+	int higherIsBetter;				// 1 if higher values are better (e.g. throughput), 0 if lower are (e.g. latency)
+	double value;					// Headline value of metric
+	double* samples;				// Independent measures of metric (NULL if there are none)
+	size_t samplesNum;				// Number of samples
+} Metric_t;
+
+typedef struct _Results {
+	char tool[16];					// Program that produced results (tester or bench)
+	char mode[16];					// Mode in which program has been run
+	char host[64];					// Host on which program has been run
+	char description[256];				// Configuration of the run
+	int64_t timestamp;				// Time (seconds since epoch) at which results have been created
+	Metric_t* metrics;				// Array of metrics
+	size_t metricsNum;				// Number of metrics
+	size_t capacity;				// Number of metrics that fit in array
+} Results_t;
+
+Results_t* CreateResults(const char* tool, const char* mode, const char* description);
+void DestroyResults(Results_t** results);
+int AddMetric(Results_t* results, const char* name, const char* unit, int higherIsBetter, double value, const double* samples, size_t samplesNum);
+int WriteResults(Results_t* results, const char* filename);
+Results_t* LoadResults(const char* filename);
+int CompareResults(Results_t* baseline, Results_t* candidate, double threshold, double confidence);
+
+#endif
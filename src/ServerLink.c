@@ -0,0 +1,221 @@
+#include "ServerLink.h"
+
+// Creates a socket that uses the given transport and connects it to the server, a timeout of RESPONSE_TIMEOUT is set for receive operations
+// (with UNIX_TRANSPORT and SHM_TRANSPORT address and portNum are ignored and the server is reached at SERVER_SOCKET_PATH)
+int OpenServerLink(ServerLink_t* link, Transport_t transport, const char* address, const char* portNum)
+{
+	if(link == NULL || address == NULL || portNum == NULL)
+		return 0;
+
+	link->shm = NULL;
+	if(transport == UNIX_TRANSPORT)
+		return OpenUnixLink(link, SERVER_SOCKET_PATH);
+
+	if(transport == SHM_TRANSPORT)
+		return OpenShmLink(link, SERVER_SOCKET_PATH);
+
+	link->transport = transport;
+	link->sock = -1;
+
+	struct addrinfo addrHints;				// Set properties that server's address should have
+	struct addrinfo* serverAddress = NULL;
+	memset(&addrHints, 0, sizeof(struct addrinfo));
+	addrHints.ai_family = AF_INET;
+	addrHints.ai_protocol = 0;
+	addrHints.ai_socktype = transport == TCP_TRANSPORT ? SOCK_STREAM : SOCK_DGRAM;
+	addrHints.ai_flags = 0;
+
+	if(getaddrinfo(address, portNum, &addrHints, &serverAddress) != 0)	// Try to get server's address
+	{
+		fprintf(stderr, "Error: getaddrinfo() failed\n");
+		return 0;
+	}
+
+	link->sock = socket(serverAddress->ai_family, serverAddress->ai_socktype, serverAddress->ai_protocol);
+	if(link->sock == -1)
+	{
+		fprintf(stderr, "Error: cannot create socket\n");
+		freeaddrinfo(serverAddress);
+		return 0;
+	}
+
+	if(connect(link->sock, serverAddress->ai_addr, serverAddress->ai_addrlen) != 0)
+	{
+		fprintf(stderr, "Error: cannot connect socket to server\n");
+		freeaddrinfo(serverAddress);
+		close(link->sock);
+		link->sock = -1;
+		return 0;
+	}
+
+	freeaddrinfo(serverAddress);
+
+	if(transport == TCP_TRANSPORT)				// Requests are small, don't let Nagle's algorithm delay them
+	{
+		int noDelay = 1;
+		setsockopt(link->sock, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(int));
+	}
+
+	struct timeval timeout;					// Set timeout of RESPONSE_TIMEOUT for receive operations
+	timeout.tv_sec = RESPONSE_TIMEOUT / 1000;
+	timeout.tv_usec = (RESPONSE_TIMEOUT % 1000) * 1000;
+
+	if(setsockopt(link->sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(struct timeval)) != 0)
+		fprintf(stderr, "Warning: cannot set timeout for receive operations on socket... ");
+
+	return 1;
+}
+
+
+// Creates a unix seqpacket socket and connects it to the server listening at path, a timeout of RESPONSE_TIMEOUT is set for receive operations
+int OpenUnixLink(ServerLink_t* link, const char* path)
+{
+	if(link == NULL || path == NULL)
+		return 0;
+
+	link->transport = UNIX_TRANSPORT;
+	link->shm = NULL;
+	link->sock = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+	if(link->sock == -1)
+	{
+		fprintf(stderr, "Error: cannot create socket\n");
+		return 0;
+	}
+
+	struct sockaddr_un serverAddress;
+	memset(&serverAddress, 0, sizeof(struct sockaddr_un));
+	serverAddress.sun_family = AF_UNIX;
+	strncpy(serverAddress.sun_path, path, sizeof(serverAddress.sun_path) - 1);
+
+	if(connect(link->sock, (struct sockaddr*) &serverAddress, sizeof(struct sockaddr_un)) != 0)
+	{
+		fprintf(stderr, "Error: cannot connect socket to server\n");
+		close(link->sock);
+		link->sock = -1;
+		return 0;
+	}
+
+	struct timeval timeout;					// Set timeout of RESPONSE_TIMEOUT for receive operations
+	timeout.tv_sec = RESPONSE_TIMEOUT / 1000;
+	timeout.tv_usec = (RESPONSE_TIMEOUT % 1000) * 1000;
+
+	if(setsockopt(link->sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(struct timeval)) != 0)
+		fprintf(stderr, "Warning: cannot set timeout for receive operations on socket... ");
+
+	return 1;
+}
+
+
+// Creates a shared memory segment and passes it to the server listening at path, requests will then be exchanged through the segment
+// while the unix connection is kept open only to let the server know when the client goes away
+int OpenShmLink(ServerLink_t* link, const char* path)
+{
+	if(OpenUnixLink(link, path) == 0)
+		return 0;
+
+	int fd;
+	link->shm = CreateShmSegment(&fd);
+	if(link->shm == NULL)
+	{
+		CloseServerLink(link);
+		return 0;
+	}
+
+	Packet_t attach;
+	memset(&attach, 0, sizeof(Packet_t));
+	attach.type = ATTACH_SHM;
+
+	int attached = SendPacketWithFd(link->sock, &attach, fd) == 1 && ReceivePacket(link->sock, &attach) == 1 && attach.type == ACCEPTED;
+	close(fd);							// Server has its own copy of the descriptor
+
+	if(attached == 0)
+	{
+		fprintf(stderr, "Error: server refused shared memory segment\n");
+		CloseServerLink(link);
+		return 0;
+	}
+
+	link->transport = SHM_TRANSPORT;
+	return 1;
+}
+
+
+// Closes the socket used by link (and unmaps its shared memory segment)
+void CloseServerLink(ServerLink_t* link)
+{
+	if(link == NULL)
+		return;
+
+	if(link->shm != NULL)
+	{
+		UnmapShmSegment(link->shm);
+		link->shm = NULL;
+	}
+
+	if(link->sock != -1)
+		close(link->sock);
+
+	link->sock = -1;
+}
+
+
+// Sends pack to the server using the transport of link, returns 0 on failure 1 otherwise
+int SendToServer(ServerLink_t* link, Packet_t* pack)
+{
+	if(link == NULL || link->sock == -1 || pack == NULL)
+		return 0;
+
+	if(pack->timeoutMs == 0)				// Server doesn't need to answer after we stop waiting
+		pack->timeoutMs = RESPONSE_TIMEOUT;
+
+	if(link->transport == TCP_TRANSPORT)
+		return SendFramedPacket(link->sock, pack, 0);
+
+	if(link->transport == SHM_TRANSPORT)
+	{
+		uint64_t deadline = GetTimeNs() + RESPONSE_TIMEOUT * 1000000ULL;	// Give the server some time to make room in the ring
+		while(ShmRingPush(&link->shm->requests, pack) == 0)
+		{
+			uint64_t now = GetTimeNs();
+			if(now >= deadline)
+				return 0;
+
+			ShmRingWaitRoom(&link->shm->requests, (int)((deadline - now) / 1000000) + 1);
+		}
+
+		return 1;
+	}
+
+	return send(link->sock, pack, sizeof(Packet_t), 0) == sizeof(Packet_t);
+}
+
+
+// Receives a packet from the server using the transport of link
+int ReceiveFromServer(ServerLink_t* link, Packet_t* pack)
+{
+	if(link == NULL || pack == NULL)
+		return 0;
+
+	if(link->transport == TCP_TRANSPORT)
+		return ReceiveFramedPacket(link->sock, pack);
+
+	if(link->transport == SHM_TRANSPORT)
+	{
+		uint64_t deadline = GetTimeNs() + RESPONSE_TIMEOUT * 1000000ULL;	// Same timeout used for sockets
+		while(ShmRingPop(&link->shm->responses, pack) == 0)
+		{
+			uint64_t now = GetTimeNs();
+			if(now >= deadline)
+			{
+				snprintf(pack->name, MAX_NAME_SIZE, "Timeout error...");
+				return 0;
+			}
+
+			ShmRingWait(&link->shm->responses, (int)((deadline - now) / 1000000) + 1);
+		}
+
+		return 1;
+	}
+
+	return ReceivePacket(link->sock, pack);
+}
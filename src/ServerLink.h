@@ -0,0 +1,25 @@
+// This file contains the definition of the ServerLink_t struct, it is used by clients (and by the tester) to reach the server with any of
+// the supported transports. It is kept apart from Utility so that programs that never talk to the server don't depend on shared memory
+
+#ifndef SERVER_LINK_H
+#define SERVER_LINK_H
+
+#include "Packet.h"
+#include "Constants.h"
+#include "Utility.h"
+#include "ShmRing.h"
+
+typedef struct _ServerLink {
+	Transport_t transport;				// Transport used to communicate with the server
+	int sock;					// Socket connected to the server
+	ShmSegment_t* shm;				// Segment shared with the server (used only by SHM_TRANSPORT)
+} ServerLink_t;
+
+int OpenServerLink(ServerLink_t* link, Transport_t transport, const char* address, const char* portNum);
+int OpenUnixLink(ServerLink_t* link, const char* path);
+int OpenShmLink(ServerLink_t* link, const char* path);
+void CloseServerLink(ServerLink_t* link);
+int SendToServer(ServerLink_t* link, Packet_t* pack);
+int ReceiveFromServer(ServerLink_t* link, Packet_t* pack);
+
+#endif
@@ -0,0 +1,129 @@
+#include "Session.h"
+
+Session_t sessions[MAX_SESSIONS];			// Table of sessions, a token is valid only if it is stored in the slot it points to
+pthread_mutex_t sessionsMutx;				// Mutex to regulate creation of sessions
+size_t nextSlot = 0;					// Slot from which the search of a free slot starts
+
+
+// Returns current time in seconds of the monotonic clock
+static int64_t GetTimeSec()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec;
+}
+
+
+// Sets all slots of the session table as free
+int InitializeSessions()
+{
+	for(int i = 0; i < MAX_SESSIONS; i++)
+	{
+		atomic_store(&sessions[i].token, 0);
+		atomic_store(&sessions[i].permissions, 0);
+		atomic_store(&sessions[i].expiry, 0);
+		memset(sessions[i].username, '\0', MAX_NAME_SIZE);
+	}
+
+	if(pthread_mutex_init(&sessionsMutx, NULL) != 0)
+	{
+		fprintf(stderr, "Error: cannot initialize mutex for sessions...\n");
+		return 0;
+	}
+
+	return 1;
+}
+
+
+// Destroys mutex of the session table
+void DestroySessions()
+{
+	pthread_mutex_destroy(&sessionsMutx);
+}
+
+
+// Opens a new session for username with the given permissions, returns its token or 0 if all slots are used by sessions not expired yet
+uint64_t CreateSession(const char* username, unsigned int permissions)
+{
+	if(username == NULL)
+		return 0;
+
+	uint64_t random = 0;
+	while(random == 0)					// Random part of the token must never be 0 (so that token 0 is never valid)
+	{
+		if(getrandom(&random, sizeof(uint64_t), 0) != sizeof(uint64_t))
+			return 0;
+
+		random <<= SESSION_INDEX_BITS;
+	}
+
+	int64_t now = GetTimeSec();
+	uint64_t token = 0;
+	pthread_mutex_lock(&sessionsMutx);
+
+	for(size_t i = 0; i < MAX_SESSIONS; i++)		// Search a free slot (or one used by an expired session)
+	{
+		size_t index = (nextSlot + i) % MAX_SESSIONS;
+		Session_t* slot = &sessions[index];
+
+		if(atomic_load(&slot->token) != 0 && atomic_load(&slot->expiry) >= now)
+			continue;
+
+		atomic_store(&slot->token, 0);			// Invalidate old token before changing slot's content
+		atomic_store(&slot->permissions, permissions);
+		atomic_store(&slot->expiry, now + SESSION_TTL);
+		strncpy(slot->username, username, MAX_NAME_SIZE - 1);
+
+		token = random | index;
+		atomic_store(&slot->token, token);		// Publish the session
+		nextSlot = (index + 1) % MAX_SESSIONS;
+		break;
+	}
+
+	pthread_mutex_unlock(&sessionsMutx);
+	return token;
+}
+
+
+// Checks that token belongs to a valid session whose user has all required permissions and extends the session, returns 1 if it does,
+// 0 if user doesn't have such permissions and -1 if the session doesn't exist or it is expired
+int CheckSession(uint64_t token, unsigned int required)
+{
+	size_t index = token & ((1 << SESSION_INDEX_BITS) - 1);
+	if(token == 0 || index >= MAX_SESSIONS)
+		return -1;
+
+	Session_t* slot = &sessions[index];
+	if(atomic_load(&slot->token) != token)
+		return -1;
+
+	unsigned int permissions = atomic_load(&slot->permissions);
+	int64_t now = GetTimeSec();
+
+	if(atomic_load(&slot->expiry) < now || atomic_load(&slot->token) != token)	// Slot may have been reused while we were reading it
+		return -1;
+
+	atomic_store(&slot->expiry, now + SESSION_TTL);
+	return (permissions & required) == required ? 1 : 0;
+}
+
+
+// Returns the permissions needed to execute the given request
+unsigned int GetRequiredPermission(RequestType_t request)
+{
+	switch(request)
+	{
+		case GET_CONTACT:
+			return PERMISSION_READ;
+
+		case ADD_CONTACT:
+		case REMOVE_CONTACT:
+			return PERMISSION_WRITE;
+
+		case STATS:
+			return PERMISSION_ADMIN;
+
+		default:
+			return 0;
+	}
+}
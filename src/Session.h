@@ -0,0 +1,34 @@
+// This file contains the definition of the Session_t struct. When a client logs in the server creates a session that binds a random token
+// to the permissions of the user (computed only once, at login), all following requests present the token and the server can check their
+// permissions in constant time without searching the credentials tree. Sessions expire after SESSION_TTL seconds of inactivity
+
+#ifndef SESSION_H
+#define SESSION_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/random.h>
+
+#include "Packet.h"
+#include "Constants.h"
+
+#define SESSION_INDEX_BITS	16			// Low bits of a token contain the index of its slot in the session table
+
+typedef struct _Session {
+	_Atomic uint64_t token;				// Token of the session that uses this slot (0 if slot is free)
+	atomic_uint permissions;			// Bitmask of PERMISSION_... values
+	_Atomic int64_t expiry;				// Time (in seconds of the monotonic clock) after which the session is no longer valid
+	char username[MAX_NAME_SIZE];			// User that opened the session
+} Session_t;
+
+int InitializeSessions();
+void DestroySessions();
+uint64_t CreateSession(const char* username, unsigned int permissions);
+int CheckSession(uint64_t token, unsigned int required);
+unsigned int GetRequiredPermission(RequestType_t request);
+
+#endif
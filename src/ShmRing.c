@@ -0,0 +1,189 @@
+#define _GNU_SOURCE
+#include "ShmRing.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+	#define CPU_RELAX() __builtin_ia32_pause()
+#else
+	#define CPU_RELAX()
+#endif
+
+// Initializes ring as empty
+static void InitializeShmRing(ShmRing_t* ring)
+{
+	atomic_store(&ring->head, 0);
+	atomic_store(&ring->tail, 0);
+	atomic_store(&ring->sleeping, 0);
+	atomic_store(&ring->waiting, 0);
+	ring->spinLimit = SHM_MIN_SPIN;
+}
+
+
+// Creates a memfd that contains a new segment (sealed so that its size can't change) and maps it, fd is set to the memfd
+ShmSegment_t* CreateShmSegment(int* fd)
+{
+	if(fd == NULL)
+		return NULL;
+
+	*fd = memfd_create("phonebook-shm", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+	if(*fd == -1)
+	{
+		fprintf(stderr, "Error: cannot create memfd for shared memory segment\n");
+		return NULL;
+	}
+
+	if(ftruncate(*fd, sizeof(ShmSegment_t)) != 0 || fcntl(*fd, F_ADD_SEALS, SHM_SEALS) != 0)
+	{
+		fprintf(stderr, "Error: cannot set size of shared memory segment\n");
+		close(*fd);
+		*fd = -1;
+		return NULL;
+	}
+
+	ShmSegment_t* segment = MapShmSegment(*fd);
+	if(segment == NULL)
+	{
+		close(*fd);
+		*fd = -1;
+		return NULL;
+	}
+
+	InitializeShmRing(&segment->requests);
+	InitializeShmRing(&segment->responses);
+	return segment;
+}
+
+
+// Maps the segment contained in memfd fd, it fails if fd has not been sealed (the other process could shrink it under us)
+ShmSegment_t* MapShmSegment(int fd)
+{
+	struct stat info;
+	if(fstat(fd, &info) != 0 || info.st_size != sizeof(ShmSegment_t) || (fcntl(fd, F_GET_SEALS) & SHM_SEALS) != SHM_SEALS)
+	{
+		fprintf(stderr, "Error: invalid shared memory segment\n");
+		return NULL;
+	}
+
+	void* segment = mmap(NULL, sizeof(ShmSegment_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if(segment == MAP_FAILED)
+	{
+		fprintf(stderr, "Error: cannot map shared memory segment\n");
+		return NULL;
+	}
+
+	return (ShmSegment_t*) segment;
+}
+
+
+// Unmaps segment
+void UnmapShmSegment(ShmSegment_t* segment)
+{
+	if(segment != NULL)
+		munmap(segment, sizeof(ShmSegment_t));
+}
+
+
+// Copies pack in the next free slot of ring and wakes the consumer if it is sleeping, returns 0 if ring is full
+int ShmRingPush(ShmRing_t* ring, const Packet_t* pack)
+{
+	uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+	if(tail - atomic_load_explicit(&ring->head, memory_order_acquire) == SHM_RING_SLOTS)
+		return 0;
+
+	memcpy(&ring->slots[tail % SHM_RING_SLOTS], pack, sizeof(Packet_t));
+	atomic_store(&ring->tail, tail + 1);			// Sequentially consistent, it must be ordered with the load of sleeping
+
+	if(atomic_load(&ring->sleeping) == 1)
+		syscall(SYS_futex, &ring->tail, FUTEX_WAKE, 1, NULL, NULL, 0);
+
+	return 1;
+}
+
+
+// Copies in pack the oldest packet of ring and wakes the producer if it is waiting for room, returns 0 if ring is empty
+int ShmRingPop(ShmRing_t* ring, Packet_t* pack)
+{
+	uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+	if(head == atomic_load_explicit(&ring->tail, memory_order_acquire))
+		return 0;
+
+	memcpy(pack, &ring->slots[head % SHM_RING_SLOTS], sizeof(Packet_t));
+	atomic_store(&ring->head, head + 1);			// Sequentially consistent, it must be ordered with the load of waiting
+
+	if(atomic_load(&ring->waiting) == 1)
+		syscall(SYS_futex, &ring->head, FUTEX_WAKE, 1, NULL, NULL, 0);
+
+	return 1;
+}
+
+
+// Returns the number of packets in ring that have not been popped yet
+uint32_t ShmRingPending(ShmRing_t* ring)
+{
+	return atomic_load_explicit(&ring->tail, memory_order_acquire) - atomic_load_explicit(&ring->head, memory_order_relaxed);
+}
+
+
+// Waits until ring is not empty, returns 1 if there is something to pop or 0 on timeout (or if ShmRingWake() has been called)
+int ShmRingWait(ShmRing_t* ring, int timeoutMs)
+{
+	uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+
+	for(uint32_t i = 0; i < ring->spinLimit; i++)		// Spin, a response is usually only a few microseconds away
+	{
+		if(atomic_load_explicit(&ring->tail, memory_order_acquire) != head)
+		{
+			if(ring->spinLimit < SHM_MAX_SPIN)	// Spinning paid off, next time spin a bit longer
+				ring->spinLimit *= 2;
+
+			return 1;
+		}
+
+		CPU_RELAX();
+	}
+
+	if(ring->spinLimit > SHM_MIN_SPIN)			// Spinning was a waste of time, next time sleep sooner
+		ring->spinLimit /= 2;
+
+	atomic_store(&ring->sleeping, 1);
+	uint32_t tail = atomic_load(&ring->tail);		// Check again after setting sleeping so that a push can't be missed
+
+	if(tail == head)
+	{
+		struct timespec timeout;
+		timeout.tv_sec = timeoutMs / 1000;
+		timeout.tv_nsec = (timeoutMs % 1000) * 1000000L;
+		syscall(SYS_futex, &ring->tail, FUTEX_WAIT, tail, &timeout, NULL, 0);
+	}
+
+	atomic_store(&ring->sleeping, 0);
+	return atomic_load_explicit(&ring->tail, memory_order_acquire) != head;
+}
+
+
+// Waits until ring is not full, returns 1 if there is room for a push or 0 on timeout (or if ShmRingWake() has been called)
+int ShmRingWaitRoom(ShmRing_t* ring, int timeoutMs)
+{
+	uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+
+	atomic_store(&ring->waiting, 1);
+	uint32_t head = atomic_load(&ring->head);		// Check again after setting waiting so that a pop can't be missed
+
+	if(tail - head == SHM_RING_SLOTS)
+	{
+		struct timespec timeout;
+		timeout.tv_sec = timeoutMs / 1000;
+		timeout.tv_nsec = (timeoutMs % 1000) * 1000000L;
+		syscall(SYS_futex, &ring->head, FUTEX_WAIT, head, &timeout, NULL, 0);
+	}
+
+	atomic_store(&ring->waiting, 0);
+	return tail - atomic_load_explicit(&ring->head, memory_order_acquire) != SHM_RING_SLOTS;
+}
+
+
+// Wakes the consumer and the producer of ring if they are sleeping
+void ShmRingWake(ShmRing_t* ring)
+{
+	syscall(SYS_futex, &ring->tail, FUTEX_WAKE, 1, NULL, NULL, 0);
+	syscall(SYS_futex, &ring->head, FUTEX_WAKE, 1, NULL, NULL, 0);
+}
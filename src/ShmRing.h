@@ -0,0 +1,56 @@
+// This file contains the definition of the shared memory transport used by clients that run on the same host of the server. The client
+// creates a ShmSegment_t in a memfd and passes its file descriptor to the server on the unix socket, from then on requests and responses
+// are exchanged through two single-producer single-consumer rings in the segment without any syscall on the fast path. A consumer that
+// finds its ring empty spins for a while (the amount of spinning adapts to how often it pays off) and then sleeps on a futex, a producer
+// that finds its ring full sleeps on another futex until the consumer makes room
+
+#ifndef SHM_RING_H
+#define SHM_RING_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include "Packet.h"
+
+#define SHM_RING_SLOTS		64			// Number of packets that a ring can hold (must be a power of 2)
+#define SHM_MIN_SPIN		64			// Min number of times a consumer checks an empty ring before sleeping
+#define SHM_MAX_SPIN		16384			// Max number of times a consumer checks an empty ring before sleeping
+#define SHM_SEALS		(F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL)	// Seals that a segment must have (its size can't change)
+
+typedef struct _ShmRing {
+	_Atomic uint32_t head;				// Index of next slot to be read (written only by consumer), it is also the futex word of producer
+	uint32_t spinLimit;				// Times consumer checks the ring before sleeping (used only by consumer)
+	char consumerPad[56];				// Keep consumer's and producer's fields on different cache lines
+	_Atomic uint32_t tail;				// Index of next slot to be written (written only by producer), it is also the futex word
+	_Atomic uint32_t sleeping;			// Set by consumer before sleeping on the futex, so that producer knows it must wake it
+	_Atomic uint32_t waiting;			// Set by producer before sleeping on head because ring is full, so that consumer wakes it
+	char producerPad[52];
+	Packet_t slots[SHM_RING_SLOTS];
+} ShmRing_t;
+
+typedef struct _ShmSegment {
+	ShmRing_t requests;				// Requests sent by the client to the server
+	ShmRing_t responses;				// Responses sent by the server to the client
+} ShmSegment_t;
+
+ShmSegment_t* CreateShmSegment(int* fd);
+ShmSegment_t* MapShmSegment(int fd);
+void UnmapShmSegment(ShmSegment_t* segment);
+
+int ShmRingPush(ShmRing_t* ring, const Packet_t* pack);
+int ShmRingPop(ShmRing_t* ring, Packet_t* pack);
+uint32_t ShmRingPending(ShmRing_t* ring);
+int ShmRingWait(ShmRing_t* ring, int timeoutMs);
+int ShmRingWaitRoom(ShmRing_t* ring, int timeoutMs);
+void ShmRingWake(ShmRing_t* ring);
+
+#endif
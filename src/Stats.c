@@ -0,0 +1,127 @@
+#include "Stats.h"
+
+#include <malloc.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+Histogram_t histograms[STATS_TYPES][PHASES_NUM];		// Histograms of each phase of each request type
+uint64_t statsStart = 0;					// Time at which server started to record statistics
+
+const char* phaseNames[PHASES_NUM] = { "socket", "queue", "lock", "index", "persist", "total" };
+
+
+// Resets all histograms
+void InitializeStats()
+{
+	for(int i = 0; i < STATS_TYPES; i++)
+	{
+		for(int j = 0; j < PHASES_NUM; j++)
+			ResetHistogram(&histograms[i][j]);
+	}
+
+	statsStart = GetTimeNs();
+}
+
+
+// Prepares timing of a request received at time received
+void StartTiming(RequestTiming_t* timing, uint64_t received)
+{
+	memset(timing, 0, sizeof(RequestTiming_t));
+	timing->received = received;
+}
+
+
+// Records the phases of a completed request of given type
+void RecordRequest(RequestType_t type, RequestTiming_t* timing)
+{
+	if((unsigned int) type >= STATS_TYPES)
+		return;
+
+	Histogram_t* typeHistograms = histograms[type];
+
+	if(timing->arrived != 0)
+		RecordValue(&typeHistograms[SOCKET_PHASE], timing->received - timing->arrived);
+
+	if(timing->dequeued != 0)
+		RecordValue(&typeHistograms[QUEUE_PHASE], timing->dequeued - timing->received);
+
+	if(timing->locked != 0)
+		RecordValue(&typeHistograms[LOCK_PHASE], timing->locked - timing->lockRequested);
+
+	if(timing->indexed != 0)
+		RecordValue(&typeHistograms[INDEX_PHASE], timing->indexed - timing->executed);
+
+	if(timing->persisted != 0)						// Flush starts after the last request of a batch has been indexed
+		RecordValue(&typeHistograms[PERSIST_PHASE], timing->persisted - timing->flushStarted);
+
+	RecordValue(&typeHistograms[TOTAL_PHASE], timing->completed - timing->received);
+}
+
+
+// Writes in buff the summary of the histogram choosen by selector ("<request type>.<phase>", e.g. "GET_CONTACT.total"),
+// returns 0 if selector is not valid
+int FormatPhaseStats(const char* selector, char* buff, size_t size)
+{
+	const char* dot = strchr(selector, '.');
+	if(dot == NULL)
+		return 0;
+
+	for(int i = 0; i < STATS_TYPES; i++)
+	{
+		const char* typeName = GetRequestTypeName((RequestType_t) i);
+		if(strlen(typeName) != (size_t)(dot - selector) || strncmp(selector, typeName, dot - selector) != 0)
+			continue;
+
+		for(int j = 0; j < PHASES_NUM; j++)
+		{
+			if(strcmp(dot + 1, phaseNames[j]) == 0)
+			{
+				FormatHistogram(&histograms[i][j], buff, size);
+				return 1;
+			}
+		}
+	}
+
+	return 0;
+}
+
+
+// Writes in buff the number of requests completed since server started and the average throughput
+void FormatThroughput(char* buff, size_t size)
+{
+	double uptime = (GetTimeNs() - statsStart) / 1e9;
+	uint64_t completed[STATS_TYPES];
+	uint64_t total = 0;
+
+	for(int i = 0; i < STATS_TYPES; i++)
+	{
+		completed[i] = atomic_load(&histograms[i][TOTAL_PHASE].total);
+		total += completed[i];
+	}
+
+	snprintf(buff, size, "up=%.0fs rps=%.1f get=%lu add=%lu rm=%lu", uptime, uptime > 0 ? total / uptime : 0.0,
+		(unsigned long) completed[GET_CONTACT], (unsigned long) completed[ADD_CONTACT], (unsigned long) completed[REMOVE_CONTACT]);
+}
+
+
+// Writes in buff the memory used by the process and the size of the data file (all in kB): resident set size, heap bytes in use,
+// heap bytes freed but not returned to the system (grows with fragmentation) and size of the file
+void FormatProcessStats(int dataFd, char* buff, size_t size)
+{
+	unsigned long rss = 0;
+	FILE* statm = fopen("/proc/self/statm", "r");
+	if(statm != NULL)
+	{
+		unsigned long pages;
+		if(fscanf(statm, "%*u %lu", &pages) == 1)			// Second field is resident pages
+			rss = pages * (sysconf(_SC_PAGESIZE) / 1024);
+		fclose(statm);
+	}
+
+	struct mallinfo2 heap = mallinfo2();
+	struct stat info;
+	unsigned long fileSize = fstat(dataFd, &info) == 0 ? (unsigned long) info.st_size : 0;
+
+	snprintf(buff, size, "rss=%lu heap=%lu free=%lu file=%lu", rss, (unsigned long) heap.uordblks / 1024,
+		(unsigned long) heap.fordblks / 1024, fileSize / 1024);
+}
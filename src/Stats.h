@@ -0,0 +1,41 @@
+// This file contains the latency statistics of the server. For each request type the server keeps a histogram for each phase of the
+// requests: time waited in the socket buffer before the server read the request (known only for datagrams, the kernel timestamps them
+// on arrival), time waited in the queue, time waited to acquire the phonebook lock, time spent in the index, time spent flushing changes on
+// disk and total time from reception to response. Histograms are always on (recording is lock-free) and are queried with STATS requests
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "Packet.h"
+#include "Utility.h"
+#include "Histogram.h"
+
+#define STATS_TYPES		(LOGIN + 1)			// Requests types that are measured (ADD_CONTACT, GET_CONTACT, REMOVE_CONTACT, LOGIN)
+
+typedef enum { SOCKET_PHASE, QUEUE_PHASE, LOCK_PHASE, INDEX_PHASE, PERSIST_PHASE, TOTAL_PHASE, PHASES_NUM } Phase_t;
+
+typedef struct _RequestTiming {					// Timestamps of the phases of a request (0 if request skipped the phase)
+	uint64_t arrived;					// Request has been queued in the socket buffer by the kernel (0 if unknown)
+	uint64_t received;					// Request has been read from the socket
+	uint64_t dequeued;					// A worker took the request from the queue
+	uint64_t lockRequested;					// Worker started to wait for phonebook lock
+	uint64_t locked;					// Worker acquired phonebook lock
+	uint64_t executed;					// Worker started to operate on phonebook for this request
+	uint64_t indexed;					// Worker completed operation on phonebook
+	uint64_t flushStarted;					// Worker started to flush changes on disk
+	uint64_t persisted;					// Changes have been flushed on disk
+	uint64_t completed;					// Response has been sent
+} RequestTiming_t;
+
+void InitializeStats();
+void StartTiming(RequestTiming_t* timing, uint64_t received);
+void RecordRequest(RequestType_t type, RequestTiming_t* timing);
+int FormatPhaseStats(const char* selector, char* buff, size_t size);
+void FormatThroughput(char* buff, size_t size);
+void FormatProcessStats(int dataFd, char* buff, size_t size);
+
+#endif
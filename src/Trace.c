@@ -0,0 +1,229 @@
+#include "Trace.h"
+
+// Opens filename and writes the header of a trace on it, returns NULL on failure
+TraceWriter_t* OpenTraceWriter(const char* filename, int anonymize)
+{
+	if(filename == NULL)
+		return NULL;
+
+	TraceWriter_t* newWriter = calloc(1, sizeof(TraceWriter_t));
+	char* buffer = malloc(TRACE_BUFFER_SIZE);
+	if(newWriter == NULL || buffer == NULL)
+	{
+		fprintf(stderr, "Error: cannot allocate memory to hold trace writer\n");
+		free(newWriter);
+		free(buffer);
+		return NULL;
+	}
+
+	newWriter->file = fopen(filename, "wb");
+	if(newWriter->file == NULL)
+	{
+		fprintf(stderr, "Error: cannot open trace file %s\n", filename);
+		free(newWriter);
+		free(buffer);
+		return NULL;
+	}
+
+	setvbuf(newWriter->file, buffer, _IOFBF, TRACE_BUFFER_SIZE);	// Records are small, write them in big blocks
+	newWriter->buffer = buffer;
+	newWriter->anonymize = anonymize;
+	newWriter->startNs = GetTimeNs();
+
+	FILE* random = fopen("/dev/urandom", "rb");			// Salt must not be guessable, otherwise names could be brute forced
+	if(random == NULL || fread(&newWriter->salt, sizeof(uint64_t), 1, random) != 1)
+		newWriter->salt = newWriter->startNs ^ ((uint64_t) getpid() << 32);
+	if(random != NULL)
+		fclose(random);
+
+	TraceHeader_t header;
+	memset(&header, 0, sizeof(TraceHeader_t));
+	memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+	header.version = TRACE_VERSION;
+	header.flags = anonymize != 0 ? TRACE_ANONYMIZED : 0;
+
+	if(fwrite(&header, sizeof(TraceHeader_t), 1, newWriter->file) != 1)
+	{
+		fprintf(stderr, "Error: cannot write header of trace file %s\n", filename);
+		CloseTraceWriter(&newWriter);
+		return NULL;
+	}
+
+	return newWriter;
+}
+
+
+// Writes records still buffered on file, closes it and deallocates writer
+void CloseTraceWriter(TraceWriter_t** writer)
+{
+	if(writer == NULL || *writer == NULL)
+		return;
+
+	fclose((*writer)->file);
+	free((*writer)->buffer);
+	free(*writer);
+	*writer = NULL;
+}
+
+
+// Appends to trace a record of request arrived at arrivalNs (requests that don't use the phonebook are ignored, as every request if
+// writer is NULL), it can be called concurrently by many threads
+void WriteTraceRecord(TraceWriter_t* writer, Packet_t* request, uint64_t arrivalNs)
+{
+	if(writer == NULL || (request->type != ADD_CONTACT && request->type != GET_CONTACT && request->type != REMOVE_CONTACT))
+		return;
+
+	uint8_t record[sizeof(uint64_t) + 2 + MAX_NAME_SIZE];
+	uint64_t offset = arrivalNs > writer->startNs ? arrivalNs - writer->startNs : 0;
+	char* name = (char*)(record + sizeof(uint64_t) + 2);
+
+	if(writer->anonymize != 0)
+	{
+		uint64_t hash = (HashString(request->name, MAX_NAME_SIZE) ^ writer->salt) * 0x9e3779b97f4a7c15ULL;
+		snprintf(name, MAX_NAME_SIZE, "k%016llx", (unsigned long long) hash);
+	}
+	else
+		strncpy(name, request->name, MAX_NAME_SIZE - 1);
+
+	size_t nameLength = strnlen(name, MAX_NAME_SIZE - 1);
+	memcpy(record, &offset, sizeof(uint64_t));
+	record[sizeof(uint64_t)] = (uint8_t) request->type;
+	record[sizeof(uint64_t) + 1] = (uint8_t) nameLength;
+
+	fwrite(record, sizeof(uint64_t) + 2 + nameLength, 1, writer->file);	// A single call, so records of different threads don't mix
+}
+
+
+// Compares arrival times of two records, used by qsort()
+static int CompareRecords(const void* a, const void* b)
+{
+	uint64_t first = ((const TraceRecord_t*) a)->arrivalNs;
+	uint64_t second = ((const TraceRecord_t*) b)->arrivalNs;
+	return (first > second) - (first < second);
+}
+
+
+// Loads all records of trace file filename sorted by arrival time (threads of the server may have written them slightly out of order),
+// stores their number in recordsNum and the flags of the trace in flags, returns NULL on failure
+TraceRecord_t* LoadTrace(const char* filename, size_t* recordsNum, uint8_t* flags)
+{
+	FILE* file = fopen(filename, "rb");
+	if(file == NULL)
+	{
+		fprintf(stderr, "Error: cannot open trace file %s\n", filename);
+		return NULL;
+	}
+
+	TraceHeader_t header;
+	if(fread(&header, sizeof(TraceHeader_t), 1, file) != 1 || memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) != 0 ||
+		header.version != TRACE_VERSION)
+	{
+		fprintf(stderr, "Error: %s is not a trace file\n", filename);
+		fclose(file);
+		return NULL;
+	}
+
+	size_t capacity = 1024;
+	size_t loaded = 0;
+	TraceRecord_t* records = malloc(sizeof(TraceRecord_t) * capacity);
+
+	uint8_t fixed[sizeof(uint64_t) + 2];
+	while(records != NULL && fread(fixed, sizeof(fixed), 1, file) == 1)
+	{
+		if(loaded == capacity)
+		{
+			TraceRecord_t* newRecords = realloc(records, sizeof(TraceRecord_t) * capacity * 2);
+			if(newRecords == NULL)
+			{
+				free(records);
+				records = NULL;
+				break;
+			}
+
+			records = newRecords;
+			capacity *= 2;
+		}
+
+		TraceRecord_t* curr = &records[loaded];
+		size_t nameLength = fixed[sizeof(uint64_t) + 1];
+		memcpy(&curr->arrivalNs, fixed, sizeof(uint64_t));
+		curr->type = (RequestType_t) fixed[sizeof(uint64_t)];
+
+		if(nameLength >= MAX_NAME_SIZE || fread(curr->name, nameLength, 1, file) != 1)	// Last record may be truncated if server crashed
+			break;
+
+		if(curr->type != ADD_CONTACT && curr->type != GET_CONTACT && curr->type != REMOVE_CONTACT)	// Only these are ever recorded
+		{
+			fprintf(stderr, "Error: record %lu of %s has invalid request type %u, trace is corrupted\n", (unsigned long) loaded, filename,
+				(unsigned int) fixed[sizeof(uint64_t)]);
+			free(records);
+			fclose(file);
+			return NULL;
+		}
+
+		curr->name[nameLength] = '\0';
+		loaded++;
+	}
+
+	fclose(file);
+
+	if(records == NULL)
+	{
+		fprintf(stderr, "Error: cannot allocate memory to hold trace\n");
+		return NULL;
+	}
+
+	qsort(records, loaded, sizeof(TraceRecord_t), CompareRecords);
+	*recordsNum = loaded;
+	if(flags != NULL)
+		*flags = header.flags;
+
+	return records;
+}
+
+
+// Replaces anonymized names of records with names of keys (keysNum names, e.g. loaded from a phonebook file), so that a replay looks for
+// contacts that exist: every distinct name first used by a GET_CONTACT or REMOVE_CONTACT is given its own key (in order of first use,
+// wrapping around if there are more names than keys), so requests for the same name still go to the same key. Names first used by an
+// ADD_CONTACT were not in the phonebook when the trace was recorded, so they keep their hash. Returns number of names mapped or -1 on failure
+long MapTraceNames(TraceRecord_t* records, size_t recordsNum, char (*keys)[MAX_NAME_SIZE], size_t keysNum)
+{
+	if(keysNum == 0)
+		return 0;
+
+	size_t tableSize = 1;							// Open addressing table from hash of a name to its key (or to none)
+	while(tableSize < recordsNum * 2)
+		tableSize *= 2;
+
+	uint64_t* hashes = calloc(tableSize, sizeof(uint64_t));
+	long* mapped = malloc(tableSize * sizeof(long));
+	if(hashes == NULL || mapped == NULL)
+	{
+		fprintf(stderr, "Error: cannot allocate memory to map trace names\n");
+		free(hashes);
+		free(mapped);
+		return -1;
+	}
+
+	long mappedNum = 0;
+	for(size_t i = 0; i < recordsNum; i++)
+	{
+		uint64_t hash = HashString(records[i].name, MAX_NAME_SIZE) | 1;	// 0 marks empty slots
+		size_t slot = hash & (tableSize - 1);
+		while(hashes[slot] != 0 && hashes[slot] != hash)
+			slot = (slot + 1) & (tableSize - 1);
+
+		if(hashes[slot] == 0)						// First use of this name
+		{
+			hashes[slot] = hash;
+			mapped[slot] = records[i].type == ADD_CONTACT ? -1 : mappedNum++;
+		}
+
+		if(mapped[slot] != -1)
+			strncpy(records[i].name, keys[mapped[slot] % keysNum], MAX_NAME_SIZE);
+	}
+
+	free(hashes);
+	free(mapped);
+	return mappedNum;
+}
@@ -0,0 +1,54 @@
+
+// This file contains the functions that record and load traces of requests, used to replay real traffic against the server. A trace
+// starts with a TraceHeader_t and then contains a record for each request: arrival time (ns since trace was opened, 8 bytes), type
+// (1 byte), length of the name (1 byte) and the name without terminator. Only phonebook requests are recorded (never logins, that carry
+// passwords). When names are anonymized they are replaced by a salted hash, so that requests for the same name still look for the same
+// key but the contacts can't be recovered from the trace; such names are not in any phonebook, so before replaying them they must be
+// mapped onto real keys (MapTraceNames()) or every lookup misses. Each record is written with a single fwrite(), so threads need no other lock
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "Constants.h"
+#include "Packet.h"
+#include "Utility.h"
+
+#define TRACE_MAGIC		"PBTR"			// First bytes of a trace file
+#define TRACE_VERSION		1			// Version of the format of trace files
+#define TRACE_ANONYMIZED	0x1			// Flag of the header set when names have been anonymized
+#define TRACE_BUFFER_SIZE	(1 << 20)		// Bytes of records buffered before writing them on file
+
+typedef struct _TraceHeader {
+	char magic[4];					// TRACE_MAGIC
+	uint8_t version;				// TRACE_VERSION
+	uint8_t flags;					// TRACE_ANONYMIZED if names have been anonymized
+	uint16_t reserved;
+} TraceHeader_t;
+
+typedef struct _TraceWriter {
+	FILE* file;					// File on which records are written
+	char* buffer;					// Buffer of file (TRACE_BUFFER_SIZE bytes)
+	int anonymize;					// Tells if names must be replaced by their hash
+	uint64_t salt;					// Salt of the hash used to anonymize names
+	uint64_t startNs;				// Time at which trace has been opened, arrival times are relative to it
+} TraceWriter_t;
+
+typedef struct _TraceRecord {
+	uint64_t arrivalNs;				// Arrival time of request, relative to the beginning of the trace
+	RequestType_t type;				// Type of request
+	char name[MAX_NAME_SIZE];			// Name used by request
+} TraceRecord_t;
+
+TraceWriter_t* OpenTraceWriter(const char* filename, int anonymize);
+void CloseTraceWriter(TraceWriter_t** writer);
+void WriteTraceRecord(TraceWriter_t* writer, Packet_t* request, uint64_t arrivalNs);
+TraceRecord_t* LoadTrace(const char* filename, size_t* recordsNum, uint8_t* flags);
+long MapTraceNames(TraceRecord_t* records, size_t recordsNum, char (*keys)[MAX_NAME_SIZE], size_t keysNum);
+
+#endif
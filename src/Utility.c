@@ -66,14 +66,49 @@ int IsPermissionsValid(const char* perm)
 }
 
 
-// Uses sock to send pack to specified address, returns 0 on failure 1 otherwise
-int SendPacket(int sock, Packet_t* pack, struct sockaddr_in* addr, socklen_t addrLen)
+// Returns current value of the monotonic clock in nanoseconds, used to measure elapsed time
+uint64_t GetTimeNs()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t) now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+
+// Returns FNV-1a hash of str (at most maxLength chars are considered)
+uint64_t HashString(const char* str, size_t maxLength)
+{
+	uint64_t hash = 14695981039346656037ULL;
+	for(size_t i = 0; i < maxLength && str[i] != '\0'; i++)
+	{
+		hash ^= (unsigned char) str[i];
+		hash *= 1099511628211ULL;
+	}
+
+	return hash;
+}
+
+
+// Returns the name of a packet type
+const char* GetRequestTypeName(RequestType_t type)
+{
+	static const char* names[] = { "ADD_CONTACT", "GET_CONTACT", "REMOVE_CONTACT", "LOGIN", "ACCEPTED", "REJECTED", "ATTACH_SHM", "BUSY", "STATS" };
+
+	if((unsigned int) type >= sizeof(names) / sizeof(char*))
+		return "INVALID";
+
+	return names[type];
+}
+
+
+// Uses sock to send pack to specified address (flags are passed to sendto()), returns 0 on failure 1 otherwise
+int SendPacket(int sock, Packet_t* pack, struct sockaddr_in* addr, socklen_t addrLen, int flags)
 {
 	if(sock == -1 || pack == NULL || addr == NULL)
 		return 0;
 
 	size_t bytesSent = 0;
-	bytesSent = sendto(sock, pack, sizeof(Packet_t), 0, (struct sockaddr*) addr, addrLen);
+	bytesSent = sendto(sock, pack, sizeof(Packet_t), flags, (struct sockaddr*) addr, addrLen);
 
 	if(bytesSent != sizeof(Packet_t))			// Check that right amount of data has been sent
 	{
@@ -109,3 +144,145 @@ int ReceivePacket(int sock, Packet_t* pack)
 
 	return 1;
 }
+
+
+// Uses stream socket sock to send pack preceded by its length (flags are passed to send()), returns 0 on failure 1 otherwise. On failure
+// part of the frame may have been sent
+int SendFramedPacket(int sock, Packet_t* pack, int flags)
+{
+	if(sock == -1 || pack == NULL)
+		return 0;
+
+	unsigned char frame[FRAME_HEADER_SIZE + sizeof(Packet_t)];
+	uint32_t length = htonl(sizeof(Packet_t));
+
+	memcpy(frame, &length, FRAME_HEADER_SIZE);			// Header and packet are sent with a single call
+	memcpy(frame + FRAME_HEADER_SIZE, pack, sizeof(Packet_t));
+
+	size_t sent = 0;
+	while(sent < sizeof(frame))					// Stream sockets may accept only part of the data
+	{
+		ssize_t bytesSent = send(sock, frame + sent, sizeof(frame) - sent, flags | MSG_NOSIGNAL);
+		if(bytesSent <= 0)
+			return 0;
+
+		sent += bytesSent;
+	}
+
+	return 1;
+}
+
+
+// Uses stream socket sock to receive a frame and stores its content in pack. A timeout is reported only if no byte of the frame has arrived:
+// once a frame is started it is read to the end (waiting at most another receive timeout), because giving up in the middle of it would
+// leave next reads out of sync. If the frame can't be completed or is corrupted, the socket is shut down so that all next operations fail
+int ReceiveFramedPacket(int sock, Packet_t* pack)
+{
+	if(sock == -1 || pack == NULL)
+		return 0;
+
+	unsigned char frame[FRAME_HEADER_SIZE + sizeof(Packet_t)];
+	size_t received = 0;
+	int late = 0;						// Set once a started frame has already missed a receive timeout
+
+	while(received < sizeof(frame))
+	{
+		size_t toRead = received < FRAME_HEADER_SIZE ? FRAME_HEADER_SIZE - received : sizeof(frame) - received;
+		errno = 0;
+		ssize_t bytesReceived = recv(sock, frame + received, toRead, MSG_WAITALL);
+
+		if(bytesReceived > 0)
+		{
+			received += bytesReceived;
+			uint32_t length;
+			memcpy(&length, frame, FRAME_HEADER_SIZE);
+			if(received == FRAME_HEADER_SIZE && ntohl(length) != sizeof(Packet_t))
+			{
+				shutdown(sock, SHUT_RDWR);
+				snprintf(pack->name, MAX_NAME_SIZE, "Received corrupted packet...");
+				return 0;
+			}
+			continue;
+		}
+
+		if(bytesReceived == -1 && errno == EINTR)
+			continue;
+
+		if(bytesReceived == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+		{
+			if(received == 0)				// Timeout occurred between frames, stream is still in sync
+			{
+				snprintf(pack->name, MAX_NAME_SIZE, "Timeout error...");
+				return 0;
+			}
+
+			if(late == 0)					// Rest of the frame is late, keep waiting for it
+			{
+				late = 1;
+				continue;
+			}
+		}
+
+		if(received != 0)
+			shutdown(sock, SHUT_RDWR);
+		snprintf(pack->name, MAX_NAME_SIZE, bytesReceived == 0 ? "Connection closed by server..." : "Received corrupted packet...");
+		return 0;
+	}
+
+	memcpy(pack, frame + FRAME_HEADER_SIZE, sizeof(Packet_t));
+	return 1;
+}
+
+
+// Uses unix socket sock to send pack together with file descriptor fd (the receiver gets its own copy of the descriptor)
+int SendPacketWithFd(int sock, Packet_t* pack, int fd)
+{
+	if(sock == -1 || pack == NULL || fd == -1)
+		return 0;
+
+	struct iovec data;
+	data.iov_base = pack;
+	data.iov_len = sizeof(Packet_t);
+
+	union {							// Buffer for control message, union ensures it is correctly aligned
+		char buffer[CMSG_SPACE(sizeof(int))];
+		struct cmsghdr align;
+	} control;
+	memset(&control, 0, sizeof(control));
+
+	struct msghdr msg;
+	memset(&msg, 0, sizeof(struct msghdr));
+	msg.msg_iov = &data;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control.buffer;
+	msg.msg_controllen = sizeof(control.buffer);
+
+	struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+	memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+
+	return sendmsg(sock, &msg, MSG_NOSIGNAL) == sizeof(Packet_t);
+}
+
+
+// Converts str ("udp", "tcp", "unix" or "shm") in the corresponding transport, returns 0 if str is not a valid transport
+int ParseTransport(const char* str, Transport_t* transport)
+{
+	if(str == NULL || transport == NULL)
+		return 0;
+
+	if(strcmp(str, "udp") == 0)
+		*transport = UDP_TRANSPORT;
+	else if(strcmp(str, "tcp") == 0)
+		*transport = TCP_TRANSPORT;
+	else if(strcmp(str, "unix") == 0)
+		*transport = UNIX_TRANSPORT;
+	else if(strcmp(str, "shm") == 0)
+		*transport = SHM_TRANSPORT;
+	else
+		return 0;
+
+	return 1;
+}
@@ -8,18 +8,39 @@
 #include <stdio.h>
 #include <string.h>
 #include <errno.h>
+#include <stdint.h>
+#include <unistd.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/time.h>
+#include <time.h>
+#include <sys/un.h>
 #include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
 
 #include "Packet.h"
 #include "Constants.h"
 
+#define FRAME_HEADER_SIZE	sizeof(uint32_t)	// On stream sockets every packet is preceded by its length (in network byte order)
+
+typedef enum { UDP_TRANSPORT, TCP_TRANSPORT, UNIX_TRANSPORT, SHM_TRANSPORT } Transport_t;
+
 int IsNameValid(const char* name, size_t maxLength);
 int IsNumberValid(const char* num, size_t maxSize);
 int IsPermissionsValid(const char* perm);
 
-int SendPacket(int sock, Packet_t* pack, struct sockaddr_in* addr, socklen_t addrLen);
+uint64_t GetTimeNs();
+uint64_t HashString(const char* str, size_t maxLength);
+const char* GetRequestTypeName(RequestType_t type);
+
+int SendPacket(int sock, Packet_t* pack, struct sockaddr_in* addr, socklen_t addrLen, int flags);
 int ReceivePacket(int sock, Packet_t* pack);
+int SendFramedPacket(int sock, Packet_t* pack, int flags);
+int ReceiveFramedPacket(int sock, Packet_t* pack);
+int SendPacketWithFd(int sock, Packet_t* pack, int fd);
+
+int ParseTransport(const char* str, Transport_t* transport);
 
 #endif
@@ -0,0 +1,299 @@
+#include "Workload.h"
+
+// Returns a random number in [0, 1)
+static double GetUniform(unsigned int* seed)
+{
+	uint64_t bits = ((uint64_t) rand_r(seed) << 31) ^ (uint64_t) rand_r(seed);
+	return (bits & ((1ULL << 53) - 1)) / (double)(1ULL << 53);
+}
+
+
+// Returns log(1 + x) / x, accurate also when x is close to 0
+static double Helper1(double x)
+{
+	return fabs(x) > 1e-8 ? log1p(x) / x : 1.0 - x * (0.5 - x * (1.0 / 3.0 - 0.25 * x));
+}
+
+
+// Returns (exp(x) - 1) / x, accurate also when x is close to 0
+static double Helper2(double x)
+{
+	return fabs(x) > 1e-8 ? expm1(x) / x : 1.0 + x * 0.5 * (1.0 + x / 3.0 * (1.0 + 0.25 * x));
+}
+
+
+// Integral of 1 / x^exponent (shifted so that it works also when exponent is 1)
+static double HIntegral(double x, double exponent)
+{
+	double logX = log(x);
+	return Helper2((1.0 - exponent) * logX) * logX;
+}
+
+
+// Returns 1 / x^exponent
+static double H(double x, double exponent)
+{
+	return exp(-exponent * log(x));
+}
+
+
+// Inverse of HIntegral()
+static double HIntegralInverse(double x, double exponent)
+{
+	double t = x * (1.0 - exponent);
+	if(t < -1.0)
+		t = -1.0;
+
+	return exp(Helper1(t) * x);
+}
+
+
+// Returns a rank in [1, n] chosen with probability proportional to 1 / rank^exponent, using rejection-inversion sampling
+// (Hormann and Derflinger) so that no table has to be built and n can change between calls
+static size_t GetZipfRank(Workload_t* workload, size_t n, unsigned int* seed)
+{
+	double hIntegralN = HIntegral(n + 0.5, workload->exponent);
+
+	while(1)
+	{
+		double u = hIntegralN + GetUniform(seed) * (workload->zipfX1 - hIntegralN);
+		double x = HIntegralInverse(u, workload->exponent);
+		size_t rank = (size_t)(x + 0.5);
+
+		if(rank < 1)
+			rank = 1;
+		else if(rank > n)
+			rank = n;
+
+		if(rank - x <= workload->zipfS || u >= HIntegral(rank + 0.5, workload->exponent) - H(rank, workload->exponent))
+			return rank;
+	}
+}
+
+
+// Parses distribution (uniform, zipf[:exponent], hotspot[:hot fraction[:hot probability]] or latest[:exponent]) and stores it in
+// workload, returns 0 if it is not valid
+static int ParseDistribution(Workload_t* workload, const char* distribution)
+{
+	workload->exponent = 0.99;					// Default values are the ones used by YCSB
+	workload->hotFraction = 0.2;
+	workload->hotProbability = 0.8;
+
+	if(strcmp(distribution, "uniform") == 0)
+		workload->distribution = UNIFORM_KEYS;
+	else if(strncmp(distribution, "zipf", 4) == 0 && (distribution[4] == '\0' || sscanf(distribution + 4, ":%lf", &workload->exponent) == 1))
+		workload->distribution = ZIPF_KEYS;
+	else if(strncmp(distribution, "latest", 6) == 0 && (distribution[6] == '\0' || sscanf(distribution + 6, ":%lf", &workload->exponent) == 1))
+		workload->distribution = LATEST_KEYS;
+	else if(strncmp(distribution, "hotspot", 7) == 0 && (distribution[7] == '\0' ||
+		sscanf(distribution + 7, ":%lf:%lf", &workload->hotFraction, &workload->hotProbability) >= 1))
+		workload->distribution = HOTSPOT_KEYS;
+	else
+		return 0;
+
+	if(workload->exponent <= 0 || workload->hotFraction <= 0 || workload->hotFraction > 1 || workload->hotProbability < 0 ||
+		workload->hotProbability > 1)
+		return 0;
+
+	workload->zipfX1 = HIntegral(1.5, workload->exponent) - 1.0;
+	workload->zipfS = 2.0 - HIntegralInverse(HIntegral(2.5, workload->exponent) - H(2.0, workload->exponent), workload->exponent);
+	return 1;
+}
+
+
+// Loads names of the entries of phonebook file filename in workload (entries removed are skipped), then shuffles them, returns 0 on failure
+static int LoadKeys(Workload_t* workload, const char* filename)
+{
+	FILE* file = fopen(filename, "r");
+	if(file == NULL)
+	{
+		fprintf(stderr, "Error: cannot open %s\n", filename);
+		return 0;
+	}
+
+	struct stat info;						// Estimate number of entries from file size to avoid reallocations
+	size_t capacity = 1024;
+	if(fstat(fileno(file), &info) == 0 && (size_t) info.st_size / AVG_ENTRY_SIZE > capacity)
+		capacity = (size_t) info.st_size / AVG_ENTRY_SIZE;
+
+	workload->keys = malloc(capacity * MAX_NAME_SIZE);
+	if(workload->keys == NULL)
+	{
+		fprintf(stderr, "Error: cannot allocate memory to hold keys\n");
+		fclose(file);
+		return 0;
+	}
+
+	char line[MAX_NAME_SIZE + MAX_PHONE_NUM_SIZE + 2];
+	while(fgets(line, sizeof(line), file) != NULL)
+	{
+		char* separator = strchr(line, SEPARATOR_CHAR);
+		if(line[0] == REMOVED_CHAR || separator == NULL || separator == line)	// Skip removed entries and malformed lines
+			continue;
+
+		if(workload->loadedNum == capacity)
+		{
+			char (*newKeys)[MAX_NAME_SIZE] = realloc(workload->keys, capacity * 2 * MAX_NAME_SIZE);
+			if(newKeys == NULL)
+			{
+				fprintf(stderr, "Error: cannot allocate memory to hold keys\n");
+				fclose(file);
+				return 0;
+			}
+
+			workload->keys = newKeys;
+			capacity *= 2;
+		}
+
+		*separator = '\0';
+		strncpy(workload->keys[workload->loadedNum], line, MAX_NAME_SIZE - 1);
+		workload->keys[workload->loadedNum][MAX_NAME_SIZE - 1] = '\0';
+		workload->loadedNum++;
+	}
+
+	fclose(file);
+
+	if(workload->loadedNum == 0)
+	{
+		fprintf(stderr, "Error: %s does not contain any entry\n", filename);
+		return 0;
+	}
+
+	unsigned int seed = 1;						// Fixed seed, so that runs on the same file have the same popular keys
+	char tmp[MAX_NAME_SIZE];
+	for(size_t i = workload->loadedNum - 1; i > 0; i--)
+	{
+		size_t j = (size_t)(GetUniform(&seed) * (i + 1));
+		memcpy(tmp, workload->keys[i], MAX_NAME_SIZE);
+		memcpy(workload->keys[i], workload->keys[j], MAX_NAME_SIZE);
+		memcpy(workload->keys[j], tmp, MAX_NAME_SIZE);
+	}
+
+	return 1;
+}
+
+
+// Creates a workload with keys loaded from phonebook file filename (or DEFAULT_LOAD_KEYS synthetic keys if filename is NULL), that
+// chooses keys with given distribution and looks for missing names with probability missRatio, returns NULL on failure
+Workload_t* CreateWorkload(const char* filename, const char* distribution, double missRatio)
+{
+	if(distribution == NULL || missRatio < 0 || missRatio > 1)
+	{
+		fprintf(stderr, "Error: miss ratio must be between 0 and 1\n");
+		return NULL;
+	}
+
+	Workload_t* newWorkload = calloc(1, sizeof(Workload_t));
+	if(newWorkload == NULL)
+	{
+		fprintf(stderr, "Error: cannot allocate memory to hold workload\n");
+		return NULL;
+	}
+
+	newWorkload->missRatio = missRatio;
+	if(ParseDistribution(newWorkload, distribution) == 0)
+	{
+		fprintf(stderr, "Error: distribution must be uniform, zipf[:exponent], hotspot[:fraction[:probability]] or latest[:exponent]\n");
+		free(newWorkload);
+		return NULL;
+	}
+
+	if(filename == NULL)
+		newWorkload->loadedNum = DEFAULT_LOAD_KEYS;
+	else if(LoadKeys(newWorkload, filename) == 0)
+	{
+		free(newWorkload->keys);
+		free(newWorkload);
+		return NULL;
+	}
+
+	atomic_init(&newWorkload->keysNum, newWorkload->loadedNum);
+	return newWorkload;
+}
+
+
+// Deallocates workload
+void DestroyWorkload(Workload_t** workload)
+{
+	if(workload == NULL || *workload == NULL)
+		return;
+
+	free((*workload)->keys);
+	free(*workload);
+	*workload = NULL;
+}
+
+
+// Stores in name (MAX_NAME_SIZE bytes) the name that a request of given type must use (it can be called concurrently by many threads,
+// each one with its own seed)
+void ChooseKey(Workload_t* workload, RequestType_t type, char* name, unsigned int* seed)
+{
+	size_t index;
+
+	if(type == ADD_CONTACT)
+		index = atomic_fetch_add(&workload->keysNum, 1);
+	else if(workload->missRatio > 0 && GetUniform(seed) < workload->missRatio)
+	{
+		snprintf(name, MAX_NAME_SIZE, "Missing%u", (unsigned int) rand_r(seed));
+		return;
+	}
+	else
+	{
+		size_t n = atomic_load(&workload->keysNum);
+		size_t hot = (size_t)(n * workload->hotFraction);
+
+		switch(workload->distribution)
+		{
+			case ZIPF_KEYS:
+				index = GetZipfRank(workload, n, seed) - 1;
+				break;
+
+			case LATEST_KEYS:
+				index = n - GetZipfRank(workload, n, seed);
+				break;
+
+			case HOTSPOT_KEYS:
+				if(hot == 0)
+					hot = 1;
+
+				if(hot == n || GetUniform(seed) < workload->hotProbability)
+					index = (size_t)(GetUniform(seed) * hot);
+				else
+					index = hot + (size_t)(GetUniform(seed) * (n - hot));
+				break;
+
+			default:
+				index = (size_t)(GetUniform(seed) * n);
+				break;
+		}
+	}
+
+	GetKeyName(workload, index, name);
+}
+
+
+// Stores in name (MAX_NAME_SIZE bytes) the name of the key at index (loaded keys come first, then synthetic ones)
+void GetKeyName(Workload_t* workload, size_t index, char* name)
+{
+	if(workload->keys != NULL && index < workload->loadedNum)
+		strncpy(name, workload->keys[index], MAX_NAME_SIZE);
+	else
+		snprintf(name, MAX_NAME_SIZE, "Load%lu", (unsigned long) index);
+}
+
+
+// Writes a description of workload in buff
+void FormatWorkload(Workload_t* workload, char* buff, size_t size)
+{
+	const char* names[] = { "uniform", "zipf", "hotspot", "latest" };
+
+	if(workload->distribution == HOTSPOT_KEYS)
+		snprintf(buff, size, "%s %.2f/%.2f on %lu keys, miss ratio %.2f", names[workload->distribution], workload->hotFraction,
+			workload->hotProbability, (unsigned long) workload->loadedNum, workload->missRatio);
+	else if(workload->distribution != UNIFORM_KEYS)
+		snprintf(buff, size, "%s %.2f on %lu keys, miss ratio %.2f", names[workload->distribution], workload->exponent,
+			(unsigned long) workload->loadedNum, workload->missRatio);
+	else
+		snprintf(buff, size, "%s on %lu keys, miss ratio %.2f", names[workload->distribution], (unsigned long) workload->loadedNum,
+			workload->missRatio);
+}
@@ -0,0 +1,44 @@
+// This file contains the definition of the Workload_t struct, it chooses the names used by the tester's requests. Keys are loaded from a
+// phonebook file (or are the synthetic names Load0, Load1, ... when no file is given, which tester adds to the phonebook before the load
+// starts) and shuffled once, so that the popularity of a key does not depend on its position in the file. Reads and removals pick a key
+// with a uniform, Zipfian (rank r is chosen with probability proportional to 1 / r^exponent), hotspot (hotProbability of the requests
+// go to the first hotFraction of the keys) or latest (Zipfian on the keys ordered from the most recently inserted) distribution, or a
+// name that is not in the phonebook with probability missRatio. Additions always insert a new key (named Load<index>) that becomes
+// visible to the following requests
+
+#ifndef WORKLOAD_H
+#define WORKLOAD_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <stdatomic.h>
+#include <sys/stat.h>
+
+#include "Constants.h"
+#include "Packet.h"
+
+typedef enum { UNIFORM_KEYS, ZIPF_KEYS, HOTSPOT_KEYS, LATEST_KEYS } KeyDistribution_t;
+
+typedef struct _Workload {
+	char (*keys)[MAX_NAME_SIZE];			// Names loaded from phonebook file (NULL if keys are synthetic)
+	size_t loadedNum;				// Number of keys loaded (or synthetic keys)
+	_Atomic size_t keysNum;				// Number of keys, including the ones inserted by ADD_CONTACT requests
+	KeyDistribution_t distribution;			// Distribution used to choose keys of GET_CONTACT and REMOVE_CONTACT requests
+	double exponent;				// Exponent of ZIPF_KEYS and LATEST_KEYS distributions
+	double hotFraction;				// Fraction of keys that are hot (HOTSPOT_KEYS)
+	double hotProbability;				// Probability that a request goes to a hot key (HOTSPOT_KEYS)
+	double missRatio;				// Probability that a request looks for a name that is not in the phonebook
+	double zipfX1;					// Constant of rejection-inversion sampling that depends only on exponent
+	double zipfS;					// Constant of rejection-inversion sampling that depends only on exponent
+} Workload_t;
+
+Workload_t* CreateWorkload(const char* filename, const char* distribution, double missRatio);
+void DestroyWorkload(Workload_t** workload);
+void ChooseKey(Workload_t* workload, RequestType_t type, char* name, unsigned int* seed);
+void GetKeyName(Workload_t* workload, size_t index, char* name);
+void FormatWorkload(Workload_t* workload, char* buff, size_t size);
+
+#endif
@@ -0,0 +1,539 @@
+// Microbenchmarks of the index (Bst) and persistence (data file) layers of the phonebook, they are linked directly with the server's
+// sources so that the cost of a single operation can be measured without network, threads and locks. Every operation is run on trees
+// of 1K, 10K, ... entries: warmup repetitions are discarded, then median and min of the others are printed with allocations per
+// operation (malloc, calloc and realloc are wrapped by the linker, see bench target in makefile). Since the cost of some operations grows
+// faster than the size, the time of the next size is estimated from how ns/op of each operation has grown between the last two sizes
+// and sizes that would exceed the budget are skipped. Hardware performance counters (cycles, instructions, last level cache, branch and
+// dTLB misses) and page faults are read around each measured section and printed per operation, averaged over measured repetitions,
+// counters that the kernel doesn't allow to read (no PMU, e.g. in some virtual machines, or perf_event_paranoid) are printed as "-".
+// With -o results are also written as JSON (see Results.h), ns/op of each repetition are the samples used to compare runs
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "Constants.h"
+#include "Utility.h"
+#include "Bst.h"
+#include "Phonebook.h"
+#include "PerfCounters.h"
+#include "Results.h"
+
+#define BENCH_MIN_SIZE		1000			// Number of entries of the smallest tree
+#define BENCH_MAX_SIZE		10000000		// Default number of entries of the biggest tree
+#define BENCH_REPETITIONS	5			// Default number of measured repetitions of each operation
+#define BENCH_WARMUP		1			// Default number of repetitions that are run before measuring
+#define BENCH_BUDGET		60			// Default max number of seconds that all repetitions of a size may take
+#define BENCH_SYNC_OPS		256			// Max number of appends followed by fsync measured for each size (they are slow)
+
+typedef enum { OP_INSERT, OP_LOOKUP_HIT, OP_LOOKUP_MISS, OP_DELETE, OP_LOAD, OP_APPEND, OP_APPEND_SYNC, OP_NUM } Operation_t;
+
+typedef struct _Measure {
+	double nsPerOp[BENCH_REPETITIONS * 4];		// Time per operation of each measured repetition
+	double allocsPerOp;				// Allocations per operation (of last repetition, they don't change)
+	double eventsPerOp[COUNTERS_NUM];		// Value of each counter per operation, summed over measured repetitions
+	int repetitions;				// Number of repetitions measured
+} Measure_t;
+
+typedef struct _Section {
+	uint64_t start;					// Time at which section has started
+	uint64_t time;					// Elapsed time of section
+	size_t allocs;					// Allocations made in section
+	uint64_t events[COUNTERS_NUM];			// Value of each counter in section (PERF_UNAVAILABLE if it can't be read)
+} Section_t;
+
+
+void GetName(size_t index, char* name);
+void GetMissingName(size_t index, char* name);
+size_t Shuffle(size_t index, size_t size);
+void FreeTree(BstNode_t* root);
+size_t GetOperationsNum(Operation_t op, size_t size);
+int RunSize(size_t size, int repetitions, int warmup, double budget, const char* dir, double* medians, Results_t* results);
+int WriteDataFile(const char* filename, size_t size);
+double PrintMeasure(Operation_t op, size_t size, Measure_t* measure, Results_t* results);
+int CompareDoubles(const void* a, const void* b);
+void StartSection(Section_t* section);
+void StopSection(Section_t* section);
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t num, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+
+
+static const char* opNames[] = { "insert", "lookup_hit", "lookup_miss", "delete", "load", "append", "append_fsync" };
+static const char* counterColumns[] = { "cyc/op", "ins/op", "llc/op", "brm/op", "dtlb/op", "flt/op" };
+size_t allocations = 0;				// Number of allocations made since program started (benchmarks are single threaded)
+PerfCounters_t counters;			// Counters read around each measured section
+
+
+int main(int argc, char* argv[])
+{
+	int repetitions = BENCH_REPETITIONS;
+	int warmup = BENCH_WARMUP;
+	double budget = BENCH_BUDGET;
+	size_t maxSize = BENCH_MAX_SIZE;
+	const char* dir = "/tmp";
+	const char* outputFilename = NULL;
+
+	int option;
+	while((option = getopt(argc, argv, "r:w:b:m:d:o:")) != -1)
+	{
+		switch(option)
+		{
+			case 'r':
+				repetitions = (int) strtol(optarg, NULL, 10);
+				break;
+
+			case 'w':
+				warmup = (int) strtol(optarg, NULL, 10);
+				break;
+
+			case 'b':
+				budget = strtod(optarg, NULL);
+				break;
+
+			case 'm':
+				maxSize = (size_t) strtoul(optarg, NULL, 10);
+				break;
+
+			case 'd':
+				dir = optarg;
+				break;
+
+			case 'o':
+				outputFilename = optarg;
+				break;
+
+			default:
+				repetitions = 0;
+				break;
+		}
+	}
+
+	if(repetitions <= 0 || repetitions > BENCH_REPETITIONS * 4 || warmup < 0 || budget <= 0 || maxSize < BENCH_MIN_SIZE)
+	{
+		fprintf(stderr, "usage is: %s [-r repetitions (max %d)] [-w warmup repetitions] [-b budget seconds per size] [-m max size] [-d temp dir] [-o results.json]\n",
+			argv[0], BENCH_REPETITIONS * 4);
+		return -1;
+	}
+
+	char description[128];
+	snprintf(description, sizeof(description), "%d repetitions (%d warmup), budget %.1f s per size, max size %lu", repetitions, warmup,
+		budget, (unsigned long) maxSize);
+
+	Results_t* results = NULL;
+	if(outputFilename != NULL && (results = CreateResults("bench", "micro", description)) == NULL)
+		return -1;
+
+	if(OpenPerfCounters(&counters) < COUNTERS_NUM)
+	{
+		printf("Note: counters not available (printed as -):");
+		for(int i = 0; i < COUNTERS_NUM; i++)
+			if(counters.fds[i] == -1)
+				printf(" %s", GetCounterName(i));
+
+		printf(", check /proc/sys/kernel/perf_event_paranoid and if the CPU exposes a PMU\n");
+	}
+
+	printf("%-14s %10s %12s %12s %10s %5s", "operation", "size", "median ns/op", "min ns/op", "allocs/op", "reps");
+	for(int i = 0; i < COUNTERS_NUM; i++)
+		printf(" %9s", counterColumns[i]);
+	printf("\n");
+
+	double previous[OP_NUM] = { 0 };					// Median ns/op of each operation with the previous two sizes
+	double last[OP_NUM] = { 0 };
+	for(size_t size = BENCH_MIN_SIZE; size <= maxSize; size *= 10)
+	{
+		if(size >= BENCH_MIN_SIZE * 100)				// Estimate time of this size from how ns/op has grown in the last decade
+		{
+			double estimate = 0;
+			for(int op = 0; op < OP_NUM; op++)
+			{
+				double growth = previous[op] > 0 && last[op] > previous[op] ? last[op] / previous[op] : 1.0;
+				estimate += last[op] * growth * GetOperationsNum(op, size) * (warmup + repetitions) / 1000000000.0;
+			}
+
+			if(estimate > budget)
+			{
+				printf("%-14s %10lu skipped, estimated %.0f s (budget is %.1f s, see -b)\n", "all", (unsigned long) size, estimate, budget);
+				break;
+			}
+		}
+
+		memcpy(previous, last, sizeof(last));
+		int result = RunSize(size, repetitions, warmup, budget, dir, last, results);
+		if(result == 0)
+		{
+			ClosePerfCounters(&counters);
+			DestroyResults(&results);
+			return -1;
+		}
+
+		if(result == 2)						// Next sizes would take even longer
+			break;
+	}
+
+	ClosePerfCounters(&counters);
+
+	int result = results == NULL || WriteResults(results, outputFilename) == 1;
+	DestroyResults(&results);
+	return result == 1 ? 0 : -1;
+}
+
+
+// Counts allocations and forwards them to the real malloc
+void* __wrap_malloc(size_t size)
+{
+	allocations++;
+	return __real_malloc(size);
+}
+
+
+// Counts allocations and forwards them to the real calloc
+void* __wrap_calloc(size_t num, size_t size)
+{
+	allocations++;
+	return __real_calloc(num, size);
+}
+
+
+// Counts allocations and forwards them to the real realloc
+void* __wrap_realloc(void* ptr, size_t size)
+{
+	allocations++;
+	return __real_realloc(ptr, size);
+}
+
+
+// Writes in name (MAX_NAME_SIZE bytes) the index-th name used by benchmarks, names are made of 6 to 13 letters (the first is uppercase)
+// and are different for different indexes
+void GetName(size_t index, char* name)
+{
+	uint64_t hash = (index + 1) * 0x9e3779b97f4a7c15ULL;		// Spread letters, so that names are not sorted
+	hash ^= hash >> 29;
+
+	memset(name, '\0', MAX_NAME_SIZE);
+	name[0] = 'A' + hash % 26;
+
+	size_t rest = index;						// Index in base 26 (5 digits are enough for BENCH_MAX_SIZE) makes names unique
+	for(int i = 1; i <= 5; i++, rest /= 26)
+		name[i] = 'a' + rest % 26;
+
+	int length = 6 + (hash >> 8) % 8;				// Then add some letters so that names have different lengths
+	for(int i = 6; i < length; i++)
+	{
+		hash = hash * 6364136223846793005ULL + 1442695040888963407ULL;
+		name[i] = 'a' + (hash >> 33) % 26;
+	}
+}
+
+
+// Writes in name a name that is never returned by GetName() (it ends with a digit)
+void GetMissingName(size_t index, char* name)
+{
+	GetName(index, name);
+	name[strlen(name)] = '0' + index % 10;
+}
+
+
+// Returns index-th element of a permutation of [0, size), used to access entries in an order different from insertion
+size_t Shuffle(size_t index, size_t size)
+{
+	return (index * 2654435761ULL + 12345) % size;		// 2654435761 is prime so it is coprime with sizes that are powers of 10
+}
+
+
+// Deallocates all nodes of tree (DeleteTree() is not used because it prints debug messages)
+void FreeTree(BstNode_t* root)
+{
+	while(root != NULL)
+	{
+		if(root->leftChild != NULL)				// Rotate left children up, so that no stack is needed
+		{
+			BstNode_t* left = root->leftChild;
+			root->leftChild = left->rightChild;
+			left->rightChild = root;
+			root = left;
+		}
+		else
+		{
+			BstNode_t* right = root->rightChild;
+			free(root);
+			root = right;
+		}
+	}
+}
+
+
+// Writes a phonebook data file with size entries (names returned by GetName()), returns 0 on failure
+int WriteDataFile(const char* filename, size_t size)
+{
+	FILE* file = fopen(filename, "w");
+	if(file == NULL)
+	{
+		fprintf(stderr, "Error: cannot create %s: %s\n", filename, strerror(errno));
+		return 0;
+	}
+
+	char name[MAX_NAME_SIZE];
+	for(size_t i = 0; i < size; i++)
+	{
+		GetName(i, name);
+		fprintf(file, "%s%c%lu\n", name, SEPARATOR_CHAR, (unsigned long)(i % 1000000000));
+	}
+
+	fclose(file);
+	return 1;
+}
+
+
+// Returns number of times that op is run in a repetition on size entries
+size_t GetOperationsNum(Operation_t op, size_t size)
+{
+	if(op == OP_APPEND_SYNC && size > BENCH_SYNC_OPS)
+		return BENCH_SYNC_OPS;
+
+	return size;
+}
+
+
+// Runs warmup + repetitions repetitions of each operation on size entries (fewer if they take more than budget seconds), prints results
+// and stores median ns/op of each operation in medians (and measures in results, if it is not NULL), returns 0 on failure, 2 if budget
+// has been exceeded and 1 otherwise
+int RunSize(size_t size, int repetitions, int warmup, double budget, const char* dir, double* medians, Results_t* results)
+{
+	Measure_t measures[OP_NUM];
+	memset(measures, 0, sizeof(measures));
+
+	char dataFilename[256];
+	char appendFilename[256];
+	snprintf(dataFilename, sizeof(dataFilename), "%s/bench-%d.data", dir, (int) getpid());
+	snprintf(appendFilename, sizeof(appendFilename), "%s/bench-%d.append", dir, (int) getpid());
+
+	int result = WriteDataFile(dataFilename, size);		// 0 on failure, 2 if budget has been exceeded, 1 otherwise
+	uint64_t sizeStart = GetTimeNs();
+
+	char name[MAX_NAME_SIZE];
+	char number[MAX_PHONE_NUM_SIZE] = "3331234567";
+	char entry[MAX_NAME_SIZE + MAX_PHONE_NUM_SIZE + 3];
+
+	for(int rep = 0; result == 1 && rep < warmup + repetitions; rep++)	// Failures break out, files are removed below on every path
+	{
+		Section_t sections[OP_NUM];				// Time, allocations and counters of each operation in this repetition
+		size_t ops[OP_NUM];
+		BstNode_t* root = NULL;
+		BstStats_t treeStats;					// Kept up to date as the phonebook does, so its cost is measured
+		memset(&treeStats, 0, sizeof(BstStats_t));
+
+		for(int op = 0; op < OP_NUM; op++)
+			ops[op] = GetOperationsNum(op, size);
+
+		StartSection(&sections[OP_INSERT]);	// Insert in an empty tree
+		for(size_t i = 0; i < size; i++)
+		{
+			GetName(i, name);
+			AddNode(&root, name, number, i, &treeStats);
+		}
+		StopSection(&sections[OP_INSERT]);
+
+		StartSection(&sections[OP_LOOKUP_HIT]);	// Look for names that are in the tree in an order different from insertion
+		for(size_t i = 0; i < size; i++)
+		{
+			GetName(Shuffle(i, size), name);
+			if(SearchNode(root, name) == NULL)
+			{
+				fprintf(stderr, "Error: %s has not been found in the tree\n", name);
+				result = 0;
+				break;
+			}
+		}
+		StopSection(&sections[OP_LOOKUP_HIT]);
+
+		if(result == 0)
+		{
+			FreeTree(root);
+			DestroyBstStats(&treeStats);
+			break;
+		}
+
+		StartSection(&sections[OP_LOOKUP_MISS]);	// Look for names that are not in the tree
+		for(size_t i = 0; i < size; i++)
+		{
+			GetMissingName(Shuffle(i, size), name);
+			SearchNode(root, name);
+		}
+		StopSection(&sections[OP_LOOKUP_MISS]);
+
+		StartSection(&sections[OP_DELETE]);	// Delete all names (searching them, as RemoveContact() does)
+		for(size_t i = 0; i < size && root != NULL; i++)
+		{
+			GetName(Shuffle(i, size), name);
+			BstNode_t* node = SearchNode(root, name);
+			DeleteNode(node == root ? &root : &node, &treeStats);
+		}
+		StopSection(&sections[OP_DELETE]);
+		FreeTree(root);
+		DestroyBstStats(&treeStats);
+
+		Phonebook_t pb;						// Load data file as CreatePhonebook() does
+		memset(&pb, 0, sizeof(Phonebook_t));
+		pb.credentialsFd = -1;
+		pb.dataFd = open(dataFilename, O_RDONLY);
+		if(pb.dataFd == -1 || InitializeBloomFilter(&pb.contactsFilter, size) == 0)
+		{
+			fprintf(stderr, "Error: cannot open %s\n", dataFilename);
+			if(pb.dataFd != -1)
+				close(pb.dataFd);
+			result = 0;
+			break;
+		}
+
+		StartSection(&sections[OP_LOAD]);
+		LoadPhonebookFromFile(&pb);
+		StopSection(&sections[OP_LOAD]);
+
+		close(pb.dataFd);
+		FreeTree(pb.dataTree);
+		DestroyBstStats(&pb.dataStats);
+		DestroyBloomFilter(&pb.contactsFilter);
+
+		for(int sync = 0; sync <= 1; sync++)			// Append entries to a file, without and with fsync
+		{
+			Operation_t op = sync == 0 ? OP_APPEND : OP_APPEND_SYNC;
+			int fd = open(appendFilename, O_RDWR | O_CREAT | O_TRUNC, 0666);
+			if(fd == -1)
+			{
+				fprintf(stderr, "Error: cannot create %s: %s\n", appendFilename, strerror(errno));
+				result = 0;
+				break;
+			}
+
+			StartSection(&sections[op]);
+			for(size_t i = 0; i < ops[op]; i++)
+			{
+				GetName(i, name);
+				snprintf(entry, sizeof(entry), "%s%c%s\n", name, SEPARATOR_CHAR, number);
+				WriteEntryOnFile(fd, entry, sync);
+			}
+			StopSection(&sections[op]);
+			close(fd);
+		}
+
+		if(result == 0)
+			break;
+
+		int overBudget = (GetTimeNs() - sizeStart) / 1000000000.0 > budget;
+		if(rep < warmup && overBudget == 0)			// Warmup repetitions are not measured (unless there is no time for more)
+			continue;
+
+		for(int op = 0; op < OP_NUM; op++)
+		{
+			measures[op].nsPerOp[measures[op].repetitions++] = sections[op].time / (double) ops[op];
+			measures[op].allocsPerOp = sections[op].allocs / (double) ops[op];
+
+			for(int i = 0; i < COUNTERS_NUM; i++)
+			{
+				if(sections[op].events[i] == PERF_UNAVAILABLE || measures[op].eventsPerOp[i] < 0)
+					measures[op].eventsPerOp[i] = -1;	// Not available (in at least one repetition)
+				else
+					measures[op].eventsPerOp[i] += sections[op].events[i] / (double) ops[op];
+			}
+		}
+
+		if(overBudget == 1)					// Estimate was wrong (e.g. tree doesn't fit in cache anymore), stop here
+		{
+			result = 2;
+			break;
+		}
+	}
+
+	unlink(dataFilename);
+	unlink(appendFilename);
+
+	if(result == 0)
+		return 0;
+
+	for(int op = 0; op < OP_NUM; op++)
+		medians[op] = PrintMeasure(op, size, &measures[op], results);
+
+	if(result == 2)
+		printf("%-14s %10lu stopped after %d repetitions, budget of %.1f s exceeded (see -b)\n", "all", (unsigned long) size,
+			measures[0].repetitions, budget);
+
+	fflush(stdout);
+	return result;
+}
+
+
+// Prints median and min time per operation and mean counters per operation of measure and adds them to results (if it is not NULL),
+// returns the median
+double PrintMeasure(Operation_t op, size_t size, Measure_t* measure, Results_t* results)
+{
+	qsort(measure->nsPerOp, measure->repetitions, sizeof(double), CompareDoubles);
+
+	double median = measure->nsPerOp[measure->repetitions / 2];
+	if(measure->repetitions % 2 == 0)
+		median = (median + measure->nsPerOp[measure->repetitions / 2 - 1]) / 2;
+
+	printf("%-14s %10lu %12.1f %12.1f %10.2f %5d", opNames[op], (unsigned long) size, median, measure->nsPerOp[0],
+		measure->allocsPerOp, measure->repetitions);
+
+	for(int i = 0; i < COUNTERS_NUM; i++)
+	{
+		if(measure->eventsPerOp[i] < 0 || measure->repetitions == 0)
+			printf(" %9s", "-");
+		else
+			printf(" %9.2f", measure->eventsPerOp[i] / measure->repetitions);
+	}
+
+	printf("\n");
+
+	char name[MAX_METRIC_NAME];
+	snprintf(name, sizeof(name), "%s/%lu", opNames[op], (unsigned long) size);
+	if(results != NULL)
+		AddMetric(results, name, "ns/op", 0, median, measure->nsPerOp, measure->repetitions);
+
+	for(int i = 0; i < COUNTERS_NUM && results != NULL; i++)
+	{
+		if(measure->eventsPerOp[i] < 0 || measure->repetitions == 0)
+			continue;
+
+		snprintf(name, sizeof(name), "%s/%lu/%s", opNames[op], (unsigned long) size, GetCounterName(i));
+		AddMetric(results, name, counterColumns[i], 0, measure->eventsPerOp[i] / measure->repetitions, NULL, 0);
+	}
+
+	return median;
+}
+
+
+// Compares two doubles, used by qsort()
+int CompareDoubles(const void* a, const void* b)
+{
+	double first = *(const double*) a;
+	double second = *(const double*) b;
+	return (first > second) - (first < second);
+}
+
+
+// Starts measuring time, allocations and counters of a section (counters are started first so that reading time is not counted)
+void StartSection(Section_t* section)
+{
+	allocations = 0;
+	StartPerfCounters(&counters);
+	section->start = GetTimeNs();
+}
+
+
+// Stops measuring a section and stores its results
+void StopSection(Section_t* section)
+{
+	section->time = GetTimeNs() - section->start;
+	section->allocs = allocations;
+	StopPerfCounters(&counters);
+	memcpy(section->events, counters.values, sizeof(section->events));
+}
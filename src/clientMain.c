@@ -12,7 +12,9 @@
 
 #include "Packet.h"
 #include "Utility.h"
+#include "ServerLink.h"
 #include "Constants.h"
+#include "RequestTable.h"
 
 #ifdef USE_GUI
 	#include "sGui.h"
@@ -32,23 +34,34 @@
 
 #endif
 
-int InitializeSocket(const char* address, const char* portNum, struct sockaddr_in* addrStruct);
+int InitializeSocket(const char* address, const char* portNum, Transport_t transport);
 
 int AddContact(char* name, char* number, char* response);
 int GetContact(char* name, char* response);
 int RemoveContact(char* name, char* response);
 int Login(char* username, char* password, char* response);
+int GetStats(char* selector, char* response);
+uint32_t SubmitRequest(Packet_t* request, char* response);
+int AwaitResponse(uint32_t id, Packet_t* serverResponse, char* response);
 
-int clientSock = -1;
-struct sockaddr_in serverAddr;					// Struct that contains server's address
-socklen_t serverAddrSize = sizeof(serverAddr);
+ServerLink_t server = { UDP_TRANSPORT, -1, NULL };			// Connection used to communicate with the server
 char username[MAX_NAME_SIZE];					// Username used to make request to server
+RequestTable_t pendingRequests;					// Requests sent to server that are waiting for a response
+uint64_t sessionToken = 0;					// Token received on login, it is sent with every request
 
-int main(void)
+int main(int argc, char* argv[])
 {
+	Transport_t transport = UDP_TRANSPORT;
+	if(argc > 2 || (argc == 2 && ParseTransport(argv[1], &transport) == 0))
+	{
+		fprintf(stderr, "usage is: %s [udp|tcp|unix|shm]\n", argv[0]);
+		return -1;
+	}
+
 	strncpy(username, "user", MAX_NAME_SIZE);		// Set default username
+	InitializeRequestTable(&pendingRequests);
 
-	if(InitializeSocket(SERVER_ADDRESS, SERVER_PORT_NUM, &serverAddr) == 0)
+	if(InitializeSocket(SERVER_ADDRESS, SERVER_PORT_NUM, transport) == 0)
 		exit(-1);
 
 	#ifdef USE_GUI
@@ -90,7 +103,7 @@ int main(void)
 
 	do {
 		printf("=======[ Phonebook client ]=======\n1] Add contact\n2] Get contact\n");
-		printf("3] Remove contact\n4] Login\n5] Quit\n %s ==> ", username);
+		printf("3] Remove contact\n4] Login\n5] Stats\n6] Quit\n %s ==> ", username);
 		fgets(commandBuff, MAX_NAME_SIZE, stdin);
 
 		switch(commandBuff[0])
@@ -166,7 +179,16 @@ int main(void)
 				printf("[Server] ==> %s\n", response);
 				break;
 
-			case '5':				// Quit
+			case '5':				// Send request to get server's statistics (only admin)
+				printf("Insert selector (e.g. GET_CONTACT.total, throughput, cache, bloom, admission, queue, process, index, datafile): ");
+				fgets(nameBuff, MAX_NAME_SIZE, stdin);
+
+				nameBuff[strlen(nameBuff) - 1] = '\0';
+				GetStats(nameBuff, response);
+				printf("[Server] ==> %s\n", response);
+				break;
+
+			case '6':				// Quit
 				printf("Quitting...\n");
 				break;
 
@@ -175,64 +197,25 @@ int main(void)
 				break;
 		}
 
-	} while(commandBuff[0] != '5');
+	} while(commandBuff[0] != '6');
 	#endif
 
-	close(clientSock);
+	CloseServerLink(&server);
 	return 0;
 }
 
 
-// Allocates an addrinfo struct, fills it with info about the address and creates a UDP socket to communicate with such address
-int InitializeSocket(const char* address, const char* portNum, struct sockaddr_in* addrStruct)
+// Creates a socket that uses the given transport to communicate with the server at the given address
+int InitializeSocket(const char* address, const char* portNum, Transport_t transport)
 {
 	// Check if something has already been initialized or if there are missing parameters
-	if(clientSock != -1 || address == NULL || portNum == NULL || addrStruct == NULL)
+	if(server.sock != -1 || address == NULL || portNum == NULL)
 		return 0;
 
 	printf("Intializing socket... ");
 
-	struct addrinfo addrHints;				// Set properties that server's address should have
-	struct addrinfo* serverAddress = NULL;
-	memset(&addrHints, 0, sizeof(struct addrinfo));
-	addrHints.ai_family = AF_INET;
-	addrHints.ai_protocol = 0;
-	addrHints.ai_socktype = SOCK_DGRAM;
-	addrHints.ai_flags = 0;
-
-	if(getaddrinfo(address, portNum, &addrHints, &serverAddress) != 0)	// Try to get server's address
-	{
-		fprintf(stderr, "Error: getaddrinfo() failed\n");
-		return 0;
-	}
-
-	clientSock = socket(serverAddress->ai_family, serverAddress->ai_socktype, serverAddress->ai_protocol);
-	if(clientSock == -1)
-	{
-		fprintf(stderr, "Error: cannot create socket for client\n");
-		freeaddrinfo(serverAddress);
+	if(OpenServerLink(&server, transport, address, portNum) == 0)
 		return 0;
-	}
-
-	if(connect(clientSock, serverAddress->ai_addr, serverAddress->ai_addrlen) != 0)
-	{
-		fprintf(stderr, "Error: cannot connect socket to server\n");
-		freeaddrinfo(serverAddress);
-		close(clientSock);
-		return 0;
-	}
-
-	struct timeval timeout;					// Set timeout of 10 second for receive operations
-	timeout.tv_sec = 10;
-
-	if(setsockopt(clientSock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(struct timeval)) != 0)
-	{
-		fprintf(stderr, "Warning: cannot set timeout for receive operations on socket... ");
-	}
-
-	// Copy server address in struct given as parameter
-	memcpy(addrStruct, serverAddress->ai_addr, sizeof(struct sockaddr_in));
-	freeaddrinfo(serverAddress);
 
 	printf("Socket ready!\n");
 	return 1;
@@ -254,17 +237,12 @@ int AddContact(char* name, char* number, char* response)
 	strncpy(request.name, name, MAX_NAME_SIZE);		// Copy contact name in packet
 	strncpy(request.number, number, MAX_PHONE_NUM_SIZE);	// Copy contact number in packet
 	
-	if(SendPacket(clientSock, &request, &serverAddr, serverAddrSize) == 0)
-	{
-		snprintf(response, MAX_RESPONSE_SIZE, "Failed to send request...");
+	uint32_t id = SubmitRequest(&request, response);
+	if(id == 0)
 		return 0;
-	}
 
-	if(ReceivePacket(clientSock, &serverResponse) == 0)	// Try to receive a response
-	{
-		snprintf(response, MAX_RESPONSE_SIZE, "%s", serverResponse.name);
+	if(AwaitResponse(id, &serverResponse, response) == 0)	// Try to receive a response
 		return 0;
-	}
 
 	snprintf(response, MAX_RESPONSE_SIZE, "%s", serverResponse.name);
 	return 1;
@@ -285,19 +263,14 @@ int GetContact(char* name, char* response)
 	strncpy(request.clientName, username, MAX_NAME_SIZE);	// Copy client name in packet
 	strncpy(request.name, name, MAX_NAME_SIZE);		// Copy contact name in packet
 
-	if(SendPacket(clientSock, &request, &serverAddr, serverAddrSize) == 0)
-	{
-		snprintf(response, MAX_RESPONSE_SIZE, "Failed to send request...");
+	uint32_t id = SubmitRequest(&request, response);
+	if(id == 0)
 		return 0;
-	}
 
-	if(ReceivePacket(clientSock, &serverResponse) == 0)	// Try to receive a response
-	{
-		snprintf(response, MAX_RESPONSE_SIZE, "%s", serverResponse.name);
+	if(AwaitResponse(id, &serverResponse, response) == 0)	// Try to receive a response
 		return 0;
-	}
 
-	if(serverResponse.type == REJECTED)
+	if(serverResponse.type != ACCEPTED)			// Rejected, or refused because server is busy
 	{
 		snprintf(response, MAX_RESPONSE_SIZE, "%s", serverResponse.name);
 		return 0;
@@ -322,17 +295,12 @@ int RemoveContact(char* name, char* response)
 	strncpy(request.clientName, username, MAX_NAME_SIZE);			// Copy client name in packet
 	strncpy(request.name, name, MAX_NAME_SIZE);				// Copy contact name in packet
 	
-	if(SendPacket(clientSock, &request, &serverAddr, serverAddrSize) == 0)
-	{
-		snprintf(response, MAX_RESPONSE_SIZE, "Failed to send request...");
+	uint32_t id = SubmitRequest(&request, response);
+	if(id == 0)
 		return 0;
-	}
 
-	if(ReceivePacket(clientSock, &serverResponse) == 0)			// Try to receive a response
-	{
-		snprintf(response, MAX_RESPONSE_SIZE, "%s", serverResponse.name);
+	if(AwaitResponse(id, &serverResponse, response) == 0)			// Try to receive a response
 		return 0;
-	}
 
 	snprintf(response, MAX_RESPONSE_SIZE, "%s", serverResponse.name);	// Copy server's response in response string
 	return 1;
@@ -354,26 +322,83 @@ int Login(char* user, char* password, char* response)
 	strncpy(request.name, user, MAX_NAME_SIZE);		// Copy user in packet
 	strncpy(request.number, password, MAX_PASSWORD_SIZE);	// Copy client's password in packet
 	
-	if(SendPacket(clientSock, &request, &serverAddr, serverAddrSize) == 0)
+	uint32_t id = SubmitRequest(&request, response);
+	if(id == 0)
+		return 0;
+
+	if(AwaitResponse(id, &serverResponse, response) == 0)	// Try to receive a response
+		return 0;
+
+	if(serverResponse.type != ACCEPTED)			// If login request has been rejected (or server is busy)
 	{
-		snprintf(response, MAX_RESPONSE_SIZE, "Failed to send request...");
+		snprintf(response, MAX_RESPONSE_SIZE, "%s", serverResponse.name);
 		return 0;
 	}
 
-	if(ReceivePacket(clientSock, &serverResponse) == 0)	// Try to receive a response
+	strncpy(username, user, MAX_NAME_SIZE); 		// Set new username
+	sessionToken = serverResponse.sessionToken;		// Keep the token for next requests
+	snprintf(response, MAX_RESPONSE_SIZE, "Logged as %s", username);
+	return 1;
+}
+
+
+// Creates a packet that request the statistics choosen by selector, and then send it to server
+int GetStats(char* selector, char* response)
+{
+	if(selector == NULL || response == NULL)
+		return 0;
+
+	Packet_t request;
+	Packet_t serverResponse;
+	memset(&request, 0, sizeof(Packet_t));
+
+	request.type = STATS;					// Set packet type
+	strncpy(request.clientName, username, MAX_NAME_SIZE);	// Copy client name in packet
+	strncpy(request.name, selector, MAX_NAME_SIZE);		// Copy selector in packet
+
+	uint32_t id = SubmitRequest(&request, response);
+	if(id == 0)
+		return 0;
+
+	if(AwaitResponse(id, &serverResponse, response) == 0)	// Try to receive a response
+		return 0;
+
+	snprintf(response, MAX_RESPONSE_SIZE, "%s", serverResponse.name);
+	return serverResponse.type == ACCEPTED;
+}
+
+
+// Assigns an id to request and sends it to server, returns the id or 0 on failure (in that case response contains the error)
+uint32_t SubmitRequest(Packet_t* request, char* response)
+{
+	request->sessionToken = sessionToken;			// Server accepts requests only from logged clients
+	uint32_t id = BeginRequest(&pendingRequests, request);
+	if(id == 0)
 	{
-		snprintf(response, MAX_RESPONSE_SIZE, "%s", serverResponse.name);
+		snprintf(response, MAX_RESPONSE_SIZE, "Too many requests in flight...");
 		return 0;
 	}
 
-	if(serverResponse.type == REJECTED)			// If login request has been rejected
+	if(SendToServer(&server, request) == 0)
 	{
-		snprintf(response, MAX_RESPONSE_SIZE, "%s", serverResponse.name);
+		CancelRequest(&pendingRequests, id);
+		snprintf(response, MAX_RESPONSE_SIZE, "Failed to send request...");
+		return 0;
+	}
+
+	return id;
+}
+
+
+// Waits the response for request id, responses that arrive for other requests in flight are kept in pendingRequests
+int AwaitResponse(uint32_t id, Packet_t* serverResponse, char* response)
+{
+	if(WaitForResponse(&pendingRequests, &server, id, serverResponse) == 0)
+	{
+		snprintf(response, MAX_RESPONSE_SIZE, "%s", serverResponse->name);
 		return 0;
 	}
 
-	strncpy(username, user, MAX_NAME_SIZE); 		// Set new username
-	snprintf(response, MAX_RESPONSE_SIZE, "Logged as %s", username);
 	return 1;
 }
 
@@ -0,0 +1,548 @@
+
+// Generator of phonebook data files (and of a matching credentials file) used to test the server with large phonebooks. Every name is
+// made of a first name, a last name and a suffix: the suffix is a code of uppercase letters that makes the name unique, followed (if a
+// length distribution is given) by lowercase letters until the name reaches the length drawn for it. The index i of an entry is split in
+// first name (f = i % F), last name ((i / F % L + f * 37) % L) and code (i / (F * L)), so that all names are different and even small
+// files use many first and last names.
+// Each entry only depends on its index and on the seed, so blocks of entries are generated in parallel by worker threads (while main
+// thread writes the blocks already generated) and the same options always produce the same file. Entries are written shuffled (a
+// permutation of the indexes computed on the fly, no memory is needed) or sorted by name (the worst case for an unbalanced tree), a
+// fraction of them can be written as removed (tombstones) like the server does
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+
+#include "Constants.h"
+#include "Utility.h"
+
+#define GENERATOR_BLOCK		65536			// Number of entries generated by a thread before they are written
+#define GENERATOR_LAST_SHIFT	37			// Last name of an index is shifted by its first name times this
+#define GENERATOR_ENTRY_SIZE	(MAX_NAME_SIZE + MAX_PHONE_NUM_SIZE + 1)	// Max size of an entry on file
+
+typedef struct _Generator {
+	uint64_t entries;				// Number of entries of the data file
+	uint64_t seed;					// Seed of all random choices
+	int minLength;					// Min length of names
+	int maxLength;					// Max length of names
+	int modeLength;					// Most likely length of names (lengths are uniform if it is -1, natural if it is 0)
+	double tombstoneRatio;				// Fraction of entries written as removed
+	int sorted;					// 1 if entries are written sorted by name, 0 if they are shuffled
+	int codeLength;					// Number of letters of the code that makes names unique
+	uint64_t codes;					// Number of codes needed (entries / (F * L) rounded up)
+	uint64_t mask;					// Smallest power of 2 not less than entries, minus 1 (used to shuffle entries)
+} Generator_t;
+
+typedef struct _Block {
+	uint64_t number;				// Number of the block held by this slot (blocks are numbered in file order)
+	int ready;					// 1 if block has been generated and is waiting to be written
+	char* buffer;					// Entries of the block, as they are written on file
+	size_t size;					// Number of bytes in buffer
+	uint64_t written;				// Number of entries written in buffer (in sorted order some positions are skipped)
+	uint64_t tombstones;				// Number of entries written as removed
+} Block_t;
+
+typedef struct _Pipeline {				// Workers generate blocks in slots while main thread writes the oldest one on file
+	Generator_t* generator;
+	Block_t* slots;					// Block number k is generated in slot k % slotsNum
+	int slotsNum;					// Twice the number of workers, so they fill a round of slots while the previous one is written
+	uint64_t positions;				// Number of positions to generate
+	uint64_t blocksNum;				// Number of blocks of the file
+	uint64_t nextBlock;				// Next block that a worker will generate
+	uint64_t writtenBlocks;				// Number of blocks written on file, slot of block k is free when k < writtenBlocks + slotsNum
+	int stop;					// Set by main thread if writing failed
+	pthread_mutex_t mutx;				// Mutex that protects fields above (and ready of slots)
+	pthread_cond_t blockReady;			// Signaled when a block has been generated
+	pthread_cond_t slotFree;			// Signaled when a block has been written
+} Pipeline_t;
+
+
+int ParseLengths(const char* str, Generator_t* generator);
+uint64_t Mix(uint64_t x);
+uint64_t Shuffle(Generator_t* generator, uint64_t position);
+int GetNameLength(Generator_t* generator, uint64_t hash);
+size_t WriteEntry(Generator_t* generator, uint64_t index, char* buff, int* removed);
+void GenerateBlock(Generator_t* generator, Block_t* block, uint64_t start, uint64_t end);
+void* GenerateBlocks(void* arg);
+int WriteAll(int fd, const char* buff, size_t size);
+int WriteCredentials(const char* filename, int users, uint64_t seed);
+int CompareNames(const void* a, const void* b);
+
+
+// First and last names, sorted at startup so that sorted entries can be generated in order
+const char* firstNames[] = { "Alessandra", "Alessio", "Alex", "Alice", "Andrea", "Angela", "Anna", "Antonio", "Armando", "Barbara",
+	"Beatrice", "Bianca", "Boris", "Bruno", "Camilla", "Carla", "Carlo", "Cassandra", "Chiara", "Clara", "Claudio", "Cristian", "Daniele",
+	"Dante", "Davide", "Debora", "Dimitri", "Edoardo", "Elena", "Elisa", "Emanuele", "Emma", "Enrico", "Erika", "Ester", "Ezio",
+	"Fabio", "Fabrizio", "Federica", "Federico", "Filippo", "Francesca", "Francesco", "Gabriele", "Gemma", "Gennaro", "Giacomo",
+	"Gianni", "Giorgia", "Giorgio", "Giovanni", "Giulia", "Giuseppe", "Greta", "Ilaria", "Ilenia", "Iris", "Irene", "Ivan", "Jack",
+	"John", "Julian", "Julio", "Laura", "Lamberto", "Leonardo", "Lorenzo", "Luca", "Lucia", "Lucio", "Luigi", "Luna", "Marco", "Margherita",
+	"Maria", "Martina", "Massimiliano", "Matteo", "Michele", "Mimmo", "Miriam", "Natalia", "Nathan", "Nicola", "Noemi", "Paola", "Paolo",
+	"Piero", "Ramona", "Remo", "Riccardo", "Roberta", "Roberto", "Rosa", "Sara", "Serena", "Silvia", "Simone", "Sofia", "Stefano",
+	"Tommaso", "Ugo", "Valentina", "Valentino", "Vera", "Veronica", "Vinicio", "Viola" };
+
+const char* lastNames[] = { "Amato", "Barbieri", "Bellini", "Benedetti", "Bernardi", "Bianchi", "Bruno", "Caruso", "Cattaneo", "Colombo",
+	"Conte", "Costa", "Cristiani", "D'Amico", "De Luca", "Esposito", "Fabbri", "Farina", "Ferrara", "Ferrari", "Ferri", "Fontana",
+	"Galli", "Gallo", "Gatti", "Gentile", "Giordano", "Giuliani", "Grassi", "Greco", "Guerra", "Leone", "Lombardi", "Longo", "Mancini",
+	"Marchetti", "Mariani", "Marini", "Marino", "Martini", "Messina", "Monti", "Morelli", "Moretti", "Neri", "Orlando", "Palumbo",
+	"Parisi", "Pellegrini", "Rinaldi", "Rizzi", "Rizzo", "Romano", "Rossetti", "Rossi", "Russo", "Sala", "Sanna", "Santoro", "Serra",
+	"Silvestri", "Testa", "Valentini", "Villa", "Vitale" };
+
+const size_t firstNamesNum = sizeof(firstNames) / sizeof(char*);
+const size_t lastNamesNum = sizeof(lastNames) / sizeof(char*);
+
+
+int main(int argc, char* argv[])
+{
+	Generator_t generator;
+	memset(&generator, 0, sizeof(Generator_t));
+	generator.seed = 1;
+	generator.modeLength = 0;
+
+	const char* credentialsFilename = NULL;
+	int users = 0;
+	long threadsNum = sysconf(_SC_NPROCESSORS_ONLN);
+	int valid = 1;
+
+	int option;
+	while((option = getopt(argc, argv, "l:t:sc:u:j:r:")) != -1)
+	{
+		switch(option)
+		{
+			case 'l':
+				valid = ParseLengths(optarg, &generator);
+				break;
+
+			case 't':
+				generator.tombstoneRatio = strtod(optarg, NULL);
+				valid = generator.tombstoneRatio >= 0 && generator.tombstoneRatio <= 1;
+				break;
+
+			case 's':
+				generator.sorted = 1;
+				break;
+
+			case 'c':
+				credentialsFilename = optarg;
+				break;
+
+			case 'u':
+				users = (int) strtol(optarg, NULL, 10);
+				break;
+
+			case 'j':
+				threadsNum = strtol(optarg, NULL, 10);
+				break;
+
+			case 'r':
+				generator.seed = strtoull(optarg, NULL, 10);
+				break;
+
+			default:
+				valid = 0;
+				break;
+		}
+
+		if(valid == 0)
+			break;
+	}
+
+	if(valid == 1 && argc - optind == 2)
+		generator.entries = strtoull(argv[optind + 1], NULL, 10);
+
+	if(valid == 0 || argc - optind != 2 || generator.entries == 0 || users < 0 || threadsNum <= 0)
+	{
+		fprintf(stderr, "usage is: %s [options] <phonebook data filename> <number of entries>\n", argv[0]);
+		fprintf(stderr, "Options:\n");
+		fprintf(stderr, "  -l <min>:<max>[:<mode>]  length of names, uniform or triangular with given mode (default no padding)\n");
+		fprintf(stderr, "  -t <ratio>               fraction of entries written as removed (default 0)\n");
+		fprintf(stderr, "  -s                       write entries sorted by name (default shuffled)\n");
+		fprintf(stderr, "  -c <file>                also write a credentials file with user %s (password %s)\n", DEFAULT_ADMIN_NAME,
+			DEFAULT_ADMIN_PASSWORD);
+		fprintf(stderr, "  -u <users>               add users user0, user1, ... to the credentials file (default 0)\n");
+		fprintf(stderr, "  -j <threads>             number of threads (default number of CPUs)\n");
+		fprintf(stderr, "  -r <seed>                seed of random choices, same options and seed give the same file (default 1)\n");
+		return -1;
+	}
+
+	qsort(firstNames, firstNamesNum, sizeof(char*), CompareNames);
+	qsort(lastNames, lastNamesNum, sizeof(char*), CompareNames);
+
+	uint64_t combinations = firstNamesNum * lastNamesNum;
+	generator.codes = (generator.entries + combinations - 1) / combinations;
+	generator.codeLength = 1;
+	for(uint64_t codes = 26; codes < generator.codes; codes *= 26)
+		generator.codeLength++;
+
+	size_t shortestFirst = MAX_NAME_SIZE;
+	size_t shortestLast = MAX_NAME_SIZE;
+	for(size_t i = 0; i < firstNamesNum; i++)
+		shortestFirst = strlen(firstNames[i]) < shortestFirst ? strlen(firstNames[i]) : shortestFirst;
+	for(size_t i = 0; i < lastNamesNum; i++)
+		shortestLast = strlen(lastNames[i]) < shortestLast ? strlen(lastNames[i]) : shortestLast;
+
+	int shortest = (int)(shortestFirst + shortestLast + 2 + generator.codeLength);
+	if(generator.modeLength != 0 && generator.minLength < shortest)
+		printf("Note: names have at least %d characters with %lu entries\n", shortest, (unsigned long) generator.entries);
+
+	for(generator.mask = 1; generator.mask < generator.entries; generator.mask <<= 1);
+	generator.mask--;
+
+	int fd = open(argv[optind], O_WRONLY | O_CREAT | O_TRUNC, 0666);
+	if(fd == -1)
+	{
+		fprintf(stderr, "Error: cannot create %s: %s\n", argv[optind], strerror(errno));
+		return -1;
+	}
+
+	Pipeline_t pipeline;
+	memset(&pipeline, 0, sizeof(Pipeline_t));
+	pipeline.generator = &generator;
+	pipeline.positions = generator.sorted == 1 ? combinations * generator.codes : generator.entries;	// Sorted skips unused indexes
+	pipeline.blocksNum = (pipeline.positions + GENERATOR_BLOCK - 1) / GENERATOR_BLOCK;
+	pipeline.slotsNum = (int)(threadsNum * 2);
+	pipeline.slots = calloc(pipeline.slotsNum, sizeof(Block_t));
+	for(int i = 0; pipeline.slots != NULL && i < pipeline.slotsNum; i++)
+	{
+		pipeline.slots[i].buffer = malloc(GENERATOR_BLOCK * GENERATOR_ENTRY_SIZE);
+		if(pipeline.slots[i].buffer == NULL)
+			pipeline.slotsNum = i;						// Use the slots that have been allocated
+	}
+
+	if(pipeline.slots == NULL || pipeline.slotsNum == 0 || pthread_mutex_init(&pipeline.mutx, NULL) != 0 ||
+		pthread_cond_init(&pipeline.blockReady, NULL) != 0 || pthread_cond_init(&pipeline.slotFree, NULL) != 0)
+	{
+		fprintf(stderr, "Error: cannot allocate buffers of entries\n");
+		for(int i = 0; pipeline.slots != NULL && i < pipeline.slotsNum; i++)
+			free(pipeline.slots[i].buffer);
+		free(pipeline.slots);
+		close(fd);
+		return -1;
+	}
+
+	pthread_t* workers = malloc(threadsNum * sizeof(pthread_t));
+	long workersNum = 0;
+	while(workers != NULL && workersNum < threadsNum && pthread_create(&workers[workersNum], NULL, GenerateBlocks, &pipeline) == 0)
+		workersNum++;
+
+	uint64_t written = 0;
+	uint64_t tombstones = 0;
+	uint64_t bytes = 0;
+	uint64_t start = GetTimeNs();
+	int result = 1;
+
+	for(uint64_t number = 0; number < pipeline.blocksNum && result == 1; number++)	// Write blocks in order
+	{
+		Block_t* block = &pipeline.slots[number % pipeline.slotsNum];
+		if(workersNum == 0)							// No thread could be created, generate it here
+		{
+			uint64_t first = number * GENERATOR_BLOCK;
+			GenerateBlock(&generator, block, first, pipeline.positions - first > GENERATOR_BLOCK ? first + GENERATOR_BLOCK : pipeline.positions);
+		}
+		else
+		{
+			pthread_mutex_lock(&pipeline.mutx);
+			while(block->ready == 0 || block->number != number)
+				pthread_cond_wait(&pipeline.blockReady, &pipeline.mutx);
+			pthread_mutex_unlock(&pipeline.mutx);
+		}
+
+		if(WriteAll(fd, block->buffer, block->size) == 0)			// Workers go on generating next blocks meanwhile
+		{
+			fprintf(stderr, "Error: cannot write %s: %s\n", argv[optind], strerror(errno));
+			result = 0;
+		}
+
+		written += block->written;
+		tombstones += block->tombstones;
+		bytes += block->size;
+
+		pthread_mutex_lock(&pipeline.mutx);
+		block->ready = 0;
+		pipeline.writtenBlocks++;
+		pipeline.stop = result == 0;
+		pthread_cond_broadcast(&pipeline.slotFree);
+		pthread_mutex_unlock(&pipeline.mutx);
+	}
+
+	for(long i = 0; i < workersNum; i++)
+		pthread_join(workers[i], NULL);
+
+	if(close(fd) != 0 && result == 1)
+	{
+		fprintf(stderr, "Error: cannot write %s: %s\n", argv[optind], strerror(errno));
+		result = 0;
+	}
+
+	double seconds = (GetTimeNs() - start) / 1000000000.0;
+	for(int i = 0; i < pipeline.slotsNum; i++)
+		free(pipeline.slots[i].buffer);
+	free(pipeline.slots);
+	free(workers);
+	pthread_mutex_destroy(&pipeline.mutx);
+	pthread_cond_destroy(&pipeline.blockReady);
+	pthread_cond_destroy(&pipeline.slotFree);
+
+	if(result == 0)
+		return -1;
+
+	printf("Written %lu entries (%lu removed, %s) in %s: %.1f MB in %.2f s (%.0f MB/s)\n", (unsigned long) written,
+		(unsigned long) tombstones, generator.sorted == 1 ? "sorted" : "shuffled", argv[optind], bytes / 1000000.0, seconds,
+		seconds > 0 ? bytes / 1000000.0 / seconds : 0.0);
+
+	if(credentialsFilename != NULL)
+	{
+		if(WriteCredentials(credentialsFilename, users, generator.seed) == 0)
+			return -1;
+
+		printf("Written %d users in %s\n", users + 1, credentialsFilename);
+	}
+
+	return 0;
+}
+
+
+// Parses lengths of names given as <min>:<max>[:<mode>], returns 0 if they are not valid
+int ParseLengths(const char* str, Generator_t* generator)
+{
+	int parsed = sscanf(str, "%d:%d:%d", &generator->minLength, &generator->maxLength, &generator->modeLength);
+	if(parsed == 2)
+		generator->modeLength = -1;
+
+	if(parsed < 2 || generator->minLength < 1 || generator->maxLength < generator->minLength || generator->maxLength > MAX_NAME_SIZE - 1 ||
+		(parsed == 3 && (generator->modeLength < generator->minLength || generator->modeLength > generator->maxLength)))
+	{
+		fprintf(stderr, "Error: lengths must be <min>:<max>[:<mode>] with 1 <= min <= mode <= max <= %d\n", MAX_NAME_SIZE - 1);
+		return 0;
+	}
+
+	return 1;
+}
+
+
+// Returns a well mixed hash of x (splitmix64 finalizer)
+uint64_t Mix(uint64_t x)
+{
+	x ^= x >> 30;
+	x *= 0xbf58476d1ce4e5b9ULL;
+	x ^= x >> 27;
+	x *= 0x94d049bb133111ebULL;
+	x ^= x >> 31;
+	return x;
+}
+
+
+// Returns the index of the entry written at position (a permutation of [0, entries) that depends on the seed), operations are invertible
+// modulo mask + 1 so they are a permutation of [0, mask], values not less than entries are skipped by applying them again
+uint64_t Shuffle(Generator_t* generator, uint64_t position)
+{
+	uint64_t key = Mix(generator->seed);
+	uint64_t x = position;
+	int shift = 1;
+	for(uint64_t m = generator->mask; m > 3; m >>= 2)
+		shift++;
+
+	do
+	{
+		for(int round = 0; round < 3; round++)
+		{
+			x = (x ^ (key >> (round * 16))) & generator->mask;
+			x = (x * 0x9e3779b97f4a7c15ULL) & generator->mask;
+			x ^= x >> shift;
+		}
+	}
+	while(x >= generator->entries);
+
+	return x;
+}
+
+
+// Returns the length of a name drawn from the distribution of generator (hash is a random number)
+int GetNameLength(Generator_t* generator, uint64_t hash)
+{
+	double u = (hash >> 11) / (double)(1ULL << 53);
+	double min = generator->minLength;
+	double max = generator->maxLength + 1;					// Lengths are taken from [min, max + 1)
+
+	if(generator->modeLength == 0)
+		return 0;
+
+	if(generator->modeLength == -1)
+		return (int)(min + u * (max - min));
+
+	double mode = generator->modeLength + 0.5;				// Inverse of the triangular distribution
+	double split = (mode - min) / (max - min);
+	if(u < split)
+		return (int)(min + sqrt(u * (max - min) * (mode - min)));
+
+	return (int)(max - sqrt((1 - u) * (max - min) * (max - mode)));
+}
+
+
+// Writes in buff the entry with given index (name, SEPARATOR_CHAR, number and newline), sets removed to 1 if it is written as removed,
+// returns its length
+size_t WriteEntry(Generator_t* generator, uint64_t index, char* buff, int* removed)
+{
+	uint64_t hash = Mix(index ^ Mix(generator->seed));
+	const char* first = firstNames[index % firstNamesNum];
+	const char* last = lastNames[(index / firstNamesNum % lastNamesNum + index % firstNamesNum * GENERATOR_LAST_SHIFT) % lastNamesNum];
+	uint64_t code = index / (firstNamesNum * lastNamesNum);
+
+	size_t length = strlen(first);
+	memcpy(buff, first, length);
+	buff[length++] = ' ';
+
+	size_t lastLength = strlen(last);
+	memcpy(buff + length, last, lastLength);
+	length += lastLength;
+	buff[length++] = ' ';
+
+	for(int i = generator->codeLength - 1; i >= 0; i--, code /= 26)	// Code has fixed length, so names are sorted as their codes
+		buff[length + i] = 'A' + code % 26;
+	length += generator->codeLength;
+
+	size_t target = (size_t) GetNameLength(generator, hash);
+	for(uint64_t letters = Mix(hash); length < target; letters = letters / 26 != 0 ? letters / 26 : Mix(letters + index))
+		buff[length++] = 'a' + letters % 26;
+
+	*removed = generator->tombstoneRatio > 0 && (Mix(hash) >> 11) / (double)(1ULL << 53) < generator->tombstoneRatio;
+	if(*removed == 1)
+		buff[0] = REMOVED_CHAR;
+
+	buff[length++] = SEPARATOR_CHAR;
+	buff[length++] = '3';							// Numbers look like mobile numbers
+	uint64_t digits = Mix(hash ^ 0x5555555555555555ULL);
+	for(int i = 0; i < MAX_PHONE_NUM_SIZE - 2; i++, digits /= 10)
+		buff[length++] = '0' + digits % 10;
+
+	buff[length++] = '\n';
+	return length;
+}
+
+
+// Generates in block the entries at positions [start, end)
+void GenerateBlock(Generator_t* generator, Block_t* block, uint64_t start, uint64_t end)
+{
+	uint64_t combinations = firstNamesNum * lastNamesNum;
+
+	block->size = 0;
+	block->written = 0;
+	block->tombstones = 0;
+
+	for(uint64_t position = start; position < end; position++)
+	{
+		uint64_t index;
+		if(generator->sorted == 1)						// Position is (first, last, code) in lexicographic order
+		{
+			uint64_t first = position / (lastNamesNum * generator->codes);
+			uint64_t last = position / generator->codes % lastNamesNum;
+			uint64_t shifted = (last + lastNamesNum - first * GENERATOR_LAST_SHIFT % lastNamesNum) % lastNamesNum;	// Inverse of shift
+			index = (position % generator->codes) * combinations + shifted * firstNamesNum + first;
+			if(index >= generator->entries)
+				continue;
+		}
+		else
+			index = Shuffle(generator, position);
+
+		int removed;
+		block->size += WriteEntry(generator, index, block->buffer + block->size, &removed);
+		block->tombstones += removed;
+		block->written++;
+	}
+}
+
+
+// Worker thread: takes the next block to generate, waits until its slot has been written on file and generates it, until all blocks
+// have been taken or main thread stops
+void* GenerateBlocks(void* arg)
+{
+	Pipeline_t* pipeline = (Pipeline_t*) arg;
+
+	pthread_mutex_lock(&pipeline->mutx);
+	while(pipeline->stop == 0 && pipeline->nextBlock < pipeline->blocksNum)
+	{
+		uint64_t number = pipeline->nextBlock++;
+		while(pipeline->stop == 0 && number >= pipeline->writtenBlocks + pipeline->slotsNum)
+			pthread_cond_wait(&pipeline->slotFree, &pipeline->mutx);
+
+		if(pipeline->stop == 1)
+			break;
+
+		pthread_mutex_unlock(&pipeline->mutx);
+		Block_t* block = &pipeline->slots[number % pipeline->slotsNum];
+		uint64_t start = number * GENERATOR_BLOCK;
+		uint64_t end = pipeline->positions - start > GENERATOR_BLOCK ? start + GENERATOR_BLOCK : pipeline->positions;
+		GenerateBlock(pipeline->generator, block, start, end);
+
+		pthread_mutex_lock(&pipeline->mutx);
+		block->number = number;
+		block->ready = 1;
+		pthread_cond_broadcast(&pipeline->blockReady);
+	}
+	pthread_mutex_unlock(&pipeline->mutx);
+
+	return NULL;
+}
+
+
+// Writes size bytes of buff on fd, returns 0 on failure
+int WriteAll(int fd, const char* buff, size_t size)
+{
+	while(size > 0)
+	{
+		ssize_t written = write(fd, buff, size);
+		if(written == -1 && errno == EINTR)
+			continue;
+
+		if(written <= 0)
+			return 0;
+
+		buff += written;
+		size -= written;
+	}
+
+	return 1;
+}
+
+
+// Writes a credentials file with DEFAULT_ADMIN_NAME (all permissions) and users user0, user1, ... (permissions RW, R and W in turn, with
+// a random password of digits), returns 0 on failure
+int WriteCredentials(const char* filename, int users, uint64_t seed)
+{
+	FILE* file = fopen(filename, "w");
+	if(file == NULL)
+	{
+		fprintf(stderr, "Error: cannot create %s: %s\n", filename, strerror(errno));
+		return 0;
+	}
+
+	const char* permissions[] = { "RW", "R", "W" };
+	fprintf(file, "%s%c%s%c%s\n", DEFAULT_ADMIN_NAME, SEPARATOR_CHAR, DEFAULT_ADMIN_PASSWORD, SEPARATOR_CHAR, "RW");
+
+	for(int i = 0; i < users; i++)
+	{
+		unsigned int password = (unsigned int)(Mix(seed ^ Mix(i + 1)) % 10000000);	// MAX_PASSWORD_SIZE - 1 digits
+		fprintf(file, "user%d%c%07u%c%s\n", i, SEPARATOR_CHAR, password, SEPARATOR_CHAR, permissions[i % 3]);
+	}
+
+	if(fclose(file) != 0)
+	{
+		fprintf(stderr, "Error: cannot write %s: %s\n", filename, strerror(errno));
+		return 0;
+	}
+
+	return 1;
+}
+
+
+// Compares two names, used by qsort()
+int CompareNames(const void* a, const void* b)
+{
+	return strcmp(*(const char* const*) a, *(const char* const*) b);
+}
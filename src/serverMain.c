@@ -1,4 +1,5 @@
 
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -6,149 +7,644 @@
 
 #include <unistd.h>
 #include <pthread.h>
-#include <semaphore.h>
 #include <signal.h>
+#include <poll.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/un.h>
 #include <netdb.h>
 
 #include "Phonebook.h"
 #include "Packet.h"
 #include "Utility.h"
+#include "ShmRing.h"
+#include "Connection.h"
+#include "Session.h"
+#include "ResponseCache.h"
+#include "RequestQueue.h"
+#include "RateLimiter.h"
+#include "AccessLog.h"
+#include "Stats.h"
+#include "Trace.h"
+#include "Probes.h"
 
 
 typedef struct _Worker {
 	pthread_t tid;				// Id of the worker thread
-	sem_t isBusy;				// Semaphore that signals to worker that it has a request to satisfy
-	sem_t isFree;				// Semaphore that signals to main thread that worker can accept a new request
-	Packet_t request;			// Request packet sent by client
-	Packet_t response;			// Response packet sent to client
-	struct sockaddr_in clientAddr;		// Struct that contains the address of the client of which we need to satisfy request
-	socklen_t addrLen;			// Length of the client address
+	int id;					// Index of the worker, it is also its producer id in the access log
+	Request_t requests[MAX_WRITE_BATCH];	// Requests taken from the queue that worker is satisfying (a read or a batch of writes)
+	Packet_t responses[MAX_WRITE_BATCH];	// Response packets sent to clients
 } Worker_t;
 
-
+typedef struct _ShmClient {
+	pthread_t tid;				// Id of the thread that serves requests pushed in the segment
+	int id;					// Producer id of the thread in the access log
+	ShmSegment_t* segment;			// Segment shared with the client (NULL if this slot is not used)
+	TokenBucket_t bucket;			// Rate limit of the client, kept by the thread (the table of rateLimiter belongs to main thread)
+	atomic_int stop;			// Set to ask the thread to terminate
+} ShmClient_t;
+
+typedef struct _ServerConfig {
+	size_t cacheSize;			// Max number of GET_CONTACT responses kept in cache (0 disables the cache)
+	size_t queueSize;			// Max number of requests waiting for a worker
+	double rateLimit;			// Requests per second allowed to each client (0 disables rate limiting)
+	double rateBurst;			// Requests that a client can send in a burst (0 means one second worth of requests)
+	unsigned int writeDelay;		// Max time (ms) that a write waits while reads are served before it
+	const char* logFilename;		// File on which access log is written ("-" is stdout)
+	LogLevel_t logLevel;			// Requests that are written on access log
+	unsigned int logSampling;		// Only one of every logSampling requests is written on access log
+	unsigned int slowThreshold;		// Requests that take at least slowThreshold ms are always written on access log (0 disables them)
+	unsigned int requestTimeout;		// Deadline (ms) of requests that don't carry one (0 means no deadline)
+	const char* traceFilename;		// File on which incoming requests are recorded (NULL disables the trace)
+	int anonymizeTrace;			// Tells if names must be anonymized in the trace
+} ServerConfig_t;
+
+typedef struct _AdmissionStats {
+	uint64_t queueFull;			// Requests refused because the queue was full
+	_Atomic uint64_t rateLimited;		// Requests refused because client exceeded its rate (updated by shared memory threads too)
+	_Atomic uint64_t expired;		// Requests dropped because client was no longer waiting (updated by workers and shared memory threads)
+} AdmissionStats_t;
+
+
+int ParseOptions(int argc, char* argv[]);
 int InitializeSocket(const char* portNum);
+int CreateBoundSocket(const char* portNum, int sockType);
+int CreateUnixSocket(const char* path);
+void CloseSockets();
+void ReceiveDatagrams();
+uint64_t GetSocketDelay(struct msghdr* msg);
+void DispatchRequest(Packet_t* request, Connection_t* conn);
+int AdmitRequest(Request_t* request);
+uint64_t GetDeadline(Packet_t* request, uint64_t start);
+void PrepareBusyResponse(Packet_t* request, Packet_t* response);
+int DropExpiredRequests(Request_t* requests, int requestsNum);
+int SendReply(Request_t* request, Packet_t* response);
 int InitializeWorkers(int workersNum);
-void DestroyWorkers(int workersNum, int threadNum, int busySemNum, int freeSemNum);
+void DestroyWorkers(int threadNum);
 void* HandleRequest(void* ptrToWorker);
+void ProcessRequest(Packet_t* request, Packet_t* response, RequestTiming_t* timing);
+void ProcessWriteBatch(Request_t* requests, Packet_t* responses, int requestsNum);
+int PrepareResponse(Packet_t* request, Packet_t* response);
+void ExecuteRequest(Packet_t* request, Packet_t* response);
+void GetStats(const char* selector, Packet_t* response);
+int AttachShmClient(Connection_t* conn, int fd);
+void DetachShmClient(Connection_t* conn);
+void* ServeShmClient(void* ptrToClient);
+void CleanUp();
 void SigIntHandler(int dummy);
 void Shell();
 
 
 Phonebook_t* pb = NULL;				// Global instance of phonebook struct
-int serverRunning = 1;				// Indicates if server is active
+ResponseCache_t* responseCache = NULL;		// Cache of responses to GET_CONTACT requests (NULL if disabled)
+ServerConfig_t config = { DEFAULT_CACHE_SIZE, DEFAULT_QUEUE_SIZE, 0, 0, DEFAULT_WRITE_DELAY, "-", DEFAULT_LOG_LEVEL, 1, DEFAULT_SLOW_THRESHOLD, RESPONSE_TIMEOUT, NULL, 0 };	// Configuration of the server (set by command line options)
+RequestQueue_t* requestQueue = NULL;		// Requests received by main thread that are waiting for a worker
+RateLimiter_t* rateLimiter = NULL;		// Token buckets of clients (NULL if rate limiting is disabled)
+TraceWriter_t* traceWriter = NULL;		// Trace of incoming requests (NULL if it is not recorded)
+AdmissionStats_t admissionStats = { 0, 0, 0 };	// Requests refused or dropped (main thread updates queueFull, other counters are updated atomically)
+volatile sig_atomic_t serverRunning = 1;	// Indicates if server is active (cleared by SIGINT handler)
 int serverSock = -1;
+int tcpListenSock = -1;				// Socket on which server accepts TCP connections
+int unixListenSock = -1;			// Socket on which server accepts connections from clients on the same host
 pthread_mutex_t socketMutx;			// Mutex to regulate write operations on server's socket
-sem_t pbSem;					// Semaphore to regulate read and write operations on/from phonebook data
+pthread_rwlock_t pbLock;			// Lock to regulate read and write operations on/from phonebook data (writers are preferred)
 Worker_t workers[MAX_CLIENT_NUM];		// Workers that works to satisfy clients requests
+ShmClient_t shmClients[MAX_CONNECTIONS];	// Clients that use shared memory (slot i is used by a segment attached on connection i)
 
 
 int main(int argc, char* argv[])
 {
-	if(argc != 3)
+	if(ParseOptions(argc, argv) == 0 || argc - optind != 2)
 	{
-		fprintf(stderr, "usage is: %s <phonebook data filename> <credentials data filename>\n", argv[0]);
+		fprintf(stderr, "usage is: %s [options] <phonebook data filename> <credentials data filename>\n", argv[0]);
 		fprintf(stderr, "If this is the first use files will be created automatically, just choose a name\n");
+		fprintf(stderr, "Options:\n");
+		fprintf(stderr, "  -c <entries>   size of GET_CONTACT response cache, 0 disables it (default %d)\n", DEFAULT_CACHE_SIZE);
+		fprintf(stderr, "  -q <requests>  max number of requests waiting for a worker, others are answered BUSY (default %d)\n", DEFAULT_QUEUE_SIZE);
+		fprintf(stderr, "  -r <req/s>     max rate of requests of each client, 0 disables the limit (default 0)\n");
+		fprintf(stderr, "  -b <requests>  max burst of requests of each client (default one second worth of requests)\n");
+		fprintf(stderr, "  -w <ms>        max time a write waits while reads are served before it (default %d)\n", DEFAULT_WRITE_DELAY);
+		fprintf(stderr, "  -l <file>      file on which access log is written, - is stdout (default -)\n");
+		fprintf(stderr, "  -v <level>     access log verbosity: 0 disabled, 1 writes and logins, 2 all requests (default %d)\n", DEFAULT_LOG_LEVEL);
+		fprintf(stderr, "  -s <n>         write on access log only one of every n requests (default 1)\n");
+		fprintf(stderr, "  -t <ms>        always write on access log requests slower than this, with their phases, 0 disables (default %d)\n", DEFAULT_SLOW_THRESHOLD);
+		fprintf(stderr, "  -d <ms>        deadline of requests that don't carry one, 0 means no deadline (default %d)\n", RESPONSE_TIMEOUT);
+		fprintf(stderr, "  -T <file>      record a trace of incoming requests on file, it can be replayed by tester\n");
+		fprintf(stderr, "  -a             replace names in the trace with a salted hash\n");
 		return -1;
 	}
 
-	pb = CreatePhonebook(argv[1], argv[2]);			// Create new phonebook
+	pb = CreatePhonebook(argv[optind], argv[optind + 1]);	// Create new phonebook
 	if(pb == NULL)						// Check if creation failed
 		exit(-1);
 
-	if(InitializeWorkers(MAX_CLIENT_NUM) == 0)		// Initialize all threads, data and synch mechanisms
+	pb->deferSync = 1;					// Writes are flushed once per batch by ProcessWriteBatch()
+
+	if(config.cacheSize > 0)				// Create cache for GET_CONTACT responses
 	{
-		DestroyPhonebook(&pb);
-		exit(-1);
+		responseCache = CreateResponseCache(config.cacheSize);
+		if(responseCache == NULL)
+		{
+			DestroyPhonebook(&pb);
+			exit(-1);
+		}
 	}
 
-	if(InitializeSocket(SERVER_PORT_NUM) == 0)		// Initialize server's socket
+	if(InitializeSessions() == 0)				// Initialize table of sessions of logged clients
 	{
-		DestroyWorkers(MAX_CLIENT_NUM, MAX_CLIENT_NUM, MAX_CLIENT_NUM, MAX_CLIENT_NUM);
+		DestroyResponseCache(&responseCache);
 		DestroyPhonebook(&pb);
 		exit(-1);
 	}
 
+	InitializeStats();					// Start to record latency of requests
+
 	struct sigaction intHandler;
 	intHandler.sa_handler = SigIntHandler;
 	//intHandler.sa_handler = Shell;			// Uncomment to enable shell function for debug purpouses 
-	intHandler.sa_flags = 0;
+	sigemptyset(&intHandler.sa_mask);
+	intHandler.sa_flags = 0;				// No SA_RESTART, so that ppoll() is interrupted
 	sigaction(SIGINT, &intHandler, NULL);			// Set callback function for SIG_INT
 
+	sigset_t intMask, waitMask;				// SIGINT is blocked before any thread is created, so that all of them inherit
+	sigemptyset(&intMask);					// the mask and the signal is delivered only to main thread while it waits in
+	sigaddset(&intMask, SIGINT);				// ppoll(), which can't miss a signal received just before it is called
+	pthread_sigmask(SIG_BLOCK, &intMask, &waitMask);
+
+	if(StartAccessLog(config.logFilename, config.logLevel, config.logSampling, config.slowThreshold * 1000000ULL) == 0)
+	{
+		DestroySessions();
+		DestroyResponseCache(&responseCache);
+		DestroyPhonebook(&pb);
+		exit(-1);
+	}
+
+	if(config.traceFilename != NULL)			// Start to record incoming requests
+	{
+		traceWriter = OpenTraceWriter(config.traceFilename, config.anonymizeTrace);
+		if(traceWriter == NULL)
+		{
+			StopAccessLog();
+			DestroySessions();
+			DestroyResponseCache(&responseCache);
+			DestroyPhonebook(&pb);
+			exit(-1);
+		}
+	}
+
+	if(InitializeWorkers(MAX_CLIENT_NUM) == 0)		// Initialize all threads, data and synch mechanisms
+	{
+		CloseTraceWriter(&traceWriter);
+		StopAccessLog();
+		DestroySessions();
+		DestroyResponseCache(&responseCache);
+		DestroyPhonebook(&pb);
+		exit(-1);
+	}
+
+	if(InitializeSocket(SERVER_PORT_NUM) == 0)		// Initialize server's socket
+	{
+		DestroyWorkers(MAX_CLIENT_NUM);
+		CloseTraceWriter(&traceWriter);
+		StopAccessLog();
+		DestroySessions();
+		DestroyResponseCache(&responseCache);
+		DestroyPhonebook(&pb);
+		exit(-1);
+	}
+
 	printf("\nWaiting for clients...\n");
 
-	int i = 0;						// Keeps track of which worker will handle next request
-	size_t bytesReceived = 0;
+	struct pollfd fds[3 + MAX_CONNECTIONS];			// UDP socket, TCP and unix listeners and all open connections
+	Connection_t* conns[MAX_CONNECTIONS];
+	Packet_t request;
+
 	while(serverRunning == 1)
 	{
-		sem_wait(&workers[i].isFree);			// Wait until current worker is ready to handle new request
+		fds[0].fd = serverSock;
+		fds[0].events = POLLIN;
+		fds[1].fd = tcpListenSock;
+		fds[1].events = POLLIN;
+		fds[2].fd = unixListenSock;
+		fds[2].events = POLLIN;
+		int fdsNum = 3 + GetConnectionsPollSet(&fds[3], conns, MAX_CONNECTIONS);
+
+		if(ppoll(fds, fdsNum, NULL, &waitMask) <= 0)	// Wait until something can be read from one of the sockets (or SIGINT)
+			continue;
+
+		if(fds[0].revents & POLLIN)			// If datagrams have been received
+			ReceiveDatagrams();
+
+		if(fds[1].revents & POLLIN)			// If a client wants to open a new connection
+			AcceptConnection(tcpListenSock, TCP_TRANSPORT);
 
-		bytesReceived = recvfrom(serverSock, &workers[i].request, sizeof(Packet_t), 0, (struct sockaddr*) &(workers[i].clientAddr), &workers[i].addrLen);
-		if(bytesReceived == sizeof(Packet_t))		// If we received the right amount of data
+		if(fds[2].revents & POLLIN)
+			AcceptConnection(unixListenSock, UNIX_TRANSPORT);
+
+		for(int i = 3; i < fdsNum; i++)			// For each connection on which there is something to read
 		{
-			sem_post(&workers[i].isBusy);		// Signal to worker that there is a request for him
-			i++;
-			i %= MAX_CLIENT_NUM;
-		} else {
-			sem_post(&workers[i].isFree);		// If we received a wrong amount of data reset current worker semaphore
-		}
+			if(fds[i].revents == 0)
+				continue;
+
+			int result;
+			while((result = ReadFromConnection(conns[i - 3], &request)) == 1)	// Dispatch all requests received (client may pipeline them)
+			{
+				if(request.type == ATTACH_SHM)	// Client wants to send next requests through shared memory
+				{
+					int attached = AttachShmClient(conns[i - 3], conns[i - 3]->passedFd);
+					conns[i - 3]->passedFd = -1;
+
+					memset(&request, 0, sizeof(Packet_t));
+					request.type = attached == 1 ? ACCEPTED : REJECTED;
+					if(SendOnConnection(conns[i - 3], &request) == 0 && attached == 1)
+						DetachShmClient(conns[i - 3]);
+					continue;
+				}
+
+				DispatchRequest(&request, conns[i - 3]);
+			}
 
+			if(result == -1)			// If client closed the connection
+			{
+				DetachShmClient(conns[i - 3]);
+				CloseConnection(conns[i - 3]);
+			}
+		}
 	}
 
-	DestroyWorkers(MAX_CLIENT_NUM, MAX_CLIENT_NUM, MAX_CLIENT_NUM, MAX_CLIENT_NUM);
-	close(serverSock);
-	DestroyPhonebook(&pb);
+	CleanUp();
 	return 0;
 }
 
 
-// Creates server's socket for UDP communication
+// Parses command line options and stores their values in config, returns 0 if an option is not valid
+int ParseOptions(int argc, char* argv[])
+{
+	int option;
+	while((option = getopt(argc, argv, "c:q:r:b:w:l:v:s:t:d:T:a")) != -1)
+	{
+		switch(option)
+		{
+			case 'c':
+				config.cacheSize = (size_t) strtoul(optarg, NULL, 10);
+				break;
+
+			case 'q':
+				config.queueSize = (size_t) strtoul(optarg, NULL, 10);
+				if(config.queueSize == 0)
+					return 0;
+				break;
+
+			case 'r':
+				config.rateLimit = strtod(optarg, NULL);
+				if(config.rateLimit < 0)
+					return 0;
+				break;
+
+			case 'b':
+				config.rateBurst = strtod(optarg, NULL);
+				if(config.rateBurst < 0)
+					return 0;
+				break;
+
+			case 'w':
+				config.writeDelay = (unsigned int) strtoul(optarg, NULL, 10);
+				break;
+
+			case 'l':
+				config.logFilename = optarg;
+				break;
+
+			case 'v':
+				config.logLevel = (LogLevel_t) strtoul(optarg, NULL, 10);
+				if(config.logLevel > LOG_ALL)
+					return 0;
+				break;
+
+			case 's':
+				config.logSampling = (unsigned int) strtoul(optarg, NULL, 10);
+				if(config.logSampling == 0)
+					return 0;
+				break;
+
+			case 't':
+				config.slowThreshold = (unsigned int) strtoul(optarg, NULL, 10);
+				break;
+
+			case 'd':
+				config.requestTimeout = (unsigned int) strtoul(optarg, NULL, 10);
+				break;
+
+			case 'T':
+				config.traceFilename = optarg;
+				break;
+
+			case 'a':
+				config.anonymizeTrace = 1;
+				break;
+
+			default:
+				return 0;
+		}
+	}
+
+	return 1;
+}
+
+
+// Creates server's sockets, one for UDP communication, one to accept TCP connections and one to accept connections on SERVER_SOCKET_PATH
 int InitializeSocket(const char* portNum)
 {
-	if(serverSock != -1 || portNum == NULL)
+	if(serverSock != -1 || tcpListenSock != -1 || unixListenSock != -1 || portNum == NULL)
 		return 0;
 
 	printf("Intializing socket... ");
 
+	if(InitializeConnections() == 0)
+		return 0;
+
+	serverSock = CreateBoundSocket(portNum, SOCK_DGRAM);		// Create socket to receive datagrams
+	tcpListenSock = CreateBoundSocket(portNum, SOCK_STREAM);	// Create socket to accept TCP connections
+	unixListenSock = CreateUnixSocket(SERVER_SOCKET_PATH);		// Create socket to accept unix connections
+
+	if(serverSock == -1 || tcpListenSock == -1 || unixListenSock == -1)
+	{
+		CloseSockets();
+		return 0;
+	}
+
+	int timestamps = 1;								// Let the kernel timestamp datagrams when they arrive
+	if(setsockopt(serverSock, SOL_SOCKET, SO_TIMESTAMPNS, &timestamps, sizeof(int)) != 0)
+		fprintf(stderr, "Error: cannot enable timestamps on UDP socket, socket delay will not be measured\n");
+
+	if(listen(tcpListenSock, MAX_CONNECTIONS) != 0 || listen(unixListenSock, MAX_CONNECTIONS) != 0)
+	{
+		fprintf(stderr, "Error: cannot listen for connections...\n");
+		CloseSockets();
+		return 0;
+	}
+
+	printf("Socket ready!\n");
+	return 1;
+}
+
+
+// Creates a socket of the given type bound to portNum on all interfaces, returns the socket or -1 on failure
+int CreateBoundSocket(const char* portNum, int sockType)
+{
 	struct addrinfo addrHints;
 	struct addrinfo* serverAddr = NULL;
 
 	memset(&addrHints, 0, sizeof(struct addrinfo));			// Set properties that server address should have
 	addrHints.ai_family = AF_INET;
 	addrHints.ai_protocol = 0;
-	addrHints.ai_socktype = SOCK_DGRAM;
+	addrHints.ai_socktype = sockType;
 	addrHints.ai_flags = AI_PASSIVE;
 
 	if(getaddrinfo(NULL, portNum, &addrHints, &serverAddr) != 0)	// Get server address
 	{
 		fprintf(stderr, "Error: getaddrinfo() failed...\n");
-		return 0;
+		return -1;
 	}
 
-	serverSock = socket(serverAddr->ai_family, serverAddr->ai_socktype, serverAddr->ai_protocol);	// Create socket to receive requests
-	if(serverSock == -1)
+	int sock = socket(serverAddr->ai_family, serverAddr->ai_socktype, serverAddr->ai_protocol);
+	if(sock == -1)
 	{
 		fprintf(stderr, "Error: cannot create socket...\n");
 		freeaddrinfo(serverAddr);
-		return 0;
+		return -1;
 	}
 
-	if(bind(serverSock, serverAddr->ai_addr, serverAddr->ai_addrlen) != 0)
+	if(sockType == SOCK_STREAM)					// Let the server restart while old connections are in TIME_WAIT
+	{
+		int reuse = 1;
+		setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(int));
+	}
+
+	if(bind(sock, serverAddr->ai_addr, serverAddr->ai_addrlen) != 0)
 	{
 		fprintf(stderr, "Error: cannot bind socket...\n");
-		close(serverSock);
+		close(sock);
 		freeaddrinfo(serverAddr);
-		return 0;
+		return -1;
 	}
 
-	freeaddrinfo(serverAddr);				// Server address is not required anymore
-	printf("Socket ready!\n");
-	return 1;
+	freeaddrinfo(serverAddr);					// Server address is not required anymore
+	return sock;
+}
+
+
+// Creates a unix seqpacket socket bound to path (if path is a socket left by a previous run it is replaced, if a server is still listening
+// on it this fails), returns the socket or -1 on failure
+int CreateUnixSocket(const char* path)
+{
+	int sock = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+	if(sock == -1)
+	{
+		fprintf(stderr, "Error: cannot create unix socket...\n");
+		return -1;
+	}
+
+	struct sockaddr_un addr;
+	memset(&addr, 0, sizeof(struct sockaddr_un));
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+
+	int probe = socket(AF_UNIX, SOCK_SEQPACKET, 0);			// If a server is still listening on path, don't steal its socket
+	if(probe != -1 && connect(probe, (struct sockaddr*) &addr, sizeof(struct sockaddr_un)) == 0)
+	{
+		fprintf(stderr, "Error: another server is listening on %s...\n", path);
+		close(probe);
+		close(sock);
+		return -1;
+	}
+	if(probe != -1)
+		close(probe);
+
+	unlink(path);							// Remove socket file left by a previous run
+	if(bind(sock, (struct sockaddr*) &addr, sizeof(struct sockaddr_un)) != 0)
+	{
+		fprintf(stderr, "Error: cannot bind unix socket to %s...\n", path);
+		close(sock);
+		return -1;
+	}
+
+	return sock;
+}
+
+
+// Closes all server's sockets and connections
+void CloseSockets()
+{
+	for(int i = 0; i < MAX_CONNECTIONS; i++)
+		DetachShmClient(&connections[i]);
+
+	DestroyConnections();
+
+	if(serverSock != -1)
+		close(serverSock);
+
+	if(tcpListenSock != -1)
+		close(tcpListenSock);
+
+	if(unixListenSock != -1)
+	{
+		close(unixListenSock);
+		unlink(SERVER_SOCKET_PATH);
+	}
+
+	serverSock = tcpListenSock = unixListenSock = -1;
+}
+
+
+// Reads datagrams received on UDP socket (at most MAX_DATAGRAM_BATCH, so that connections are not starved) and admits them in the queue
+void ReceiveDatagrams()
+{
+	Request_t request;
+	struct iovec iov = { &request.packet, sizeof(Packet_t) };
+	char control[CMSG_SPACE(sizeof(struct timespec))];			// Kernel timestamp of the datagram
+	struct msghdr msg;
+
+	for(int i = 0; i < MAX_DATAGRAM_BATCH; i++)
+	{
+		memset(&msg, 0, sizeof(struct msghdr));
+		msg.msg_name = &request.clientAddr;
+		msg.msg_namelen = sizeof(struct sockaddr_in);
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+		msg.msg_control = control;
+		msg.msg_controllen = sizeof(control);
+
+		ssize_t bytesReceived = recvmsg(serverSock, &msg, MSG_DONTWAIT);
+		if(bytesReceived == -1)						// No more datagrams
+			break;
+
+		if(bytesReceived != sizeof(Packet_t))				// Ignore datagrams with a wrong amount of data
+			continue;
+
+		StartTiming(&request.timing, GetTimeNs());
+		uint64_t socketDelay = GetSocketDelay(&msg);
+		if(socketDelay != 0)
+			request.timing.arrived = request.timing.received - socketDelay;
+
+		request.addrLen = msg.msg_namelen;
+		request.conn = NULL;
+		AdmitRequest(&request);
+	}
+}
+
+
+// Returns time (ns) that datagram received with msg has waited in the socket buffer, or 0 if kernel didn't timestamp it
+uint64_t GetSocketDelay(struct msghdr* msg)
+{
+	for(struct cmsghdr* cmsg = CMSG_FIRSTHDR(msg); cmsg != NULL; cmsg = CMSG_NXTHDR(msg, cmsg))
+	{
+		if(cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_TIMESTAMPNS)
+			continue;
+
+		struct timespec arrival;					// Kernel timestamps use the realtime clock
+		struct timespec now;
+		memcpy(&arrival, CMSG_DATA(cmsg), sizeof(struct timespec));
+		clock_gettime(CLOCK_REALTIME, &now);
+
+		int64_t delay = (int64_t)(now.tv_sec - arrival.tv_sec) * 1000000000LL + (now.tv_nsec - arrival.tv_nsec);
+		return delay > 0 ? (uint64_t) delay : 1;			// Clock may have been adjusted meanwhile
+	}
+
+	return 0;
+}
+
+
+// Admits request received from conn in the queue of workers
+void DispatchRequest(Packet_t* request, Connection_t* conn)
+{
+	Request_t queued;
+	StartTiming(&queued.timing, GetTimeNs());
+	memcpy(&queued.packet, request, sizeof(Packet_t));
+	queued.conn = conn;
+	AcquireConnection(conn);					// Connection must stay open until response has been sent
+
+	AdmitRequest(&queued);
+}
+
+
+// Pushes request in the queue of workers without waiting, if client exceeded its rate or the queue is full client receives a
+// BUSY response immediately (timing of request must have been started). Returns 0 if request has been refused
+int AdmitRequest(Request_t* request)
+{
+	uint64_t start = request->timing.arrived != 0 ? request->timing.arrived : request->timing.received;
+	request->deadline = GetDeadline(&request->packet, start);			// Client started to wait before we read the request
+
+	PROBE2(request_receive, request->packet.requestId, request->packet.type);
+	WriteTraceRecord(traceWriter, &request->packet, start);			// Trace offered load, also requests that will be refused
+
+	uint64_t key;								// Clients on connections are identified by their connection
+	if(request->conn != NULL)
+		key = ((uint64_t) 1 << 48) | (uint64_t)(request->conn - connections);
+	else
+		key = ((uint64_t) ntohl(request->clientAddr.sin_addr.s_addr) << 16) | ntohs(request->clientAddr.sin_port);
+
+	if(TakeToken(rateLimiter, key, request->timing.received) == 0)
+		atomic_fetch_add(&admissionStats.rateLimited, 1);
+	else if(TryEnqueueRequest(requestQueue, request) == 0)
+		admissionStats.queueFull++;
+	else
+	{
+		PROBE2(request_dispatch, request->packet.requestId, request->packet.type);
+		return 1;
+	}
+
+	Packet_t busy;
+	PrepareBusyResponse(&request->packet, &busy);
+	SendReply(request, &busy);
+	return 0;
 }
 
 
-// Creates all threads, initializes their data and intializes all synch mechanism needed by the server
+// Returns the time after which the client of request, that arrived at start, is no longer waiting for the response (0 if it has no
+// deadline)
+uint64_t GetDeadline(Packet_t* request, uint64_t start)
+{
+	unsigned int timeout = request->timeoutMs != 0 ? request->timeoutMs : config.requestTimeout;
+	return timeout != 0 ? start + timeout * 1000000ULL : 0;
+}
+
+
+// Fills response with the BUSY answer to a request refused by admission control
+void PrepareBusyResponse(Packet_t* request, Packet_t* response)
+{
+	PROBE2(request_busy, request->requestId, request->type);
+
+	memset(response, 0, sizeof(Packet_t));
+	response->type = BUSY;
+	response->requestId = request->requestId;
+	strncpy(response->name, "Server busy, retry later", MAX_NAME_SIZE);
+}
+
+
+// Sends response to the client of request on the same transport used by the request, returns 0 on failure 1 otherwise. It never blocks,
+// so the dispatcher can send BUSY responses: a response that doesn't fit in the socket buffer is not sent (see SendOnConnection())
+int SendReply(Request_t* request, Packet_t* response)
+{
+	int sent = 0;
+	PROBE2(response_send, response->requestId, response->type);
+
+	if(request->conn != NULL)
+	{
+		sent = SendOnConnection(request->conn, response);
+		ReleaseConnection(request->conn);
+		request->conn = NULL;
+	} else {
+		pthread_mutex_lock(&socketMutx);
+		sent = SendPacket(serverSock, response, &request->clientAddr, request->addrLen, MSG_DONTWAIT);
+		pthread_mutex_unlock(&socketMutx);
+	}
+
+	return sent;
+}
+
+
+// Creates all threads, the queue of requests and intializes all synch mechanism needed by the server
 int InitializeWorkers(int workersNum)
 {
 	printf("Initializing worker threads... ");
@@ -159,36 +655,42 @@ int InitializeWorkers(int workersNum)
 		return 0;
 	}
 
-	if(sem_init(&pbSem, 0, MAX_CLIENT_NUM) != 0)				// Initialize semaphore to regulate read/write ops on phonebook's data
+	pthread_rwlockattr_t lockAttr;						// Writers are preferred so that a batch is not delayed by new reads
+	pthread_rwlockattr_init(&lockAttr);
+	pthread_rwlockattr_setkind_np(&lockAttr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+	if(pthread_rwlock_init(&pbLock, &lockAttr) != 0)			// Initialize lock to regulate read/write ops on phonebook's data
 	{
-		fprintf(stderr, "Error: cannot intialize semaphore for phonebook...\n");
+		fprintf(stderr, "Error: cannot intialize lock for phonebook...\n");
+		pthread_rwlockattr_destroy(&lockAttr);
 		pthread_mutex_destroy(&socketMutx);
 		return 0;
 	}
+	pthread_rwlockattr_destroy(&lockAttr);
 
-	for(int i = 0; i < workersNum; i++)						// For each worker
+	requestQueue = CreateRequestQueue(config.queueSize, config.writeDelay * 1000000ULL);			// Create queue in which main thread pushes requests
+	if(requestQueue == NULL)
 	{
-		memset(&workers[i].clientAddr, 0, sizeof(struct sockaddr_in));		// Initialize client address struct
-		workers[i].addrLen = sizeof(struct sockaddr_in);
-
-		if(sem_init(&workers[i].isBusy, 0, 0) == -1)				// Initialize isBusy semaphore
-		{
-			fprintf(stderr, "Error: cannot initialize busy semaphore for worker %d...\n", i + 1);
-			DestroyWorkers(i, i - 1, i - 1, i - 1);
-			return 0;
-		}
+		DestroyWorkers(0);
+		return 0;
+	}
 
-		if(sem_init(&workers[i].isFree, 0, 1) == -1)				// Initialize isFree semaphore
+	if(config.rateLimit > 0)						// Create token buckets only if clients are rate limited
+	{
+		rateLimiter = CreateRateLimiter(config.rateLimit, config.rateBurst > 0 ? config.rateBurst : (config.rateLimit > 1 ? config.rateLimit : 1));
+		if(rateLimiter == NULL)
 		{
-			fprintf(stderr, "Error: cannot initialize free semaphore for worker %d\n", i + 1);
-			DestroyWorkers(i, i - 1, i, i - 1);
+			DestroyWorkers(0);
 			return 0;
 		}
+	}
 
+	for(int i = 0; i < workersNum; i++)						// For each worker
+	{
+		workers[i].id = i;
 		if(pthread_create(&workers[i].tid, NULL, HandleRequest, (void*) &workers[i]) != 0) // Create thread
 		{
 			fprintf(stderr, "Error: cannot initialize thread for worker %d...\n", i +1);
-			DestroyWorkers(i, i - 1, i, i);
+			DestroyWorkers(i);
 			return 0;
 		}
 	}
@@ -198,30 +700,28 @@ int InitializeWorkers(int workersNum)
 }
 
 
-// Destroyes all synch mechanism and shutdown worker threads
-void DestroyWorkers(int workersNum, int threadNum, int busySemNum, int freeSemNum)
+// Shutdown the first threadNum worker threads and destroyes the queue and all synch mechanism
+void DestroyWorkers(int threadNum)
 {
 	printf("Destroying workers... ");
-	pthread_mutex_destroy(&socketMutx);			// Destroy socket's mutex
-	sem_destroy(&pbSem);					// Destroy phonebook semaphore 
 
-	for(int i = 0; i < workersNum; i++)			// For each worker
+	for(int i = 0; i < threadNum; i++)			// For each worker
 	{
-		if(i < threadNum)
-			pthread_cancel(workers[i].tid);		// Terminate thread
-
-		if(i < busySemNum)
-			sem_destroy(&workers[i].isBusy);	// Destroy current worker's busy semaphore
-	
-		if(i < freeSemNum)
-			sem_destroy(&workers[i].isFree);	// Destroy current worker's free semaphore
+		pthread_cancel(workers[i].tid);			// Terminate thread
+		pthread_join(workers[i].tid, NULL);		// Wait for it, it may be waiting on the queue
 	}
 
+	DestroyRateLimiter(&rateLimiter);
+	PrintQueueStats(requestQueue);
+	DestroyRequestQueue(&requestQueue);
+	pthread_mutex_destroy(&socketMutx);			// Destroy socket's mutex
+	pthread_rwlock_destroy(&pbLock);			// Destroy phonebook lock
+
 	printf("Workers destroyed!\n");
 }
 
 
-// Analyze request sent by client and generates a response to it
+// Takes requests from the queue, satisfies them and sends a response to the client
 void* HandleRequest(void* ptrToWorker)
 {
 	Worker_t* me = (Worker_t*) ptrToWorker;
@@ -231,126 +731,436 @@ void* HandleRequest(void* ptrToWorker)
 
 	while(serverRunning == 1)
 	{
-		memset(&me->response, 0, sizeof(Packet_t));
-		sem_wait(&me->isBusy);								// Wait until a request arrives from main thread
-		sem_wait(&pbSem);								// Signal to everyone that we are operating on phonebook struct
+		int areWrites = 0;								// Wait until a request is received by main thread
+		int requestsNum = DequeueRequests(requestQueue, me->requests, MAX_WRITE_BATCH, &areWrites);
+		PROBE3(request_dequeue, me->id, requestsNum, areWrites);
+
+		requestsNum = DropExpiredRequests(me->requests, requestsNum);		// Don't waste time (and fsyncs) on them
+		if(requestsNum == 0)
+		{
+			if(areWrites == 1)
+				EndWriteBatch(requestQueue);
+			continue;
+		}
 
-		if(CheckPermission(pb, me->request.clientName, me->request.type) == 0)		// Check if client has permission to execute such request
+		if(areWrites == 1)
 		{
-			strncpy(me->response.name, "You don't have permission", MAX_NAME_SIZE);	// If it does not send an error
-			me->response.type = REJECTED;
-			SendPacket(serverSock, &me->response, &(me->clientAddr), me->addrLen);
+			ProcessWriteBatch(me->requests, me->responses, requestsNum);
+			EndWriteBatch(requestQueue);
+		} else {
+			ProcessRequest(&me->requests[0].packet, &me->responses[0], &me->requests[0].timing);
+		}
+
+		for(int i = 0; i < requestsNum; i++)						// Send response packets
+		{
+			SendReply(&me->requests[i], &me->responses[i]);
+			me->requests[i].timing.completed = GetTimeNs();
+			RecordRequest(me->requests[i].packet.type, &me->requests[i].timing);
+			LogRequest(me->id, &me->requests[i].packet, &me->responses[i], &me->requests[i].timing);
+		}
+	}
 
-			sem_post(&me->isFree);							// Signal to main thread that we are available to process a new request
-			sem_post(&pbSem);							// Signal to everyone that our operation on phonebook is over
+	return NULL;
+}
+
+
+// Removes from requests those whose client is no longer waiting for the response (they are not answered), returns number of requests left
+int DropExpiredRequests(Request_t* requests, int requestsNum)
+{
+	uint64_t now = GetTimeNs();
+	int left = 0;
+
+	for(int i = 0; i < requestsNum; i++)
+	{
+		if(requests[i].deadline != 0 && now >= requests[i].deadline)
+		{
+			PROBE2(request_expired, requests[i].packet.requestId, requests[i].packet.type);
+			atomic_fetch_add_explicit(&admissionStats.expired, 1, memory_order_relaxed);
+			if(requests[i].conn != NULL)
+				ReleaseConnection(requests[i].conn);
 			continue;
 		}
 
-		switch(me->request.type)							// If it has permission then try to satisfy the request
+		if(left != i)
+			memcpy(&requests[left], &requests[i], sizeof(Request_t));
+		left++;
+	}
+
+	return left;
+}
+
+
+// Analyze request sent by client and generates a response to it (this is used for single requests received on all transports),
+// time spent in each phase is stored in timing
+void ProcessRequest(Packet_t* request, Packet_t* response, RequestTiming_t* timing)
+{
+	if(PrepareResponse(request, response) == 0)
+		return;
+
+	int isWrite = IsWriteRequest(request->type);
+	timing->lockRequested = GetTimeNs();
+	PROBE1(lock_request, isWrite);
+
+	if(isWrite)
+		pthread_rwlock_wrlock(&pbLock);						// Writes need exclusive access to phonebook
+	else
+		pthread_rwlock_rdlock(&pbLock);						// Reads can be executed concurrently
+
+	PROBE1(lock_acquire, isWrite);
+	timing->locked = timing->executed = GetTimeNs();
+	ExecuteRequest(request, response);
+	timing->indexed = GetTimeNs();
+
+	if(isWrite)
+	{
+		timing->flushStarted = timing->indexed;
+		FlushPhonebook(pb);
+		timing->persisted = GetTimeNs();
+	}
+
+	pthread_rwlock_unlock(&pbLock);
+	PROBE1(lock_release, isWrite);
+}
+
+
+// Executes a batch of writes in a single exclusive section, all changes are flushed on disk once before responses are sent
+void ProcessWriteBatch(Request_t* requests, Packet_t* responses, int requestsNum)
+{
+	int toExecute[MAX_WRITE_BATCH];
+	int executeNum = 0;
+
+	for(int i = 0; i < requestsNum; i++)						// Requests without permission don't need the lock
+	{
+		if(PrepareResponse(&requests[i].packet, &responses[i]) == 1)
+			toExecute[executeNum++] = i;
+	}
+
+	if(executeNum == 0)
+		return;
+
+	uint64_t lockRequested = GetTimeNs();
+	PROBE1(lock_request, 1);
+	pthread_rwlock_wrlock(&pbLock);
+	PROBE1(lock_acquire, 1);
+	uint64_t locked = GetTimeNs();
+
+	for(int i = 0; i < executeNum; i++)						// All requests share the lock, each one is indexed on its own
+	{
+		RequestTiming_t* timing = &requests[toExecute[i]].timing;
+		timing->lockRequested = lockRequested;
+		timing->locked = locked;
+		timing->executed = GetTimeNs();
+		ExecuteRequest(&requests[toExecute[i]].packet, &responses[toExecute[i]]);
+		timing->indexed = GetTimeNs();
+	}
+
+	uint64_t flushStarted = GetTimeNs();
+	FlushPhonebook(pb);
+	uint64_t persisted = GetTimeNs();						// The flush is shared by all requests of the batch
+	pthread_rwlock_unlock(&pbLock);
+	PROBE1(lock_release, 1);
+
+	for(int i = 0; i < executeNum; i++)
+	{
+		requests[toExecute[i]].timing.flushStarted = flushStarted;
+		requests[toExecute[i]].timing.persisted = persisted;
+	}
+}
+
+
+// Checks session of client and looks for the response in cache, returns 1 if request must be executed on phonebook
+int PrepareResponse(Packet_t* request, Packet_t* response)
+{
+	memset(response, 0, sizeof(Packet_t));
+	response->requestId = request->requestId;						// Copy request id so that client can match the response
+
+	if(request->type != LOGIN)								// Everyone can login, for other requests check client's session
+	{
+		int allowed = CheckSession(request->sessionToken, GetRequiredPermission(request->type));
+		if(allowed != 1)
 		{
-			case ADD_CONTACT:
-				for(int i = 0; i < (MAX_CLIENT_NUM - 1); i++)			// Wait all workers to end their operations on phonebook struct
-					sem_wait(&pbSem);
+			strncpy(response->name, allowed == 0 ? "You don't have permission" : "Invalid or expired session, please login", MAX_NAME_SIZE);
+			response->type = REJECTED;
+			return 0;
+		}
+	}
 
-				printf("ADD_CONTACT REQUEST, from: %s, name: %s, num: %s\n", me->request.clientName, me->request.name, me->request.number);
+	if(request->type == GET_CONTACT && CacheLookup(responseCache, request->name, response) == 1)	// Hot contacts don't need the phonebook
+	{
+		response->requestId = request->requestId;
+		return 0;
+	}
 
-				if(AddContact(pb, me->request.name, me->request.number, 0, 1) == 0)
-				{
-					strncpy(me->response.name, "Add contact failed", MAX_NAME_SIZE);
-					me->response.type = REJECTED;
-				} else {
-					strncpy(me->response.name, "Added contact", MAX_NAME_SIZE);
-					me->response.type = ACCEPTED;
-				}
+	if(request->type == STATS)								// Statistics don't need the phonebook
+	{
+		GetStats(request->name, response);
+		return 0;
+	}
 
-				for(int i = 0; i < (MAX_CLIENT_NUM - 1); i++)				// Signal to everyone that our write operation is over
-					sem_post(&pbSem);
+	return 1;
+}
 
-				break;
 
-			case GET_CONTACT:
+// Satisfies request operating on phonebook (caller must hold pbLock, exclusively if request is a write)
+void ExecuteRequest(Packet_t* request, Packet_t* response)
+{
+	switch(request->type)									// If it has permission then try to satisfy the request
+	{
+		case ADD_CONTACT:
+			CacheInvalidate(responseCache, request->name);
+			if(AddContact(pb, request->name, request->number, 0, 1) == 0)
 			{
-				printf("GET_CONTACT REQUEST from: %s, name: %s\n", me->request.clientName, me->request.name);
-
-				BstNode_t* node = SearchNode(pb->dataTree, me->request.name);
-				if(node == NULL)
+				strncpy(response->name, "Add contact failed", MAX_NAME_SIZE);
+				response->type = REJECTED;
+			} else {
+				strncpy(response->name, "Added contact", MAX_NAME_SIZE);
+				response->type = ACCEPTED;
+			}
+			break;
+
+		case GET_CONTACT:
+		{
+			BstNode_t* node = SearchContact(pb, request->name);
+			if(node == NULL)
+			{
+				strncpy(response->name, "Contact not found", MAX_NAME_SIZE);
+				response->type = REJECTED;
+			} else {
+				strncpy(response->name, node->name, MAX_NAME_SIZE);
+				strncpy(response->number, node->number, MAX_PHONE_NUM_SIZE);
+				response->type = ACCEPTED;
+				CacheInsert(responseCache, response);				// Phonebook is locked so contact can't be removed meanwhile
+			}
+		}	break;
+
+		case REMOVE_CONTACT:
+			CacheInvalidate(responseCache, request->name);
+			if(RemoveContact(pb, request->name) == 0)
+			{
+				strncpy(response->name, "Contact not found", MAX_NAME_SIZE);
+				response->type = REJECTED;
+			} else {
+				strncpy(response->name, "Contact removed", MAX_NAME_SIZE);
+				response->type = ACCEPTED;
+			}
+			break;
+
+		case LOGIN:
+		{
+			int passwordCheck = CheckPassword(pb, request->name, request->number);
+			if(passwordCheck == -1)
+			{
+				strncpy(response->name, "Username unrecognized", MAX_NAME_SIZE);
+				response->type = REJECTED;
+			} else if(passwordCheck == 0)
+			{
+				strncpy(response->name, "Wrong password", MAX_NAME_SIZE);
+				response->type = REJECTED;
+			} else {							// Bind a new session to the permissions of the user
+				response->sessionToken = CreateSession(request->name, GetPermissionMask(pb, request->name));
+				if(response->sessionToken == 0)
 				{
-					strncpy(me->response.name, "Contact not found", MAX_NAME_SIZE);
-					me->response.type = REJECTED;
+					strncpy(response->name, "Too many sessions, retry later", MAX_NAME_SIZE);
+					response->type = REJECTED;
 				} else {
-					strncpy(me->response.name, node->name, MAX_NAME_SIZE);
-					strncpy(me->response.number, node->number, MAX_PHONE_NUM_SIZE);
-					me->response.type = ACCEPTED;
+					strncpy(response->name, "Logged in", MAX_NAME_SIZE);
+					response->type = ACCEPTED;
 				}
-			}	break;
+			}
+		}	break;
 
-			case REMOVE_CONTACT:
-				for(int i = 0; i < (MAX_CLIENT_NUM - 1); i++)				// Wait all workers to end their operations on phonebook struct
-					sem_wait(&pbSem);
+		default:
+			strncpy(response->name, "Invalid request", MAX_NAME_SIZE);
+			response->type = REJECTED;
+			break;
+	}
+}
 
-				printf("REMOVE_CONTACT REQUEST from: %s, name: %s\n", me->request.clientName, me->request.name);
 
-				if(RemoveContact(pb, me->request.name) == 0)
-				{
-					strncpy(me->response.name, "Contact not found", MAX_NAME_SIZE);
-					me->response.type = REJECTED;
-				} else {
-					strncpy(me->response.name, "Contact removed", MAX_NAME_SIZE);
-					me->response.type = ACCEPTED;
-				}
+// Writes in response the statistics choosen by selector: "<request type>.<phase>" (phase is queue, lock, index, persist or total),
+// "throughput", "cache", "bloom", "admission", "queue", "process" (memory and data file size), "index" or "credentials" (shape of contacts
+// or credentials tree) or "datafile" (space taken by removed entries)
+void GetStats(const char* selector, Packet_t* response)
+{
+	char buff[MAX_NAME_SIZE];
+	char key[MAX_NAME_SIZE];
+	int valid = 1;
+
+	strncpy(key, selector, MAX_NAME_SIZE - 1);						// Selector sent by client may not be terminated
+	key[MAX_NAME_SIZE - 1] = '\0';
+	selector = key;
+
+	if(strcmp(selector, "throughput") == 0)
+		FormatThroughput(buff, MAX_NAME_SIZE);
+	else if(strcmp(selector, "cache") == 0)
+		FormatCacheStats(responseCache, buff, MAX_NAME_SIZE);
+	else if(strcmp(selector, "bloom") == 0)
+		FormatBloomStats(&pb->contactsFilter, buff, MAX_NAME_SIZE);
+	else if(strcmp(selector, "admission") == 0)
+		snprintf(buff, MAX_NAME_SIZE, "queue_full=%lu rate_limited=%lu expired=%lu", (unsigned long) admissionStats.queueFull,
+			(unsigned long) atomic_load(&admissionStats.rateLimited), (unsigned long) atomic_load(&admissionStats.expired));
+	else if(strcmp(selector, "queue") == 0)
+		FormatQueueStats(requestQueue, buff, MAX_NAME_SIZE);
+	else if(strcmp(selector, "process") == 0)
+		FormatProcessStats(pb->dataFd, buff, MAX_NAME_SIZE);
+	else if(strcmp(selector, "index") == 0 || strcmp(selector, "credentials") == 0 || strcmp(selector, "datafile") == 0)
+	{
+		pthread_rwlock_rdlock(&pbLock);						// Stats are kept by writers, read a consistent copy
+		if(strcmp(selector, "index") == 0)
+			FormatBstStats(&pb->dataStats, buff, MAX_NAME_SIZE);
+		else if(strcmp(selector, "credentials") == 0)
+			FormatBstStats(&pb->credentialsStats, buff, MAX_NAME_SIZE);
+		else
+			FormatDataFileStats(pb, buff, MAX_NAME_SIZE);
+		pthread_rwlock_unlock(&pbLock);
+	}
+	else
+		valid = FormatPhaseStats(selector, buff, MAX_NAME_SIZE);
 
-				for(int i = 0; i < (MAX_CLIENT_NUM - 1); i++)				// Signal to everyone that our write operation is over
-					sem_post(&pbSem);
+	if(valid == 0)
+	{
+		strncpy(response->name, "Unknown stats selector", MAX_NAME_SIZE);
+		response->type = REJECTED;
+		return;
+	}
 
-				break;
+	memcpy(response->name, buff, MAX_NAME_SIZE);
+	response->type = ACCEPTED;
+}
 
-			case LOGIN:
-			{
-				printf("LOGIN REQUEST from: %s, name: %s, number: %s\n", me->request.clientName, me->request.name, me->request.number);
 
-				BstNode_t* node = SearchNode(pb->credentialsTree, me->request.name);
-				if(node == NULL)
-				{
-					strncpy(me->response.name, "Username unrecognized", MAX_NAME_SIZE);
-					me->response.type = REJECTED;
-				} else {
-					if(strncmp(me->request.number, node->number, MAX_PASSWORD_SIZE) == 0)
-					{
-						strncpy(me->response.name, "Logged in", MAX_NAME_SIZE);
-						me->response.type = ACCEPTED;
-					} else {
-						strncpy(me->response.name, "Wrong password", MAX_NAME_SIZE);
-						me->response.type = REJECTED;
-					}
-				}
-			}	break;
+// Maps the segment passed by a client on conn and starts a thread that serves requests pushed in it, returns 0 on failure
+int AttachShmClient(Connection_t* conn, int fd)
+{
+	ShmClient_t* client = &shmClients[conn - connections];
+	if(client->segment != NULL || fd == -1)					// A connection can attach only one segment
+		return 0;
 
-			default:
-				printf(" INVALID REQUEST form: %s\n", me->request.clientName);
-				strncpy(me->response.name, "Invalid request", MAX_NAME_SIZE);
-				me->response.type = REJECTED;
-				break;
+	client->segment = MapShmSegment(fd);
+	close(fd);								// Mapping stays valid after descriptor is closed
+	if(client->segment == NULL)
+		return 0;
+
+	client->id = MAX_CLIENT_NUM + (int)(conn - connections);
+	memset(&client->bucket, 0, sizeof(TokenBucket_t));			// Client starts with a full bucket
+	atomic_store(&client->stop, 0);
+	if(pthread_create(&client->tid, NULL, ServeShmClient, (void*) client) != 0)
+	{
+		fprintf(stderr, "Error: cannot create thread for shared memory client\n");
+		UnmapShmSegment(client->segment);
+		client->segment = NULL;
+		return 0;
+	}
+
+	return 1;
+}
+
+
+// Stops the thread that serves the segment attached on conn (if any) and unmaps the segment
+void DetachShmClient(Connection_t* conn)
+{
+	ShmClient_t* client = &shmClients[conn - connections];
+	if(client->segment == NULL)
+		return;
+
+	atomic_store(&client->stop, 1);
+	ShmRingWake(&client->segment->requests);				// Thread may be sleeping waiting for a request
+	ShmRingWake(&client->segment->responses);				// or for room for a response
+	pthread_join(client->tid, NULL);
+
+	UnmapShmSegment(client->segment);
+	client->segment = NULL;
+}
+
+
+// Pops requests from the segment of a shared memory client and pushes responses to them (BUSY if client exceeded its rate), until
+// DetachShmClient() is called
+void* ServeShmClient(void* ptrToClient)
+{
+	ShmClient_t* me = (ShmClient_t*) ptrToClient;
+	Packet_t request;
+	Packet_t response;
+	uint64_t seenAt[SHM_RING_SLOTS];		// Time at which each request in the ring has been seen, it can't have arrived later
+	uint32_t popped = 0;				// Requests popped from the ring
+	uint32_t seen = 0;				// Requests seen in the ring and not popped yet
+
+	while(atomic_load(&me->stop) == 0)
+	{
+		uint64_t now = GetTimeNs();
+		for(uint32_t pending = ShmRingPending(&me->segment->requests); seen < pending; seen++)
+			seenAt[(popped + seen) % SHM_RING_SLOTS] = now;
+
+		if(ShmRingPop(&me->segment->requests, &request) == 0)
+		{
+			ShmRingWait(&me->segment->requests, SHM_POLL_INTERVAL);
+			continue;
 		}
 
-		pthread_mutex_lock(&socketMutx);
-		SendPacket(serverSock, &me->response, &me->clientAddr, me->addrLen);		// Send response packet
-		pthread_mutex_unlock(&socketMutx);
+		uint64_t arrived = seenAt[popped++ % SHM_RING_SLOTS];
+		seen--;
+
+		RequestTiming_t timing;
+		StartTiming(&timing, now);
+		PROBE2(request_receive, request.requestId, request.type);
+		WriteTraceRecord(traceWriter, &request, arrived);
 
-		sem_post(&pbSem);								// Signal to main thread that we completed our operation on phonebook struct
-		sem_post(&me->isFree);								// Signal to main thread that we are available to process a new request
+		uint64_t deadline = GetDeadline(&request, arrived);		// Client may have given up while request waited in the ring
+		if(deadline != 0 && now >= deadline)
+		{
+			PROBE2(request_expired, request.requestId, request.type);
+			atomic_fetch_add_explicit(&admissionStats.expired, 1, memory_order_relaxed);
+			continue;
+		}
+
+		int admitted = TakeBucketToken(rateLimiter, &me->bucket, timing.received);	// Same rate limit of clients on sockets
+		if(admitted == 1)
+			ProcessRequest(&request, &response, &timing);
+		else
+		{
+			atomic_fetch_add(&admissionStats.rateLimited, 1);
+			PrepareBusyResponse(&request, &response);
+		}
+
+		PROBE2(response_send, response.requestId, response.type);
+		while(ShmRingPush(&me->segment->responses, &response) == 0 && atomic_load(&me->stop) == 0)
+			ShmRingWaitRoom(&me->segment->responses, SHM_POLL_INTERVAL);	// Client is not consuming responses, wait for it
+
+		if(admitted == 0)							// Refused requests are not measured, like BUSY on sockets
+			continue;
+
+		timing.completed = GetTimeNs();
+		RecordRequest(request.type, &timing);
+		LogRequest(me->id, &request, &response, &timing);
 	}
 
 	return NULL;
 }
 
 
-// Callback function for SIG_INT
-void SigIntHandler(int dummy)
+// Stops workers, closes sockets, prints statistics and deallocates all server's data
+void CleanUp()
 {
-	DestroyWorkers(MAX_CLIENT_NUM, MAX_CLIENT_NUM, MAX_CLIENT_NUM, MAX_CLIENT_NUM);
-	close(serverSock);
+	for(int i = 0; i < MAX_CONNECTIONS; i++)			// Threads of shared memory clients use phonebook lock and log requests, join them
+		DetachShmClient(&connections[i]);			// before workers' resources (locks included) are destroyed
+
+	DestroyWorkers(MAX_CLIENT_NUM);
+	CloseSockets();
+	StopAccessLog();						// All producers have been joined, so log can be completed
+	CloseTraceWriter(&traceWriter);
+	printf("Admission control: %lu requests refused because queue was full, %lu because client exceeded its rate, %lu expired in queue\n",
+		admissionStats.queueFull, (unsigned long) atomic_load(&admissionStats.rateLimited), (unsigned long) atomic_load(&admissionStats.expired));
+	PrintCacheStats(responseCache);
+	DestroySessions();
+	DestroyResponseCache(&responseCache);
 	DestroyPhonebook(&pb);
-	exit(0);
+}
+
+
+// Callback function for SIG_INT, main thread leaves its loop and cleans up (nothing else is async-signal-safe)
+void SigIntHandler(int dummy)
+{
+	(void) dummy;
+	serverRunning = 0;
 }
 
 
@@ -4,6 +4,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <math.h>
+#include <signal.h>
 
 #include <unistd.h>
 #include <pthread.h>
@@ -11,26 +13,65 @@
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <netdb.h>
+#include <sys/resource.h>
 
 #include "Constants.h"
 #include "Utility.h"
+#include "ServerLink.h"
 #include "Packet.h"
+#include "LoadGenerator.h"
+#include "Results.h"
 
 typedef struct _Tester {
 	pthread_t tid;			// Id of the thread used to simulate 
-	int sock;			// Socket used by tester to communicate
+	ServerLink_t link;		// Connection used by tester to communicate
 	Packet_t request;		// Request that tester will send to server
 	Packet_t response;		// Response that tester will receive from server
+	uint64_t latency;		// Time (ns) between first request sent and last response received (retries included)
 } Tester_t;
 
+typedef enum { SOAK_THROUGHPUT, SOAK_P50, SOAK_P99, SOAK_P999, SOAK_RSS, SOAK_HEAP, SOAK_HEAP_FREE, SOAK_FILE, SOAK_NODES, SOAK_HEIGHT,
+	SOAK_SERIES } SoakSeries_t;
+
+typedef struct _Soak {
+	ServerLink_t link;		// Connection used to sample the server, separated from the load
+	uint64_t sessionToken;		// Session used to query server stats
+	int period;			// Seconds between samples
+	int samplesNum;			// Number of samples taken
+	int maxSamples;			// Number of samples that fit in series
+	double* elapsed;		// Time (s) since start of the load of each sample
+	double* series[SOAK_SERIES];	// Values of each sample, indexed by SoakSeries_t
+	Histogram_t previous;		// Latency histogram of the load at the previous sample
+	Histogram_t delta;		// Latency recorded since the previous sample
+	uint64_t answered;		// Responses received at the previous sample
+	uint64_t failed;		// Requests refused or failed at the previous sample
+} Soak_t;
 
-int InitializeSocket(int* sock, struct sockaddr_in* addr);
-int GetAddressStruct(const char* ipAddress, const char* portNum, struct sockaddr_in* addr);
 
 int InitializeTesters(Tester_t** testers, int threadNum, int getReqNum, int addReqNum, int removeReqNum);
 void DestroyTesters(Tester_t** testers, int testerNum);
 void* SimulateRequest(void* index);
 void PrintResults(Tester_t* tester, int testerNum);
+int WriteTesterResults(Tester_t* testers, int testerNum, const char* filename);
+uint64_t Login(ServerLink_t* link);
+int RunLatencyComparison(int requestsNum);
+int MeasureLatency(Transport_t transport, int requestsNum, uint64_t* samples);
+int CompareSamples(const void* a, const void* b);
+int RunLoad(int argc, char* argv[]);
+int RunSweep(int argc, char* argv[]);
+int RunReplay(int argc, char* argv[]);
+int ParseLoadOptions(LoadConfig_t* config, int argc, char* argv[], char** output);
+int SeedKeys(LoadConfig_t* config);
+int AddLoadMetrics(Results_t* results, const char* prefix, LoadStats_t* stats, Histogram_t* latency);
+int WriteLoadResults(const char* mode, LoadConfig_t* config, LoadStats_t* stats, const char* filename);
+int RunCompare(int argc, char* argv[]);
+int RunSoak(int argc, char* argv[]);
+int QueryServerStats(ServerLink_t* link, uint64_t sessionToken, const char* selector, char* buff);
+void SampleServer(ServerLink_t* link, uint64_t sessionToken, double* sample);
+void PrintDrift(double* series[SOAK_SERIES], double* elapsed, int samplesNum);
+int WriteSoakResults(LoadConfig_t* config, int seconds, double* series[SOAK_SERIES], int samplesNum, const char* filename);
+int SampleSoak(LoadStats_t* stats, void* arg);
+void StopSoak(int dummy);
 
 
 // Array of strings that will be used when simulating GET_CONTACT requests
@@ -43,14 +84,57 @@ char* toAdd[] = { "Max", "Riccardo", "Laura", "Andrea" };
 char* toRemove[] = { "Ugo", "Federico", "Alessandra", "Miriam"};
 
 Tester_t* testers = NULL;		// Array of Tester_t structs
-struct sockaddr_in serverAddr;		// Struct that contains server's address
+Transport_t transport = UDP_TRANSPORT;	// Transport used by testers to communicate with the server
+uint64_t sessionToken = 0;		// Token of the session opened as DEFAULT_ADMIN_NAME, shared by all testers
 sem_t startSem;				// Semaphore to enable begin of simulation
+const char* transportNames[] = { "udp", "tcp", "unix", "shm" };	// Names of transports, indexed by Transport_t
+volatile sig_atomic_t soakStopped = 0;	// Set by SIGINT to end a soak run at the next sample
+
+// Names and units of the series sampled by soak mode, indexed by SoakSeries_t
+const char* soakNames[SOAK_SERIES] = { "throughput", "latency_p50", "latency_p99", "latency_p999", "rss", "heap", "heap_free", "data_file",
+	"nodes", "height" };
+const char* soakUnits[SOAK_SERIES] = { "req/s", "us", "us", "us", "kB", "kB", "kB", "kB", "nodes", "nodes" };
 
 int main(int argc, char* argv[])
 {
-	if(argc != 4)
+	if(argc == 3 && strcmp(argv[1], "latency") == 0)	// Compare round trip time of the transports supported by the server
+		return RunLatencyComparison((int) strtol(argv[2], NULL, 10)) == 1 ? 0 : -1;
+
+	if(argc >= 4 && strcmp(argv[1], "load") == 0)	// Send open-loop load at a fixed rate
+		return RunLoad(argc, argv) == 1 ? 0 : -1;
+
+	if(argc >= 3 && strcmp(argv[1], "replay") == 0)		// Replay a trace recorded by the server
+		return RunReplay(argc, argv) == 1 ? 0 : -1;
+
+	if(argc >= 3 && strcmp(argv[1], "sweep") == 0)	// Measure closed-loop throughput and latency as clients grow
+		return RunSweep(argc, argv) == 1 ? 0 : -1;
+
+	if(argc >= 5 && strcmp(argv[1], "soak") == 0)		// Send open-loop load for hours and track how server changes over time
+		return RunSoak(argc, argv) == 1 ? 0 : -1;
+
+	if(argc >= 4 && strcmp(argv[1], "compare") == 0)	// Compare results of two runs, exit status is 1 if there are regressions
+		return RunCompare(argc, argv);
+
+	char* outputFilename = NULL;
+	if(argc >= 6 && strcmp(argv[argc - 2], "-o") == 0)	// Results are written as JSON if -o is given after the other arguments
+	{
+		outputFilename = argv[argc - 1];
+		argc -= 2;
+	}
+
+	if((argc != 4 && argc != 5) || (argc == 5 && ParseTransport(argv[4], &transport) == 0))
 	{
-		fprintf(stderr, "usage is: %s <get request num> <add request num> <remove request num>\n", argv[0]);
+		fprintf(stderr, "usage is: %s <get request num> <add request num> <remove request num> [udp|tcp|unix|shm] [-o results.json]\n", argv[0]);
+		fprintf(stderr, "      or: %s latency <request num>\n", argv[0]);
+		fprintf(stderr, "      or: %s load <requests per second> <seconds> [load options] [-o results.json]\n", argv[0]);
+		fprintf(stderr, "      or: %s sweep <seconds per step> [load options] [-o output.csv|results.json]\n", argv[0]);
+		fprintf(stderr, "      or: %s soak <requests per second> <seconds> <seconds per sample> [load options] [-o results.json]\n", argv[0]);
+		fprintf(stderr, "      or: %s replay <trace file> [-p <speed>] [-s <sockets>] [-t <udp|tcp|unix|shm>] [-f <phonebook file>] [-o results.json]\n", argv[0]);
+		fprintf(stderr, "          (names of anonymized traces are mapped onto the contacts of the -f file, without it every lookup misses)\n");
+		fprintf(stderr, "      or: %s compare <baseline.json> <candidate.json> [-t <threshold %%>] [-c <confidence %%>]\n", argv[0]);
+		fprintf(stderr, "load options: -s <sockets (max clients in sweep)> -m <get/add/remove mix> -t <udp|tcp|unix|shm>\n");
+		fprintf(stderr, "              -k <uniform|zipf[:s]|hotspot[:fraction[:probability]]|latest[:s]> -f <phonebook file> -x <miss ratio>\n");
+		fprintf(stderr, "              (without -f the synthetic keys Load0, Load1, ... are added to the phonebook before the load starts)\n");
 		exit(-1);
 	}
 
@@ -67,7 +151,13 @@ int main(int argc, char* argv[])
 		exit(-1);
 	}
 
-	if(GetAddressStruct(SERVER_ADDRESS, SERVER_PORT_NUM, &serverAddr) == 0)		// Fill serverAddr struct
+	ServerLink_t loginLink;					// Login once, all testers use the same session
+	if(OpenServerLink(&loginLink, transport, SERVER_ADDRESS, SERVER_PORT_NUM) == 0)
+		exit(-1);
+
+	sessionToken = Login(&loginLink);
+	CloseServerLink(&loginLink);
+	if(sessionToken == 0)
 		exit(-1);
 
 	// Allocate and initialize an array of testers
@@ -83,57 +173,10 @@ int main(int argc, char* argv[])
 		pthread_join(testers[i].tid, NULL);
 
 	PrintResults(testers, testersNum);			// Print results of all testers
-	DestroyTesters(&testers, testersNum);
-	return 0;
-}
-
-
-// Retrives server's address and fills the struct given with it
-int GetAddressStruct(const char* ipAddress, const char* portNum, struct sockaddr_in* addr)
-{
-	if(ipAddress == NULL || portNum == NULL || addr == NULL)
-	{
-		return 0;
-	}
+	int result = outputFilename == NULL || WriteTesterResults(testers, testersNum, outputFilename) == 1;
 
-	struct addrinfo addrHints;						// Set properties that server's address should have
-	struct addrinfo* serverAddress;
-	memset(&addrHints, 0, sizeof(struct addrinfo));
-	addrHints.ai_family = AF_INET;
-	addrHints.ai_protocol = 0;
-	addrHints.ai_socktype = SOCK_DGRAM;
-	addrHints.ai_flags = 0;
-
-	if(getaddrinfo(ipAddress, portNum, &addrHints, &serverAddress) != 0)	// Try to get server's address
-	{
-		fprintf(stderr, "Error: getaddrinfo() failed, cannot retrive server's address...\n");
-		return 0;
-	}
-
-	memcpy(addr, serverAddress->ai_addr, sizeof(struct sockaddr_in));
-	return 1;
-}
-
-
-// Creates a new socket for UDP communication
-int InitializeSocket(int* sock, struct sockaddr_in* addr)
-{
-	if(*sock != -1 || addr == NULL)
-		return 0;
-
-	*sock = socket(addr->sin_family, SOCK_DGRAM, 0);
-	if(*sock == -1)
-	{
-		fprintf(stderr, "Error: cannot create socket for tester...\n");
-		printf("WHY: %s\n", strerror(errno));
-		return 0;
-	}
-
-	struct timeval timeout;					// Set timeout of 10 second for receive operations
-	timeout.tv_sec = 10;
-
-	setsockopt(*sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(struct timeval)); 
-	return 1;
+	DestroyTesters(&testers, testersNum);
+	return result == 1 ? 0 : -1;
 }
 
 
@@ -169,18 +212,20 @@ int InitializeTesters(Tester_t** testers, int testerNum, int getReqNum, int addR
 		Tester_t* curr = &( (*testers)[i] );
 		memset(&curr->request, 0, sizeof(Packet_t));			// Set request and response packet to default value
 		memset(&curr->response, 0, sizeof(Packet_t));
-		curr->sock = -1;
-		strncpy(curr->request.clientName, "admin", MAX_NAME_SIZE);	// Set clientName in request as "admin" so that it has all permissions
+		curr->latency = 0;
+		curr->link.sock = -1;
+		curr->request.requestId = i + 1;
+		curr->request.sessionToken = sessionToken;			// Session of DEFAULT_ADMIN_NAME has all permissions
+		strncpy(curr->request.clientName, DEFAULT_ADMIN_NAME, MAX_NAME_SIZE);
 		
-		if(InitializeSocket(&curr->sock, &serverAddr) == 0)	// Create a socket
+		if(OpenServerLink(&curr->link, transport, SERVER_ADDRESS, SERVER_PORT_NUM) == 0)	// Create a socket connected to server
 		{
 			for(int j = 0; j < i; j++)			// If create socket fails 
 			{
 				curr = &( (*testers)[j]);
 				pthread_cancel(curr->tid);		// Quit all threads previously launched
 
-				if(curr->sock != -1)
-					close(curr->sock);		// Close all sockets previously opened
+				CloseServerLink(&curr->link);		// Close all sockets previously opened
 			}
 
 			free(*testers);
@@ -198,7 +243,7 @@ int InitializeTesters(Tester_t** testers, int testerNum, int getReqNum, int addR
 				if(j < i)
 					pthread_cancel(curr->tid);		// Quit all threads previously launched
 
-				close(curr->sock);			// Close all sockets previously opened
+				CloseServerLink(&curr->link);		// Close all sockets previously opened
 			}
 
 			free(*testers);
@@ -261,8 +306,7 @@ void DestroyTesters(Tester_t** testers, int testerNum)
 	{
 		Tester_t* curr = &( (*testers)[i] );
 
-		if(curr->sock != -1)
-			close(curr->sock);
+		CloseServerLink(&curr->link);
 	}
 
 	free(*testers);
@@ -277,16 +321,28 @@ void* SimulateRequest(void* tester)
 	Tester_t* me = (Tester_t*) tester;
 	sem_wait(&startSem);					// Wait main thread to enable simulation
 
-	if(SendPacket(me->sock, &me->request, &serverAddr, sizeof(serverAddr)) == 0)
+	useconds_t backoff = BUSY_BACKOFF;
+	uint64_t start = GetTimeNs();
+	for(int attempt = 0; attempt <= BUSY_RETRIES; attempt++)
 	{
-		snprintf(me->response.name, MAX_NAME_SIZE, "Thread has failed to send request...\n");
-		return NULL;
-	}
+		if(SendToServer(&me->link, &me->request) == 0)
+		{
+			snprintf(me->response.name, MAX_NAME_SIZE, "Thread has failed to send request...\n");
+			return NULL;
+		}
 
-	if(ReceivePacket(me->sock, &me->response) == 0)		// Try to receive a response
-	{
-		snprintf(me->response.name, MAX_NAME_SIZE, "Thread has failed to receive response...\n");
-		return NULL;
+		if(ReceiveFromServer(&me->link, &me->response) == 0)	// Try to receive a response
+		{
+			snprintf(me->response.name, MAX_NAME_SIZE, "Thread has failed to receive response...\n");
+			return NULL;
+		}
+
+		me->latency = GetTimeNs() - start;
+		if(me->response.type != BUSY)			// If server was busy retry later
+			break;
+
+		usleep(backoff);
+		backoff *= 2;
 	}
 
 	return NULL;
@@ -322,3 +378,969 @@ void PrintResults(Tester_t* testers, int testerNum)
 	}
 }
 
+
+// Writes results of all testers on file filename as JSON (latency of each tester is a sample), returns 0 on failure
+int WriteTesterResults(Tester_t* testers, int testerNum, const char* filename)
+{
+	char description[128];
+	snprintf(description, sizeof(description), "%d testers on %s", testerNum, transportNames[transport]);
+
+	Results_t* results = CreateResults("tester", "basic", description);
+	double* samples = malloc(sizeof(double) * testerNum);
+	if(results == NULL || samples == NULL)
+	{
+		fprintf(stderr, "Error: cannot allocate results...\n");
+		DestroyResults(&results);
+		free(samples);
+		return 0;
+	}
+
+	int answered = 0;
+	double counts[4] = { 0 };					// Responses accepted, rejected, busy and failed
+	for(int i = 0; i < testerNum; i++)
+	{
+		if(testers[i].response.type == ACCEPTED)
+			counts[0]++;
+		else if(testers[i].response.type == REJECTED)
+			counts[1]++;
+		else if(testers[i].response.type == BUSY)
+			counts[2]++;
+		else
+		{
+			counts[3]++;
+			continue;
+		}
+
+		samples[answered++] = testers[i].latency / 1000.0;
+	}
+
+	double sum = 0;
+	for(int i = 0; i < answered; i++)
+		sum += samples[i];
+
+	int result = AddMetric(results, "latency_mean", "us", 0, answered > 0 ? sum / answered : 0, samples, answered) &&
+		AddMetric(results, "accepted", "requests", 1, counts[0], NULL, 0) && AddMetric(results, "rejected", "requests", 0, counts[1], NULL, 0) &&
+		AddMetric(results, "busy", "requests", 0, counts[2], NULL, 0) && AddMetric(results, "errors", "requests", 0, counts[3], NULL, 0) &&
+		WriteResults(results, filename);
+
+	free(samples);
+	DestroyResults(&results);
+	return result;
+}
+
+
+// Logs in as DEFAULT_ADMIN_NAME using link, returns the session token or 0 on failure
+uint64_t Login(ServerLink_t* link)
+{
+	Packet_t request;
+	Packet_t response;
+	memset(&request, 0, sizeof(Packet_t));
+
+	request.type = LOGIN;
+	request.requestId = 1;
+	strncpy(request.clientName, DEFAULT_ADMIN_NAME, MAX_NAME_SIZE);
+	strncpy(request.name, DEFAULT_ADMIN_NAME, MAX_NAME_SIZE);
+	strncpy(request.number, DEFAULT_ADMIN_PASSWORD, MAX_PASSWORD_SIZE);
+
+	if(SendToServer(link, &request) == 0 || ReceiveFromServer(link, &response) == 0)
+	{
+		fprintf(stderr, "Error: cannot login as %s...\n", DEFAULT_ADMIN_NAME);
+		return 0;
+	}
+
+	if(response.type != ACCEPTED)
+	{
+		fprintf(stderr, "Error: login as %s failed: %s\n", DEFAULT_ADMIN_NAME, response.name);
+		return 0;
+	}
+
+	return response.sessionToken;
+}
+
+
+// Sends requestsNum GET_CONTACT requests, one at a time, on each transport supported by the server and prints their round trip time
+int RunLatencyComparison(int requestsNum)
+{
+	if(requestsNum <= 0)
+	{
+		fprintf(stderr, "Error: number of requests must be positive\n");
+		return 0;
+	}
+
+	uint64_t* samples = malloc(sizeof(uint64_t) * requestsNum);
+	if(samples == NULL)
+	{
+		fprintf(stderr, "Error: cannot allocate array of samples...\n");
+		return 0;
+	}
+
+	Transport_t transports[] = { UDP_TRANSPORT, TCP_TRANSPORT, UNIX_TRANSPORT, SHM_TRANSPORT };
+
+	printf("Round trip time of %d GET_CONTACT requests (microseconds)\n", requestsNum);
+	printf("%-10s %10s %10s %10s %10s %10s\n", "transport", "min", "avg", "p50", "p99", "max");
+
+	for(size_t t = 0; t < sizeof(transports) / sizeof(Transport_t); t++)
+	{
+		int measured = MeasureLatency(transports[t], requestsNum, samples);
+		if(measured == 0)
+		{
+			printf("%-10s %10s\n", transportNames[t], "failed");
+			continue;
+		}
+
+		qsort(samples, measured, sizeof(uint64_t), CompareSamples);
+
+		uint64_t sum = 0;
+		for(int i = 0; i < measured; i++)
+			sum += samples[i];
+
+		printf("%-10s %10.1f %10.1f %10.1f %10.1f %10.1f\n", transportNames[t], samples[0] / 1000.0, (sum / (double) measured) / 1000.0,
+			samples[measured / 2] / 1000.0, samples[(int)(measured * 0.99)] / 1000.0, samples[measured - 1] / 1000.0);
+	}
+
+	free(samples);
+	return 1;
+}
+
+
+// Measures round trip time of requestsNum requests sent on transport (after a short warmup), returns number of samples stored
+int MeasureLatency(Transport_t transport, int requestsNum, uint64_t* samples)
+{
+	ServerLink_t link;
+	if(OpenServerLink(&link, transport, SERVER_ADDRESS, SERVER_PORT_NUM) == 0)
+		return 0;
+
+	Packet_t request;
+	Packet_t response;
+	memset(&request, 0, sizeof(Packet_t));
+	request.type = GET_CONTACT;
+	request.sessionToken = Login(&link);
+	strncpy(request.clientName, DEFAULT_ADMIN_NAME, MAX_NAME_SIZE);
+
+	if(request.sessionToken == 0)
+	{
+		CloseServerLink(&link);
+		return 0;
+	}
+	strncpy(request.name, "LatencyProbe", MAX_NAME_SIZE);
+
+	int warmup = requestsNum / 10 < 100 ? requestsNum / 10 : 100;	// First requests are not measured (they warm up caches and connection)
+	int measured = 0;
+
+	for(int i = 0; i < warmup + requestsNum; i++)
+	{
+		request.requestId = i + 1;
+		uint64_t start = GetTimeNs();
+
+		if(SendToServer(&link, &request) == 0 || ReceiveFromServer(&link, &response) == 0 || response.requestId != request.requestId)
+			break;
+
+		if(i >= warmup)
+			samples[measured++] = GetTimeNs() - start;
+	}
+
+	CloseServerLink(&link);
+	return measured;
+}
+
+
+// Compares two samples, used by qsort()
+int CompareSamples(const void* a, const void* b)
+{
+	uint64_t first = *(const uint64_t*) a;
+	uint64_t second = *(const uint64_t*) b;
+	return (first > second) - (first < second);
+}
+
+
+// Parses arguments of load mode (tester load <rate> <seconds> [options]), logs in and sends open-loop load
+int RunLoad(int argc, char* argv[])
+{
+	LoadConfig_t config;
+	memset(&config, 0, sizeof(LoadConfig_t));
+	config.rate = strtod(argv[2], NULL);
+	config.duration = (int) strtol(argv[3], NULL, 10);
+	config.socketsNum = DEFAULT_LOAD_SOCKETS;
+	char* outputFilename = NULL;
+
+	optind = 4;
+	if(ParseLoadOptions(&config, argc, argv, &outputFilename) == 0)
+		return 0;
+
+	if(SeedKeys(&config) == 0)
+	{
+		DestroyWorkload(&config.workload);
+		return 0;
+	}
+
+	LoadStats_t* stats = malloc(sizeof(LoadStats_t));
+	if(stats == NULL)
+	{
+		fprintf(stderr, "Error: cannot allocate load statistics...\n");
+		DestroyWorkload(&config.workload);
+		return 0;
+	}
+
+	int result = RunOpenLoop(&config, stats);
+	if(result == 1)
+	{
+		PrintLoadStats(&config, stats);
+		if(outputFilename != NULL)
+			result = WriteLoadResults("load", &config, stats, outputFilename);
+	}
+
+	free(stats);
+	DestroyWorkload(&config.workload);
+	return result;
+}
+
+
+// Parses options of load modes starting from argv[optind] (-s sockets, -m get/add/remove mix, -t transport, -k key distribution,
+// -f phonebook file with keys, -x miss ratio, -p replay speed and, if output is not NULL, -o output file), then creates the workload
+// and logs in
+int ParseLoadOptions(LoadConfig_t* config, int argc, char* argv[], char** output)
+{
+	config->mix[0] = 80;					// By default mostly reads, like a real phonebook
+	config->mix[1] = 10;
+	config->mix[2] = 10;
+	config->transport = UDP_TRANSPORT;
+	config->speed = 1.0;
+
+	char* distribution = "uniform";
+	char* keysFilename = NULL;
+	double missRatio = 0;
+
+	int option;
+	while((option = getopt(argc, argv, "s:m:t:k:f:x:p:o:")) != -1)
+	{
+		switch(option)
+		{
+			case 's':
+				config->socketsNum = (int) strtol(optarg, NULL, 10);
+				break;
+
+			case 'm':
+				if(sscanf(optarg, "%d/%d/%d", &config->mix[0], &config->mix[1], &config->mix[2]) != 3)
+				{
+					fprintf(stderr, "Error: mix must be given as <get>/<add>/<remove> (e.g. 80/10/10)\n");
+					return 0;
+				}
+				break;
+
+			case 't':
+				if(ParseTransport(optarg, &config->transport) == 0)
+					return 0;
+				break;
+
+			case 'k':
+				distribution = optarg;
+				break;
+
+			case 'f':
+				keysFilename = optarg;
+				break;
+
+			case 'x':
+				missRatio = strtod(optarg, NULL);
+				break;
+
+			case 'p':
+				config->speed = strtod(optarg, NULL);
+				if(config->speed <= 0)
+				{
+					fprintf(stderr, "Error: replay speed must be positive\n");
+					return 0;
+				}
+				break;
+
+			case 'o':
+				if(output == NULL)
+					return 0;
+				*output = optarg;
+				break;
+
+			default:
+				return 0;
+		}
+	}
+
+	config->workload = CreateWorkload(keysFilename, distribution, missRatio);
+	if(config->workload == NULL)
+		return 0;
+
+	ServerLink_t loginLink;
+	if(OpenServerLink(&loginLink, config->transport, SERVER_ADDRESS, SERVER_PORT_NUM) == 1)
+	{
+		config->sessionToken = Login(&loginLink);
+		CloseServerLink(&loginLink);
+	}
+
+	if(config->sessionToken == 0)
+	{
+		DestroyWorkload(&config->workload);
+		return 0;
+	}
+
+	return 1;
+}
+
+
+// Adds the synthetic keys of the workload to the phonebook when no phonebook file is given, otherwise lookups (and the latest
+// distribution) would only find the keys added by the load itself. Keys are sent in windows of MAX_WRITE_BATCH requests, so that the
+// server writes each window in a single batch, and a window is sent again if some of its requests are refused because the server is busy
+// (keys that already exist are rejected), returns 0 on failure
+int SeedKeys(LoadConfig_t* config)
+{
+	Workload_t* workload = config->workload;
+	if(workload->keys != NULL)				// Keys of a phonebook file are already in the phonebook
+		return 1;
+
+	ServerLink_t link;
+	if(OpenServerLink(&link, config->transport, SERVER_ADDRESS, SERVER_PORT_NUM) == 0)
+		return 0;
+
+	Packet_t request;
+	Packet_t response;
+	memset(&request, 0, sizeof(Packet_t));
+	request.type = ADD_CONTACT;
+	request.sessionToken = config->sessionToken;
+	strncpy(request.clientName, DEFAULT_ADMIN_NAME, MAX_NAME_SIZE);
+
+	size_t next = 0;					// First key of the window
+	useconds_t backoff = BUSY_BACKOFF;
+	int attempt = 0;
+	while(next < workload->loadedNum)
+	{
+		size_t windowNum = workload->loadedNum - next < MAX_WRITE_BATCH ? workload->loadedNum - next : MAX_WRITE_BATCH;
+		size_t sent = 0;
+		int busy = 0;
+
+		for(; sent < windowNum; sent++)
+		{
+			request.requestId = (uint32_t)(next + sent) + 1;
+			GetKeyName(workload, next + sent, request.name);
+			snprintf(request.number, MAX_PHONE_NUM_SIZE, "%010lu", (unsigned long)(next + sent));
+			if(SendToServer(&link, &request) == 0)
+				break;
+		}
+
+		for(size_t i = 0; i < sent; i++)		// Wait all responses of the window, even if a send failed
+		{
+			if(ReceiveFromServer(&link, &response) == 0)
+			{
+				sent = 0;
+				break;
+			}
+
+			busy |= response.type == BUSY;
+		}
+
+		if(sent != windowNum || (busy == 1 && attempt == BUSY_RETRIES))
+		{
+			fprintf(stderr, "Error: cannot add synthetic keys to the phonebook...\n");
+			CloseServerLink(&link);
+			return 0;
+		}
+
+		if(busy == 1)					// Send the same window again
+		{
+			usleep(backoff);
+			backoff *= 2;
+			attempt++;
+			continue;
+		}
+
+		next += windowNum;
+		backoff = BUSY_BACKOFF;
+		attempt = 0;
+	}
+
+	CloseServerLink(&link);
+	return 1;
+}
+
+
+// Runs closed-loop load with 1, 2, 4, ... up to max clients (tester sweep <seconds> [options], -s sets max clients), prints throughput
+// and latency of each step and, if an output file is given, writes them as results (if its name ends with .json) or CSV
+int RunSweep(int argc, char* argv[])
+{
+	LoadConfig_t config;
+	memset(&config, 0, sizeof(LoadConfig_t));
+	config.duration = (int) strtol(argv[2], NULL, 10);
+	config.socketsNum = DEFAULT_SWEEP_CLIENTS;
+	char* outputFilename = NULL;
+
+	optind = 3;
+	if(ParseLoadOptions(&config, argc, argv, &outputFilename) == 0)
+		return 0;
+
+	if(SeedKeys(&config) == 0)
+	{
+		DestroyWorkload(&config.workload);
+		return 0;
+	}
+
+	int maxClients = config.socketsNum;
+	if(maxClients <= 0)
+	{
+		fprintf(stderr, "Error: max number of clients must be positive\n");
+		DestroyWorkload(&config.workload);
+		return 0;
+	}
+
+	if(config.transport != UDP_TRANSPORT && maxClients > MAX_CONNECTIONS)	// Server refuses connections beyond MAX_CONNECTIONS
+	{
+		fprintf(stderr, "Warning: server accepts at most %d %s connections, sweep stops at %d clients\n", MAX_CONNECTIONS,
+			transportNames[config.transport], MAX_CONNECTIONS);
+		maxClients = MAX_CONNECTIONS;
+	}
+
+	char workload[128];
+	char description[256];
+	FormatWorkload(config.workload, workload, sizeof(workload));
+	snprintf(description, sizeof(description), "closed loop up to %d clients, %d s per step, %s, mix %d/%d/%d, %s", maxClients,
+		config.duration, transportNames[config.transport], config.mix[0], config.mix[1], config.mix[2], workload);
+
+	FILE* output = NULL;
+	Results_t* results = NULL;
+	if(outputFilename != NULL)
+	{
+		size_t length = strlen(outputFilename);
+		if(length >= 5 && strcmp(outputFilename + length - 5, ".json") == 0)
+			results = CreateResults("tester", "sweep", description);
+		else if((output = fopen(outputFilename, "w")) != NULL)
+			fprintf(output, "clients,throughput,p50_us,p99_us,busy,errors,timeouts\n");
+		else
+			fprintf(stderr, "Error: cannot open %s: %s\n", outputFilename, strerror(errno));
+
+		if(output == NULL && results == NULL)
+		{
+			DestroyWorkload(&config.workload);
+			return 0;
+		}
+	}
+
+	struct rlimit files;					// Every client has its own socket, use as many descriptors as allowed
+	if(getrlimit(RLIMIT_NOFILE, &files) == 0 && files.rlim_cur < files.rlim_max)
+	{
+		files.rlim_cur = files.rlim_max;
+		setrlimit(RLIMIT_NOFILE, &files);
+	}
+
+	LoadStats_t* stats = malloc(sizeof(LoadStats_t));
+	if(stats == NULL)
+	{
+		fprintf(stderr, "Error: cannot allocate load statistics...\n");
+		if(output != NULL)
+			fclose(output);
+		DestroyResults(&results);
+		DestroyWorkload(&config.workload);
+		return 0;
+	}
+
+	printf("Closed-loop sweep, %d s per step (mix get/add/remove %d/%d/%d, %s)\n", config.duration, config.mix[0], config.mix[1],
+		config.mix[2], workload);
+	printf("%8s %12s %10s %10s %8s %8s %8s\n", "clients", "req/s", "p50(us)", "p99(us)", "busy", "errors", "timeouts");
+
+	int result = 1;
+	for(int clients = 1; clients <= maxClients; clients *= 2)
+	{
+		config.socketsNum = clients;
+		if(RunClosedLoop(&config, stats) == 0)
+		{
+			result = 0;
+			break;
+		}
+
+		uint64_t answered = atomic_load(&stats->accepted) + atomic_load(&stats->rejected) + atomic_load(&stats->busy);
+		double throughput = answered / (stats->elapsedNs / 1000000000.0);
+		double p50 = GetPercentile(&stats->uncorrected, 50.0) / 1000.0;
+		double p99 = GetPercentile(&stats->uncorrected, 99.0) / 1000.0;
+		unsigned long busy = (unsigned long) atomic_load(&stats->busy);
+		unsigned long errors = (unsigned long) atomic_load(&stats->errors);
+		unsigned long timeouts = (unsigned long) atomic_load(&stats->timeouts);
+
+		printf("%8d %12.0f %10.1f %10.1f %8lu %8lu %8lu\n", clients, throughput, p50, p99, busy, errors, timeouts);
+		fflush(stdout);
+
+		if(output != NULL)
+			fprintf(output, "%d,%.1f,%.1f,%.1f,%lu,%lu,%lu\n", clients, throughput, p50, p99, busy, errors, timeouts);
+
+		char prefix[32];
+		snprintf(prefix, sizeof(prefix), "clients_%d/", clients);
+		if(results != NULL && AddLoadMetrics(results, prefix, stats, &stats->uncorrected) == 0)
+		{
+			result = 0;
+			break;
+		}
+	}
+
+	if(output != NULL)
+		fclose(output);
+
+	if(results != NULL && WriteResults(results, outputFilename) == 0)
+		result = 0;
+
+	DestroyResults(&results);
+	free(stats);
+	DestroyWorkload(&config.workload);
+	return result;
+}
+
+
+// Replays the requests of a trace recorded by the server (tester replay <trace file> [options]) keeping their original timing, or
+// speed times faster, and prints latency distribution. Anonymized names are mapped onto the keys of the phonebook file given with -f
+int RunReplay(int argc, char* argv[])
+{
+	LoadConfig_t config;
+	memset(&config, 0, sizeof(LoadConfig_t));
+	config.socketsNum = DEFAULT_LOAD_SOCKETS;
+	char* outputFilename = NULL;
+
+	optind = 3;
+	if(ParseLoadOptions(&config, argc, argv, &outputFilename) == 0)
+		return 0;
+
+	uint8_t flags = 0;
+	config.trace = LoadTrace(argv[2], &config.traceLength, &flags);
+	if(config.trace == NULL)
+	{
+		DestroyWorkload(&config.workload);
+		return 0;
+	}
+
+	if(config.traceLength > 0)
+	{
+		double seconds = (config.trace[config.traceLength - 1].arrivalNs - config.trace[0].arrivalNs) / 1000000000.0;
+		printf("Trace %s: %lu requests in %.1f s%s\n", argv[2], (unsigned long) config.traceLength, seconds,
+			(flags & TRACE_ANONYMIZED) != 0 ? " (names are anonymized)" : "");
+	}
+
+	if((flags & TRACE_ANONYMIZED) != 0 && config.workload->keys == NULL)	// Hashed names are not in the phonebook
+		fprintf(stderr, "Warning: names of the trace are anonymized and no phonebook file was given (-f), every lookup will miss\n");
+	else if((flags & TRACE_ANONYMIZED) != 0)
+	{
+		long mapped = MapTraceNames(config.trace, config.traceLength, config.workload->keys, config.workload->loadedNum);
+		if(mapped == -1)
+		{
+			free(config.trace);
+			DestroyWorkload(&config.workload);
+			return 0;
+		}
+
+		printf("Mapped %ld anonymized names onto %lu keys of the phonebook file%s\n", mapped, (unsigned long) config.workload->loadedNum,
+			(size_t) mapped > config.workload->loadedNum ? " (more names than keys, some share a key)" : "");
+	}
+
+	LoadStats_t* stats = malloc(sizeof(LoadStats_t));
+	int result = 0;
+
+	if(stats == NULL)
+		fprintf(stderr, "Error: cannot allocate load statistics...\n");
+	else if((result = RunOpenLoop(&config, stats)) == 1)
+	{
+		PrintLoadStats(&config, stats);
+		if(outputFilename != NULL)
+			result = WriteLoadResults("replay", &config, stats, outputFilename);
+	}
+
+	free(stats);
+	free(config.trace);
+	DestroyWorkload(&config.workload);
+	return result;
+}
+
+
+// Adds throughput, latency (from given histogram) and failures of a load run to results, with names that start with prefix (throughput
+// and latency percentiles of each second of the run are their samples), returns 0 on failure
+int AddLoadMetrics(Results_t* results, const char* prefix, LoadStats_t* stats, Histogram_t* latency)
+{
+	double samples[3][LOAD_MAX_INTERVALS];
+	for(int i = 0; i < stats->intervalsNum; i++)
+	{
+		samples[0][i] = stats->intervals[i].throughput;
+		samples[1][i] = stats->intervals[i].p50;
+		samples[2][i] = stats->intervals[i].p99;
+	}
+
+	uint64_t answered = atomic_load(&stats->accepted) + atomic_load(&stats->rejected) + atomic_load(&stats->busy);
+	double seconds = stats->elapsedNs / 1000000000.0;
+
+	char names[7][MAX_METRIC_NAME];
+	const char* suffixes[] = { "throughput", "latency_p50", "latency_p99", "latency_p999", "busy", "errors", "timeouts" };
+	for(int i = 0; i < 7; i++)
+		snprintf(names[i], MAX_METRIC_NAME, "%s%s", prefix, suffixes[i]);
+
+	return AddMetric(results, names[0], "req/s", 1, seconds > 0 ? answered / seconds : 0, samples[0], stats->intervalsNum) &&
+		AddMetric(results, names[1], "us", 0, GetPercentile(latency, 50.0) / 1000.0, samples[1], stats->intervalsNum) &&
+		AddMetric(results, names[2], "us", 0, GetPercentile(latency, 99.0) / 1000.0, samples[2], stats->intervalsNum) &&
+		AddMetric(results, names[3], "us", 0, GetPercentile(latency, 99.9) / 1000.0, NULL, 0) &&
+		AddMetric(results, names[4], "requests", 0, (double) atomic_load(&stats->busy), NULL, 0) &&
+		AddMetric(results, names[5], "requests", 0, (double) atomic_load(&stats->errors), NULL, 0) &&
+		AddMetric(results, names[6], "requests", 0, (double) atomic_load(&stats->timeouts), NULL, 0);
+}
+
+
+// Writes results of an open-loop run (latency is the corrected one) on file filename as JSON, returns 0 on failure
+int WriteLoadResults(const char* mode, LoadConfig_t* config, LoadStats_t* stats, const char* filename)
+{
+	char workload[128];
+	char description[256];
+
+	if(config->trace != NULL)
+		snprintf(description, sizeof(description), "%lu requests at %.2fx speed on %d sockets, %s", (unsigned long) config->traceLength,
+			config->speed, config->socketsNum, transportNames[config->transport]);
+	else
+	{
+		FormatWorkload(config->workload, workload, sizeof(workload));
+		snprintf(description, sizeof(description), "%.0f req/s for %d s on %d sockets, %s, mix %d/%d/%d, %s", config->rate, config->duration,
+			config->socketsNum, transportNames[config->transport], config->mix[0], config->mix[1], config->mix[2], workload);
+	}
+
+	Results_t* results = CreateResults("tester", mode, description);
+	if(results == NULL)
+		return 0;
+
+	int result = AddLoadMetrics(results, "", stats, &stats->corrected) && WriteResults(results, filename);
+	DestroyResults(&results);
+	return result;
+}
+
+
+// Compares the results of two runs (tester compare <baseline> <candidate> [-t threshold %] [-c confidence %]), returns the exit status
+// of the tester: 0 if no metric regressed, 1 if some did and -1 on failure
+int RunCompare(int argc, char* argv[])
+{
+	double threshold = DEFAULT_THRESHOLD;
+	double confidence = DEFAULT_CONFIDENCE;
+
+	int option;
+	optind = 4;
+	while((option = getopt(argc, argv, "t:c:")) != -1)
+	{
+		switch(option)
+		{
+			case 't':
+				threshold = strtod(optarg, NULL);
+				break;
+
+			case 'c':
+				confidence = strtod(optarg, NULL);
+				break;
+
+			default:
+				return -1;
+		}
+	}
+
+	if(threshold < 0 || confidence <= 0 || confidence >= 100)
+	{
+		fprintf(stderr, "Error: threshold must be positive and confidence between 0 and 100\n");
+		return -1;
+	}
+
+	Results_t* baseline = LoadResults(argv[2]);
+	Results_t* candidate = baseline != NULL ? LoadResults(argv[3]) : NULL;
+	int regressions = -1;
+
+	if(candidate != NULL)
+		regressions = CompareResults(baseline, candidate, threshold, confidence);
+
+	DestroyResults(&baseline);
+	DestroyResults(&candidate);
+	return regressions < 0 ? -1 : regressions > 0;
+}
+
+
+// Sends open-loop load for a long time (tester soak <rate> <seconds> <seconds per sample> [options]) as a single run; every sample
+// interval samples throughput, latency, server memory, data file size and index shape while load goes on, at the end reports how they
+// drifted. SIGINT ends the load at the next sample
+int RunSoak(int argc, char* argv[])
+{
+	LoadConfig_t config;
+	memset(&config, 0, sizeof(LoadConfig_t));
+	config.rate = strtod(argv[2], NULL);
+	config.duration = (int) strtol(argv[3], NULL, 10);
+	config.samplePeriod = (int) strtol(argv[4], NULL, 10);
+	config.socketsNum = DEFAULT_LOAD_SOCKETS;
+	char* outputFilename = NULL;
+
+	if(config.duration <= 0 || config.samplePeriod <= 0 || config.samplePeriod > config.duration)
+	{
+		fprintf(stderr, "Error: duration and sample interval must be positive, interval can't be longer than duration\n");
+		return 0;
+	}
+
+	optind = 5;
+	if(ParseLoadOptions(&config, argc, argv, &outputFilename) == 0)
+		return 0;
+
+	if(SeedKeys(&config) == 0)
+	{
+		DestroyWorkload(&config.workload);
+		return 0;
+	}
+
+	LoadStats_t* stats = malloc(sizeof(LoadStats_t));
+	Soak_t* soak = calloc(1, sizeof(Soak_t));
+	double* buffer = NULL;
+
+	if(stats != NULL && soak != NULL)
+	{
+		soak->period = config.samplePeriod;
+		soak->maxSamples = config.duration / config.samplePeriod;
+		soak->sessionToken = config.sessionToken;
+		buffer = malloc((size_t) soak->maxSamples * (SOAK_SERIES + 1) * sizeof(double));
+	}
+
+	if(buffer == NULL)
+	{
+		fprintf(stderr, "Error: cannot allocate soak statistics...\n");
+		free(stats);
+		free(soak);
+		DestroyWorkload(&config.workload);
+		return 0;
+	}
+
+	soak->elapsed = buffer;
+	for(int i = 0; i < SOAK_SERIES; i++)
+		soak->series[i] = buffer + (size_t)(i + 1) * soak->maxSamples;
+
+	if(OpenServerLink(&soak->link, UDP_TRANSPORT, SERVER_ADDRESS, SERVER_PORT_NUM) == 0)	// Samples are taken on a link of their own
+	{
+		free(stats);
+		free(soak);
+		free(buffer);
+		DestroyWorkload(&config.workload);
+		return 0;
+	}
+
+	struct sigaction intHandler;
+	memset(&intHandler, 0, sizeof(struct sigaction));
+	intHandler.sa_handler = StopSoak;
+	intHandler.sa_flags = SA_RESTART;			// Load threads must not see their calls fail with EINTR
+	sigaction(SIGINT, &intHandler, NULL);
+
+	config.sampler = SampleSoak;
+	config.samplerArg = soak;
+
+	printf("Soak: %.0f req/s for %d s, one sample every %d s (Ctrl-C stops at the next sample)\n\n", config.rate, config.duration,
+		config.samplePeriod);
+	printf("%8s %10s %10s %10s %10s %10s %10s %10s %10s %10s %8s %10s\n", "time(s)", "req/s", "p50(us)", "p99(us)", "p99.9(us)", "rss(kB)",
+		"heap(kB)", "free(kB)", "file(kB)", "nodes", "height", "failures");
+
+	int result = RunOpenLoop(&config, stats);
+	int samplesNum = soak->samplesNum;
+
+	if(samplesNum > 0)
+	{
+		uint64_t failures = atomic_load(&stats->busy) + atomic_load(&stats->errors) + atomic_load(&stats->timeouts);
+		printf("\n%d samples in %.0f s, %lu failed requests\n", samplesNum, soak->elapsed[samplesNum - 1], (unsigned long) failures);
+		PrintDrift(soak->series, soak->elapsed, samplesNum);
+		if(outputFilename != NULL && WriteSoakResults(&config, (int) soak->elapsed[samplesNum - 1], soak->series, samplesNum,
+			outputFilename) == 0)
+			result = 0;
+	}
+
+	CloseServerLink(&soak->link);
+	free(stats);
+	free(soak);
+	free(buffer);
+	DestroyWorkload(&config.workload);
+	return result;
+}
+
+
+// Sampler of a soak run, called by the load generator every sample interval: takes throughput and latency of the interval from stats
+// and samples the server, returns 0 to end the load if the run has been interrupted or series are full
+int SampleSoak(LoadStats_t* stats, void* arg)
+{
+	Soak_t* soak = (Soak_t*) arg;
+	if(soak->samplesNum == soak->maxSamples)
+		return 0;
+
+	int i = soak->samplesNum++;
+	uint64_t answered = atomic_load(&stats->accepted) + atomic_load(&stats->rejected) + atomic_load(&stats->busy);
+	uint64_t failed = atomic_load(&stats->busy) + atomic_load(&stats->errors);	// Timeouts are only known at the end of the load
+	GetHistogramDelta(&stats->corrected, &soak->previous, &soak->delta);
+
+	soak->elapsed[i] = (double)(i + 1) * soak->period;
+	soak->series[SOAK_THROUGHPUT][i] = (double)(answered - soak->answered) / soak->period;
+	soak->series[SOAK_P50][i] = GetPercentile(&soak->delta, 50.0) / 1000.0;
+	soak->series[SOAK_P99][i] = GetPercentile(&soak->delta, 99.0) / 1000.0;
+	soak->series[SOAK_P999][i] = GetPercentile(&soak->delta, 99.9) / 1000.0;
+
+	double sample[SOAK_SERIES];
+	SampleServer(&soak->link, soak->sessionToken, sample);
+	for(int j = SOAK_RSS; j < SOAK_SERIES; j++)
+		soak->series[j][i] = sample[j];
+
+	printf("%8.0f %10.1f %10.1f %10.1f %10.1f %10.0f %10.0f %10.0f %10.0f %10.0f %8.0f %10lu\n", soak->elapsed[i],
+		soak->series[SOAK_THROUGHPUT][i], soak->series[SOAK_P50][i], soak->series[SOAK_P99][i], soak->series[SOAK_P999][i],
+		soak->series[SOAK_RSS][i], soak->series[SOAK_HEAP][i], soak->series[SOAK_HEAP_FREE][i], soak->series[SOAK_FILE][i],
+		soak->series[SOAK_NODES][i], soak->series[SOAK_HEIGHT][i], (unsigned long)(failed - soak->failed));
+	fflush(stdout);
+
+	soak->answered = answered;
+	soak->failed = failed;
+	return soakStopped == 0 && soak->samplesNum < soak->maxSamples;
+}
+
+
+// Sends a STATS request with given selector on link and copies the response in buff (MAX_NAME_SIZE bytes), returns 0 on failure
+int QueryServerStats(ServerLink_t* link, uint64_t sessionToken, const char* selector, char* buff)
+{
+	static uint32_t requestId = 0;
+	Packet_t request;
+	Packet_t response;
+	memset(&request, 0, sizeof(Packet_t));
+
+	request.type = STATS;
+	request.requestId = ++requestId;
+	request.sessionToken = sessionToken;
+	strncpy(request.clientName, DEFAULT_ADMIN_NAME, MAX_NAME_SIZE);
+	strncpy(request.name, selector, MAX_NAME_SIZE);
+
+	if(SendToServer(link, &request) == 0 || ReceiveFromServer(link, &response) == 0 || response.type != ACCEPTED)
+		return 0;
+
+	memcpy(buff, response.name, MAX_NAME_SIZE);
+	buff[MAX_NAME_SIZE - 1] = '\0';
+	return 1;
+}
+
+
+// Writes in sample the memory used by the server, the size of its data file and the shape of its index (NAN if they are not available)
+void SampleServer(ServerLink_t* link, uint64_t sessionToken, double* sample)
+{
+	char buff[MAX_NAME_SIZE];
+	unsigned long rss, heap, heapFree, file, nodes, height;
+
+	for(int i = SOAK_RSS; i < SOAK_SERIES; i++)
+		sample[i] = NAN;
+
+	if(QueryServerStats(link, sessionToken, "process", buff) == 1 &&
+		sscanf(buff, "rss=%lu heap=%lu free=%lu file=%lu", &rss, &heap, &heapFree, &file) == 4)
+	{
+		sample[SOAK_RSS] = rss;
+		sample[SOAK_HEAP] = heap;
+		sample[SOAK_HEAP_FREE] = heapFree;
+		sample[SOAK_FILE] = file;
+	}
+
+	if(QueryServerStats(link, sessionToken, "index", buff) == 1 && sscanf(buff, "nodes=%lu height=%lu", &nodes, &height) == 2)
+	{
+		sample[SOAK_NODES] = nodes;
+		sample[SOAK_HEIGHT] = height;
+	}
+}
+
+
+// Prints, for each sampled series, its mean over the first and the last tenth of the run and the slope (per hour) of its least-squares
+// line; series that changed more than SOAK_DRIFT_THRESHOLD % in the direction of its slope are marked
+void PrintDrift(double* series[SOAK_SERIES], double* elapsed, int samplesNum)
+{
+	int window = samplesNum / 10 > 0 ? samplesNum / 10 : 1;
+
+	printf("\n%-14s %14s %14s %10s %16s\n", "series", "start", "end", "change", "slope per hour");
+	for(int i = 0; i < SOAK_SERIES; i++)
+	{
+		double startSum = 0, endSum = 0;
+		int startNum = 0, endNum = 0;
+		double sumX = 0, sumY = 0, sumXY = 0, sumXX = 0;
+		int num = 0;
+
+		for(int j = 0; j < samplesNum; j++)
+		{
+			double y = series[i][j];
+			if(isnan(y))
+				continue;
+
+			if(j < window)
+			{
+				startSum += y;
+				startNum++;
+			}
+			if(j >= samplesNum - window)
+			{
+				endSum += y;
+				endNum++;
+			}
+
+			double x = elapsed[j] / 3600.0;
+			sumX += x;
+			sumY += y;
+			sumXY += x * y;
+			sumXX += x * x;
+			num++;
+		}
+
+		if(startNum == 0 || endNum == 0)
+		{
+			printf("%-14s %14s %14s %10s %16s\n", soakNames[i], "-", "-", "-", "-");
+			continue;
+		}
+
+		double startMean = startSum / startNum;
+		double endMean = endSum / endNum;
+		double change = startMean != 0 ? (endMean - startMean) / startMean * 100.0 : 0;
+		double denominator = num * sumXX - sumX * sumX;
+		double slope = num > 1 && denominator > 0 ? (num * sumXY - sumX * sumY) / denominator : 0;
+		int drifting = fabs(change) > SOAK_DRIFT_THRESHOLD && change * slope > 0;
+
+		printf("%-14s %14.1f %14.1f %9.1f%% %16.1f%s\n", soakNames[i], startMean, endMean, change, slope, drifting ? "  drift" : "");
+	}
+}
+
+
+// Writes series sampled by a soak run on file filename as JSON (value of each metric is its mean over the last tenth of the run, samples
+// are all the values sampled), returns 0 on failure
+int WriteSoakResults(LoadConfig_t* config, int seconds, double* series[SOAK_SERIES], int samplesNum, const char* filename)
+{
+	char workload[128];
+	char description[256];
+	FormatWorkload(config->workload, workload, sizeof(workload));
+	snprintf(description, sizeof(description), "%.0f req/s for %d s sampled every %d s on %d sockets, %s, mix %d/%d/%d, %s", config->rate,
+		seconds, config->samplePeriod, config->socketsNum, transportNames[config->transport], config->mix[0], config->mix[1], config->mix[2],
+		workload);
+
+	Results_t* results = CreateResults("tester", "soak", description);
+	if(results == NULL)
+		return 0;
+
+	int window = samplesNum / 10 > 0 ? samplesNum / 10 : 1;
+	int result = 1;
+	for(int i = 0; i < SOAK_SERIES && result == 1; i++)
+	{
+		double samples[samplesNum];
+		double endSum = 0;
+		int num = 0, endNum = 0;
+		for(int j = 0; j < samplesNum; j++)
+		{
+			if(isnan(series[i][j]))
+				continue;
+
+			samples[num++] = series[i][j];
+			if(j >= samplesNum - window)
+			{
+				endSum += series[i][j];
+				endNum++;
+			}
+		}
+
+		if(endNum > 0)
+			result = AddMetric(results, soakNames[i], soakUnits[i], i == SOAK_THROUGHPUT, endSum / endNum, samples, num);
+	}
+
+	result = result && WriteResults(results, filename);
+	DestroyResults(&results);
+	return result;
+}
+
+
+// Signal handler for SIGINT during a soak run
+void StopSoak(int dummy)
+{
+	(void) dummy;
+	soakStopped = 1;
+}